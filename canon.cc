@@ -1,62 +1,68 @@
 #include "canon.hh"
 #include "test.hh"
 
-#include <vector>
 #include <cstring>
 
-std::string
-canonicalize(char const* __restrict__ path_in)
-{
-  if (!*path_in)
-    return "";
-
-  char path[strlen(path_in)];
-  std::strcpy(path, path_in);
+namespace {
+  // Whether the last component of [base, end) is "..".
+  bool
+  last_is_dotdot(char const* base, char const* end)
+  {
+    if (end - base < 2 || end[-1] != '.' || end[-2] != '.')
+      return false;
+    return end - base == 2 || end[-3] == '/';
+  }
+}
 
-  typedef std::vector<char const*> strv;
-  strv components;
+size_t
+canonicalize_inplace(char *__restrict__ path)
+{
+  // Components are compacted towards the beginning of the buffer.
+  // The write cursor never overtakes the read cursor, so this works
+  // in place without any scratch memory.
+  char *const end = path + std::strlen(path);
+  bool initial_slash = *path == '/';
+  char *const base = path + initial_slash;
+  char *w = base;
 
-  bool initial_slash = false;
-  char * it = path;
-  while (char * lit = strsep(&it, "/"))
+  for (char *r = base; r < end; )
     {
-      if (lit == path && *lit == 0)
-	initial_slash = true;
-      else if (it > lit + 1 || lit == path
-	       || (it == NULL && *lit != 0))
-	components.push_back(lit);
-    }
+      char *s = r;
+      char *e = static_cast<char *>(std::memchr(s, '/', end - s)) ?: end;
+      size_t len = e - s;
+      r = e + 1;
 
-  for (strv::iterator it = components.begin(); it != components.end(); )
-    {
-      if (std::strcmp(*it, ".") == 0)
-	{
-	  components.erase(it);
-	  continue;
-	}
-      else if (std::strcmp(*it, "..") == 0
-	       && it != components.begin()
-	       && std::strcmp(*(it - 1), "..") != 0)
+      if (len == 0 || (len == 1 && *s == '.'))
+	continue;
+
+      if (len == 2 && s[0] == '.' && s[1] == '.'
+	  && w != base && !last_is_dotdot(base, w))
 	{
-	  components.erase(it - 1, it + 1);
-	  if (it != components.begin())
-	    --it;
+	  // Drop the previous component.
+	  while (w != base && w[-1] != '/')
+	    --w;
+	  if (w != base)
+	    --w;
 	  continue;
 	}
-      ++it;
+
+      if (w != base)
+	*w++ = '/';
+      std::memmove(w, s, len);
+      w += len;
     }
 
-  std::string ret = initial_slash ? "/" : "";
-  for (strv::const_iterator it = components.begin();
-       it != components.end(); ++it)
-    if (**it)
-      {
-	if (it != components.begin())
-	  ret += '/';
-	ret += *it;
-      }
+  *w = 0;
+  return w - path;
+}
 
-  return ret;
+std::string
+canonicalize(char const* __restrict__ path_in)
+{
+  char path[std::strlen(path_in) + 1];
+  std::strcpy(path, path_in);
+  size_t len = canonicalize_inplace(path);
+  return std::string(path, len);
 }
 
 #if defined SELFTEST
@@ -97,9 +103,19 @@ main(void)
     {"/a/b/./c/d/","/a/b/c/d"},
     {"/.a/b/./c/d/","/.a/b/c/d"},
     {"a/b./c/d/","a/b./c/d"},
+    {"../..","../.."},
+    {"a/../../b","../b"},
+    {"./a/./b/","a/b"},
   };
   for (size_t i = 0; i < sizeof(t) / sizeof(*t); ++i)
-    check(strcmp(canonicalize(t[i].path).c_str(), t[i].canon) == 0, t[i].path);
+    {
+      check(strcmp(canonicalize(t[i].path).c_str(), t[i].canon) == 0, t[i].path);
+
+      char buf[strlen(t[i].path) + 1];
+      strcpy(buf, t[i].path);
+      size_t len = canonicalize_inplace(buf);
+      check(strcmp(buf, t[i].canon) == 0 && len == strlen(buf), t[i].path);
+    }
   end_tests();
 }
 #endif
@@ -2,3 +2,8 @@
 
 std::string canonicalize(char const* __restrict__ path_in)
   __attribute__((pure, nonnull(1)));
+
+// Canonicalize PATH in its own buffer, without allocating anything.
+// Returns the length of the resulting (NUL-terminated) path.
+size_t canonicalize_inplace(char *__restrict__ path)
+  __attribute__((nonnull(1)));
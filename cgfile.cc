@@ -66,6 +66,7 @@ cgfile::include(tok_vect_vect const& file_tokens, char const* curmodule)
     curpath = curpath.substr(0, idx + 1);
   else
     curpath = "./";
+  q::Quark qcurpath = q::intern(curpath);
 
   size_t num_lines = file_tokens.size();
   for (size_t line_i = 0; line_i < num_lines; ++line_i)
@@ -214,7 +215,7 @@ cgfile::include(tok_vect_vect const& file_tokens, char const* curmodule)
 		{
 		  psym->set_file(fsym);
 		  psym->set_line_number(line_number);
-		  update_path(psym, curpath);
+		  update_path(psym, qcurpath);
 		}
 
 	      if (!is_decl)
@@ -235,7 +236,7 @@ cgfile::include(tok_vect_vect const& file_tokens, char const* curmodule)
 	  psym->set_decl(is_decl);
 	  psym->set_static(is_static);
 	  psym->set_var(is_var);
-	  update_path(psym, curpath);
+	  update_path(psym, qcurpath);
 	  maybe_enlist = true;
 	}
 
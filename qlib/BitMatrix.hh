@@ -0,0 +1,436 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BIT_MATRIX_H
+#define BIT_MATRIX_H
+
+#include "config.hh"
+#include "Bitset.hh"
+
+#ifndef BIT_MATRIX_HUGE_PAGES
+#   define BIT_MATRIX_HUGE_PAGES 1
+#endif
+
+#include <cassert>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace BitMatrixImpl {
+    typedef BitsetImpl::TWord                           TWord;
+
+    using BitsetImpl::WORD_BITS;
+
+    /// each row starts on a cache line, rows are laid out like Bitset
+    using BitsetImpl::ALIGN;
+    const size_t ROW_ALIGN_WORDS = BitsetImpl::BLOCK_WORDS;
+
+    /// transparent huge page, matrices at least that big are aligned to it
+    const size_t HUGE_PAGE = 2 << 20;
+
+    /**
+     * Swap the upper right J x J block of bits with the lower left one in
+     * each 2J x 2J block on the diagonal of a 64x64 block of bits. Words are
+     * independent of each other and the count of them is known, so that the
+     * compiler can vectorize the loop.
+     */
+    template <unsigned J>
+    inline void swapBlocks(TWord *block, TWord mask) {
+        for (unsigned base = 0; base < WORD_BITS; base += 2 * J) {
+            TWord *lo = block + base;
+            TWord *hi = lo + J;
+            for (unsigned k = 0; k < J; ++k) {
+                const TWord t = ((lo[k] >> J) ^ hi[k]) & mask;
+                lo[k] ^= t << J;
+                hi[k] ^= t;
+            }
+        }
+    }
+
+    /**
+     * Transpose a 64x64 block of bits in place, bit j of word i is swapped
+     * with bit i of word j. Blocks of 32x32 bits are swapped first, then
+     * blocks of 16x16 bits within them and so on, six rounds in total.
+     */
+    inline void transpose64(TWord *block) {
+        swapBlocks<32>(block, 0x00000000FFFFFFFFULL);
+        swapBlocks<16>(block, 0x0000FFFF0000FFFFULL);
+        swapBlocks<8> (block, 0x00FF00FF00FF00FFULL);
+        swapBlocks<4> (block, 0x0F0F0F0F0F0F0F0FULL);
+        swapBlocks<2> (block, 0x3333333333333333ULL);
+        swapBlocks<1> (block, 0x5555555555555555ULL);
+    }
+}
+
+/**
+ * Row of a BitMatrix, a bitset of fixed capacity in memory owned by the
+ * matrix. Copies of a row refer to the same memory. The interface follows
+ * boost::dynamic_bitset (size(), resize(), test(), set(), count(),
+ * operator|=, ...) as far as BitmapIndexer needs it, but the size of a row can
+ * only be zero (the row is not used) or its capacity.
+ *
+ * Bits above size() are always clear, rows are padded to whole cache lines,
+ * and the words of a row start on a cache line, so that bitwise operations of
+ * two rows run over aligned words with no tail to care about. They share the
+ * vector kernels of Bitset (see BitsetImpl).
+ */
+class BitRow {
+    public:
+        typedef BitMatrixImpl::TWord                    TWord;
+
+        /// returned by find_first() and find_next() if there is no bit set
+        static const size_t npos = static_cast<size_t>(-1);
+
+    public:
+        BitRow():
+            words_(0),
+            size_(0),
+            capacity_(0)
+        {
+        }
+
+        /**
+         * @param words Cleared memory of the row, aligned to ALIGN.
+         * @param capacity Count of bits of the row, words are padded to ALIGN.
+         */
+        BitRow(TWord *words, size_t capacity):
+            words_(words),
+            size_(0),
+            capacity_(capacity)
+        {
+        }
+
+        size_t size() const {
+            return size_;
+        }
+
+        /// @return Return count of words of the row, including the padding
+        size_t num_blocks() const {
+            return (size_) ? BitRow::paddedWords(size_) : 0;
+        }
+
+        TWord* data() {
+            return words_;
+        }
+
+        const TWord* data() const {
+            return words_;
+        }
+
+        /**
+         * Start using the row (size equal to the capacity) with all bits of
+         * the given value, or stop using it (size zero). Words of an unused
+         * row are always clear, so they are not written to clear them.
+         */
+        void resize(size_t size, bool value = false) {
+            assert(!size || size == capacity_);
+            if (size) {
+                if (value || size_)
+                    std::memset(words_, (value) ? 0xFF : 0,
+                                BitRow::paddedWords(size) * sizeof(TWord));
+                size_ = size;
+                if (value)
+                    this->clearPadding();
+            }
+            else
+                this->clear();
+        }
+
+        void clear() {
+            if (size_)
+                std::memset(words_, 0, this->num_blocks() * sizeof(TWord));
+            size_ = 0;
+        }
+
+        bool test(size_t pos) const {
+            assert(pos < size_);
+            return (words_[pos / BitMatrixImpl::WORD_BITS]
+                    >> (pos % BitMatrixImpl::WORD_BITS)) & 1;
+        }
+
+        bool operator[](size_t pos) const {
+            return this->test(pos);
+        }
+
+        BitRow& set(size_t pos) {
+            assert(pos < size_);
+            words_[pos / BitMatrixImpl::WORD_BITS]
+                |= TWord(1) << (pos % BitMatrixImpl::WORD_BITS);
+            return *this;
+        }
+
+        BitRow& reset(size_t pos) {
+            assert(pos < size_);
+            words_[pos / BitMatrixImpl::WORD_BITS]
+                &= ~(TWord(1) << (pos % BitMatrixImpl::WORD_BITS));
+            return *this;
+        }
+
+        size_t count() const {
+            return BitsetImpl::countWords(words_, this->num_blocks());
+        }
+
+        bool any() const {
+            return BitsetImpl::anyWords(words_, this->num_blocks());
+        }
+
+        bool none() const {
+            return !this->any();
+        }
+
+        size_t find_first() const {
+            return BitsetImpl::findFrom(words_, size_, 0, npos);
+        }
+
+        size_t find_next(size_t pos) const {
+            return (pos + 1 < size_)
+                ? BitsetImpl::findFrom(words_, size_, pos + 1, npos)
+                : npos;
+        }
+
+        BitRow& operator|=(const BitRow &other) {
+            assert(size_ == other.size_);
+            BitsetImpl::orWords(words_, words_, other.words_,
+                                this->num_blocks());
+            return *this;
+        }
+
+        BitRow& operator&=(const BitRow &other) {
+            assert(size_ == other.size_);
+            BitsetImpl::andWords(words_, words_, other.words_,
+                                 this->num_blocks());
+            return *this;
+        }
+
+        BitRow& operator-=(const BitRow &other) {
+            assert(size_ == other.size_);
+            BitsetImpl::andNotWords(words_, words_, other.words_,
+                                    this->num_blocks());
+            return *this;
+        }
+
+        bool operator==(const BitRow &other) const {
+            return size_ == other.size_
+                && !std::memcmp(words_, other.words_,
+                                this->num_blocks() * sizeof(TWord));
+        }
+
+        bool operator!=(const BitRow &other) const {
+            return !(*this == other);
+        }
+
+        /// @return Return count of words of a row of the given capacity
+        static size_t paddedWords(size_t capacity) {
+            return BitsetImpl::paddedWords(capacity);
+        }
+
+    private:
+        TWord           *words_;
+        size_t          size_;
+        size_t          capacity_;
+
+        void clearPadding() {
+            using BitMatrixImpl::WORD_BITS;
+            const size_t n = this->num_blocks();
+            const size_t used = (size_ + WORD_BITS - 1) / WORD_BITS;
+            if (size_ % WORD_BITS)
+                words_[used - 1] &= (TWord(1) << (size_ % WORD_BITS)) - 1;
+            for (size_t i = used; i < n; ++i)
+                words_[i] = 0;
+        }
+};
+
+/**
+ * Rows of bits in one contiguous block of memory, each row starting on a cache
+ * line (see BitRow). The block is an anonymous memory mapping, so pages of
+ * rows which are never used are never allocated. Rows are kept as BitRow
+ * objects, references to them stay valid until the matrix is assigned again
+ * or cleared.
+ */
+class BitMatrix {
+    public:
+        typedef std::vector<BitRow>::const_iterator     const_iterator;
+
+    public:
+        BitMatrix():
+            data_(0),
+            bytes_(0),
+            nBits_(0)
+        {
+        }
+
+        /// used rows are copied, unused ones are left unallocated
+        BitMatrix(const BitMatrix &other):
+            data_(0),
+            bytes_(0),
+            nBits_(0)
+        {
+            *this = other;
+        }
+
+        ~BitMatrix() {
+            this->clear();
+        }
+
+        BitMatrix& operator=(const BitMatrix &other) {
+            if (this == &other)
+                return *this;
+
+            const size_t nRows = other.rows_.size();
+            this->assign(nRows, other.nBits_);
+            for (size_t r = 0; r < nRows; ++r) {
+                const BitRow &src = other.rows_[r];
+                if (!src.size())
+                    continue;
+
+                rows_[r].resize(nBits_);
+                std::memcpy(rows_[r].data(), src.data(),
+                            src.num_blocks() * sizeof(BitRow::TWord));
+            }
+
+            return *this;
+        }
+
+        /**
+         * Allocate nRows rows of nBits bits, all of them unused (size zero).
+         * @throw std::bad_alloc if the memory can't be mapped.
+         */
+        void assign(size_t nRows, size_t nBits) {
+            using BitMatrixImpl::HUGE_PAGE;
+
+            this->clear();
+            nBits_ = nBits;
+            const size_t words = BitRow::paddedWords(nBits);
+            size_t bytes = nRows * words * sizeof(BitRow::TWord);
+            if (!bytes) {
+                rows_.resize(nRows);
+                return;
+            }
+
+            // whole pages, so that the tail after them can be unmapped
+            const size_t page = sysconf(_SC_PAGESIZE);
+            bytes = (bytes + page - 1) / page * page;
+
+            // map a huge page more than needed to align big matrices to it
+            const size_t extra = (HUGE_PAGE <= bytes) ? HUGE_PAGE : 0;
+            void *addr = mmap(0, bytes + extra, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                              -1, 0);
+            if (MAP_FAILED == addr)
+                throw std::bad_alloc();
+
+            char *base = static_cast<char *>(addr);
+            if (extra) {
+                const size_t head = (HUGE_PAGE
+                        - reinterpret_cast<size_t>(base) % HUGE_PAGE)
+                    % HUGE_PAGE;
+                const size_t tail = extra - head;
+                if ((head && munmap(base, head))
+                        || (tail && munmap(base + head + bytes, tail)))
+                {
+                    // what is left of the mapping is not trimmed
+                    munmap(base, bytes + extra);
+                    throw std::bad_alloc();
+                }
+                base += head;
+            }
+
+            data_ = reinterpret_cast<BitRow::TWord *>(base);
+            bytes_ = bytes;
+            rows_.reserve(nRows);
+            for (size_t r = 0; r < nRows; ++r)
+                rows_.push_back(BitRow(data_ + r * words, nBits));
+        }
+
+        /**
+         * Free all rows.
+         */
+        void clear() {
+            if (data_) {
+                const int rv = munmap(data_, bytes_);
+                assert(!rv);
+                (void) rv;
+            }
+
+            data_ = 0;
+            bytes_ = 0;
+            nBits_ = 0;
+            rows_.clear();
+        }
+
+        /// @return Return count of rows
+        size_t size() const {
+            return rows_.size();
+        }
+
+        BitRow& operator[](size_t row) {
+            return rows_[row];
+        }
+
+        const BitRow& operator[](size_t row) const {
+            return rows_[row];
+        }
+
+        const_iterator begin() const {
+            return rows_.begin();
+        }
+
+        const_iterator end() const {
+            return rows_.end();
+        }
+
+        /**
+         * Ask for transparent huge pages, worth it once (nearly) all rows are
+         * going to be used. It does nothing if the program is built with
+         * BIT_MATRIX_HUGE_PAGES set to zero, or if the kernel does not support
+         * them.
+         */
+        void adviseHugePages() {
+#if BIT_MATRIX_HUGE_PAGES && defined(MADV_HUGEPAGE)
+            if (BitMatrixImpl::HUGE_PAGE <= bytes_)
+                madvise(data_, bytes_, MADV_HUGEPAGE);
+#endif
+        }
+
+        /**
+         * @return Return count of bytes of rows in use (pages of unused rows
+         * are not allocated as long as they are not touched) and of the rows
+         * themselves.
+         */
+        size_t memoryUsage() const {
+            size_t size = rows_.capacity() * sizeof(BitRow);
+            for (const_iterator i = rows_.begin(); i != rows_.end(); ++i)
+                size += i->num_blocks() * sizeof(BitRow::TWord);
+
+            return size;
+        }
+
+    private:
+        BitRow::TWord           *data_;
+        size_t                  bytes_;
+        size_t                  nBits_;     ///< capacity of each row
+        std::vector<BitRow>     rows_;
+};
+
+#endif // BIT_MATRIX_H
@@ -21,17 +21,24 @@
 #define BITMAP_INDEX_H
 
 #include "config.hh"
+#include "BitMatrix.hh"
+#include "Bitset.hh"
+#include "Image.hh"
+#include "RoaringBitmap.hh"
 #include "VertexFilter.hh"
+#include "VertexOrder.hh"
 
 #ifndef DEBUG_BITMAP_INDEX
 #   define DEBUG_BITMAP_INDEX 0
 #endif
 
+#include <algorithm>
 #include <cassert>
 #include <stack>
+#include <string>
 #include <vector>
 
-#include <boost/dynamic_bitset.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/graph/adjacency_list.hpp>
 
 #if DEBUG_BITMAP_INDEX
@@ -39,12 +46,230 @@
 #endif
 
 /**
- * Type of bitmap index. This type is used by BitmapIndexer to store (and
- * return) a reachability relation. It is also used by BitmapVertexPredicate
- * and BitmapFilter to define which vertices belongs to the factor. The bitset
- * must be always the same size as the count of vertices (of related graph).
+ * Type of bitmap of vertices. This type is used by BitmapVertexPredicate and
+ * BitmapFilter to define which vertices belongs to the factor, indexes of any
+ * storage are copied to it (see copyIndex()). The bitset must be always the
+ * same size as the count of vertices (of related graph).
  */
-typedef boost::dynamic_bitset <> TBitmapIndex;
+typedef Bitset TBitmapIndex;
+
+/**
+ * Kinds of storage of reachability indexes, BitmapIndexer takes the type of
+ * index as template parameter (BitRow or RoaringBitmap). ReachIndexer (see
+ * ReachIndex.hh) keeps no bitmaps at all.
+ */
+enum EIndexStorage {
+    IS_DENSE,       ///< rows of a bit matrix (BitRow of BitMatrix)
+    IS_ROARING,     ///< compressed bitmaps (RoaringBitmap)
+    IS_LABELS       ///< interval labels (ReachIndexer)
+};
+
+/**
+ * @return Return the index storage of the given name (dense, roaring, labels).
+ * If the name is not known, IS_DENSE is returned and ok is set to false.
+ */
+inline EIndexStorage indexStorageByName(const std::string &name, bool &ok) {
+    ok = true;
+    if (name == "roaring")
+        return IS_ROARING;
+    if (name == "labels")
+        return IS_LABELS;
+
+    ok = (name == "dense");
+    return IS_DENSE;
+}
+
+/**
+ * Operations BitmapIndexer needs besides the bitset interface, specialized
+ * for each type of index. Indexes of one type (IN or OUT) are kept in a list
+ * of type TList, an index for each component. Indexes are written to session
+ * images as arrays of words of type TWord.
+ */
+template <typename TIndex>
+struct IndexStorage;
+
+template <>
+struct IndexStorage<BitRow> {
+    typedef BitMatrix                                   TList;
+    typedef BitRow::TWord                               TWord;
+    static const EIndexStorage KIND = IS_DENSE;
+
+    /// allocate unused indexes of nBits bits each
+    static void init(BitMatrix &list, size_t nRows, size_t nBits) {
+        list.assign(nRows, nBits);
+    }
+
+    /// called before all indexes of the list are built
+    static void willBuildAll(BitMatrix &list) {
+        list.adviseHugePages();
+    }
+
+    static size_t memoryUsage(const BitMatrix &list) {
+        return list.memoryUsage();
+    }
+
+    /// called once the index is built
+    static void shrink(BitRow &) {
+    }
+
+    /// @return Return count of words written by save()
+    static size_t words(const BitRow &index) {
+        return index.num_blocks();
+    }
+
+    static void save(const BitRow &index, std::vector<TWord> &dst) {
+        dst.insert(dst.end(), index.data(), index.data() + index.num_blocks());
+    }
+
+    /// rows may come without their padding, bits above size must be clear
+    static bool load(BitRow &index, size_t size, const TWord *first,
+                     const TWord *last)
+    {
+        using BitMatrixImpl::WORD_BITS;
+        const size_t used = (size + WORD_BITS - 1) / WORD_BITS;
+        const size_t n = last - first;
+        if (n < used || BitRow::paddedWords(size) < n)
+            return false;
+        if (size % WORD_BITS && (first[used - 1] >> (size % WORD_BITS)))
+            return false;
+        for (size_t i = used; i < n; ++i)
+            if (first[i])
+                return false;
+
+        index.resize(size);
+        std::copy(first, last, index.data());
+        return true;
+    }
+};
+
+template <>
+struct IndexStorage<RoaringBitmap> {
+    typedef std::vector<RoaringBitmap>                  TList;
+    typedef RoaringBitmap::TWord                        TWord;
+    static const EIndexStorage KIND = IS_ROARING;
+
+    static void init(TList &list, size_t nRows, size_t) {
+        list.clear();
+        list.resize(nRows);
+    }
+
+    static void willBuildAll(TList &) {
+    }
+
+    static size_t memoryUsage(const TList &list) {
+        size_t size = list.capacity() * sizeof(RoaringBitmap);
+        for (TList::const_iterator i = list.begin(); i != list.end(); ++i)
+            size += i->memoryUsage();
+
+        return size;
+    }
+
+    static void shrink(RoaringBitmap &index) {
+        index.optimize();
+    }
+
+    static size_t words(const RoaringBitmap &index) {
+        return index.serializedSize();
+    }
+
+    static void save(const RoaringBitmap &index, std::vector<TWord> &dst) {
+        index.serialize(dst);
+    }
+
+    static bool load(RoaringBitmap &index, size_t size, const TWord *first,
+                     const TWord *last)
+    {
+        index = RoaringBitmap(size);
+        return index.deserialize(first, last);
+    }
+};
+
+/**
+ * Copy an index of any storage to a plain bitset, which is used by the
+ * predicates (and the Python binding) whatever the indexes are kept in.
+ */
+inline void copyIndex(TBitmapIndex &dst, const TBitmapIndex &src) {
+    dst = src;
+}
+
+inline void copyIndex(TBitmapIndex &dst, const BitRow &src) {
+    dst.assign(src.data(), src.size());
+}
+
+inline void copyIndex(TBitmapIndex &dst, const RoaringBitmap &src) {
+    src.copyTo(dst);
+}
+
+inline TBitmapIndex& operator|=(TBitmapIndex &dst, const RoaringBitmap &src) {
+    TBitmapIndex tmp;
+    src.copyTo(tmp);
+    return dst |= tmp;
+}
+
+inline TBitmapIndex& operator&=(TBitmapIndex &dst, const RoaringBitmap &src) {
+    TBitmapIndex tmp;
+    src.copyTo(tmp);
+    return dst &= tmp;
+}
+
+/**
+ * Store bitwise and of two indexes (of any storage) to a plain bitset.
+ */
+template <typename TIndex>
+void intersectIndexes(TBitmapIndex &dst, const TIndex &a, const TIndex &b) {
+    copyIndex(dst, a);
+    dst &= b;
+}
+
+/// rows of a bit matrix are combined word by word, in one pass
+inline void intersectIndexes(TBitmapIndex &dst, const BitRow &a,
+                             const BitRow &b)
+{
+    assert(a.size() == b.size());
+    dst.assignAnd(a.data(), b.data(), a.size());
+}
+
+template <typename TGraph>
+class BitmapFilter;
+
+namespace BitmapIndexImpl {
+    /// vertex without an index in a session image
+    const boost::uint32_t NO_ROW = static_cast<boost::uint32_t>(-1);
+
+    /// minimal average count of components per level to build in parallel
+    const size_t MIN_LEVEL_WIDTH = 32;
+
+    /// splitmix64 step, used for hashing and repeatable shuffles
+    inline boost::uint64_t mix(boost::uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+}
+
+/**
+ * @return Return hash of the structure of the graph (count of vertices and
+ * the edges between their numbers), which tags indexes written to images.
+ * The order of edges does not matter, so the graph and its compressed copy
+ * have the same hash. O(V+E).
+ */
+template <typename TGraph>
+boost::uint64_t graphHash(const TGraph &graph) {
+    using namespace boost;
+    using BitmapIndexImpl::mix;
+    typedef graph_traits<TGraph>                        Traits;
+
+    const size_t nVert = num_vertices(graph);
+    uint64_t hash = mix(nVert);
+    for (size_t v = 0; v < nVert; ++v) {
+        typename Traits::out_edge_iterator oi, oi_end;
+        for (tie(oi, oi_end) = out_edges(v, graph); oi != oi_end; ++oi)
+            hash += mix((static_cast<uint64_t>(v) << 32) | target(*oi, graph));
+    }
+
+    return mix(hash);
+}
 
 /**
  * BitmapIndexer class template is responsible for computing a reachability
@@ -58,20 +283,31 @@ typedef boost::dynamic_bitset <> TBitmapIndex;
  * index) means "all vertices from which the given vertex is reachable". Both
  * types of indexes are maintained together by BitmapIndexer.
  *
- * Maximal memory complexity of this class is asymptomatically O(N^2) where
- * N is the number of vertices. It allocates N^2 bits for both indexes.
+ * All vertices of a strongly connected component (recursive functions) reach
+ * the same vertices, so indexes are kept per component and shared by its
+ * vertices. Components are found on the first request for an index.
+ *
+ * Maximal memory complexity of this class is asymptomatically O(N*C) where
+ * N is the number of vertices and C the number of components. The default
+ * storage keeps indexes of each type as rows of one C x N bit matrix (see
+ * BitMatrix), whose pages are allocated as rows are built. RoaringBitmap
+ * storage keeps sparse indexes (leaves) and nearly full ones (roots of big
+ * graphs) in a fraction of that, at the cost of slower bitwise operations on
+ * indexes which are neither.
  *
  * @param TGraph Type of graph, boost::adjacency_list is supported.
+ * @param TStorage Type of index, BitRow or RoaringBitmap (see IndexStorage).
  * @attention BitmapIndexer can't be used for sparse and/or filtered graphs. It
  * means vertex indexes must be continuous. If you need to index filtered graph,
  * please clone/pack it and then index it.
  */
-template <typename TGraph>
+template <typename TGraph, typename TStorage = BitRow>
 class BitmapIndexer {
     public:
         typedef typename boost::graph_traits<TGraph>    Traits;
         typedef typename Traits::vertex_descriptor      TVertex;
-        typedef TBitmapIndex                            TIndex;
+        typedef TStorage                                TIndex;
+        typedef BitmapFilter<TGraph>                    TFilter;
         typedef enum { IN, OUT }                        EDirection;
 
     public:
@@ -84,8 +320,11 @@ class BitmapIndexer {
          * BitmapIndexer destruction.
          */
         BitmapIndexer(const TGraph &graph):
-            graph_(graph)
+            graph_(graph),
+            nComp_(0)
         {
+            this->clearMapped(IN);
+            this->clearMapped(OUT);
         }
 
         /**
@@ -104,22 +343,18 @@ class BitmapIndexer {
          * Otherwise it has complexity of Depth Search (not DFS as not only
          * First vertex has to be found). Once computed index is held for next
          * request (if not cleared explicitly) and/or for faster all-in-one
-         * indexes computation.
+         * indexes computation. Vertices of the same strongly connected
+         * component get the same index.
          * @param vertex Vertex to obtain index for.
          * @param dir Direction of index (IN or OUT).
          */
         const TIndex& index(TVertex vertex, EDirection dir) {
             // check range
-            size_t nVert = boost::num_vertices(graph_);
-            assert(vertex < nVert);
-
-            // initialize storage if needed
-            TIndexList &list = storage_[dir];
-            if (list.size() != nVert)
-                list.resize(nVert);
+            assert(vertex < num_vertices(graph_));
 
+            const boost::uint32_t comp = initStorage(dir)[vertex];
             buildIfNeeded(vertex, dir);
-            return list[vertex];
+            return storage_[dir][comp];
         }
 
         /**
@@ -137,21 +372,100 @@ class BitmapIndexer {
          * but more expensive than computing only one index. It is safe to call
          * this method multiple times and/or mix it with calls of the index()
          * method. It can be cheaper if some (or even all) indexes are already
-         * computed. Complexity of the first run is asymptomatically O(N^2 * D)
-         * where N is the count of vertices and D is the maximal length of path
-         * in the graph, complexity of second run O(N^2).
+         * computed.
+         *
+         * Indexes are computed on the condensation of the graph, one for each
+         * component in topological order (callees first for OUT, callers
+         * first for IN), as the union of indexes of neighbor components. Each
+         * edge between components then costs one bitwise or. Complexity is
+         * O(N * E' / W) where E' is the count of edges between components and
+         * W the count of bits in a word, plus O(N + E) to find components.
+         *
+         * Components of the same level (the longest path to a component
+         * without neighbors) do not depend on each other. If the program is
+         * built with OpenMP, levels are built one by one and components of
+         * each level in parallel, scheduled dynamically as their costs
+         * differ a lot. Graphs whose levels are narrow (long chains) are
+         * built serially, a barrier per level would cost more.
          * @param dir Type of indexes to compute (IN our OUT).
          */
         void build(EDirection dir) {
-            // initialize storage if needed
-            size_t nVert = boost::num_vertices(graph_);
-            TIndexList &list = storage_[dir];
-            if (list.size() != nVert)
-                list.resize(nVert);
+            using namespace boost;
+
+            const TCompList &compOf = initStorage(dir);
+            const size_t nVert = num_vertices(graph_);
+            TStorageOps::willBuildAll(storage_[dir]);
 
-            // allocate all indexes
+            // members of each component
+            TCompList start(nComp_ + 1, 0);
             for (TVertex v = 0; v < nVert; ++v)
-                buildIfNeeded(v, dir);
+                ++start[compOf[v] + 1];
+            for (size_t c = 0; c < nComp_; ++c)
+                start[c + 1] += start[c];
+            TCompList members(nVert);
+            {
+                TCompList fill(start.begin(), start.end() - 1);
+                for (TVertex v = 0; v < nVert; ++v)
+                    members[fill[compOf[v]]++] = v;
+            }
+
+            // components of each level
+            TCompList level;
+            const size_t nLevels = this->levels(dir, start, members, level);
+            TCompList levelStart(nLevels + 1, 0);
+            for (size_t c = 0; c < nComp_; ++c)
+                ++levelStart[level[c] + 1];
+            for (size_t l = 0; l < nLevels; ++l)
+                levelStart[l + 1] += levelStart[l];
+            TCompList byLevel(nComp_);
+            {
+                TCompList fill(levelStart.begin(), levelStart.end() - 1);
+                for (size_t c = 0; c < nComp_; ++c)
+                    byLevel[fill[level[c]]++] = c;
+            }
+
+#ifdef _OPENMP
+#   pragma omp parallel \
+        if (BitmapIndexImpl::MIN_LEVEL_WIDTH * nLevels <= nComp_)
+#endif
+            {
+                // each thread has its own marks of neighbors
+                TCompList lastSeen(nComp_, nComp_);
+                for (size_t l = 0; l < nLevels; ++l) {
+                    const long first = levelStart[l];
+                    const long last = levelStart[l + 1];
+#ifdef _OPENMP
+#   pragma omp for schedule(dynamic)
+#endif
+                    for (long i = first; i < last; ++i) {
+                        const uint32_t c = byLevel[i];
+                        if (!readIfMapped(members[start[c]], dir))
+                            buildComponent(c, &members[0] + start[c],
+                                           &members[0] + start[c + 1], dir,
+                                           lastSeen);
+                    }
+                }
+            }
+        }
+
+        /**
+         * Build all indexes of specified type as the transposition of all
+         * indexes of the other type, which are built first if needed. Vertex
+         * u is in the IN index of w if and only if w is in the OUT index of
+         * u, so no traversal of the graph is needed. Indexes of the specified
+         * type built so far are dropped.
+         *
+         * With the default storage, the matrix of indexes is transposed in
+         * blocks of 64x64 bits, which are visited in tiles of 512x512 bits so
+         * that both matrices are read and written by whole cache lines.
+         * Blocks without any bit set are skipped. It costs O(N * N / W) no
+         * matter how many edges there are, while build(EDirection) costs
+         * O(N * E' / W). Other storages are built by build(EDirection)
+         * instead, their bits would have to be set one by one.
+         * @param dir Type of indexes to compute (IN or OUT).
+         */
+        void transpose(EDirection dir) {
+            this->transposeAll(storage_[dir], dir);
         }
 
         /**
@@ -168,26 +482,422 @@ class BitmapIndexer {
          */
         void clear(EDirection dir) {
             storage_[dir].clear();
+            this->clearMapped(dir);
+        }
+
+        /**
+         * @return Return true if indexes of all vertices of the given type
+         * are built (or available in a loaded image).
+         */
+        bool isComplete(EDirection dir) const {
+            const TCompList &compOf = this->components();
+            const TIndexList &list = storage_[dir];
+            const TMappedRows &mapped = mapped_[dir];
+            const size_t nVert = num_vertices(graph_);
+            for (TVertex v = 0; v < nVert; ++v)
+                if (!isBuilt(list, compOf[v])
+                        && BitmapIndexImpl::NO_ROW == mappedRow(mapped, v))
+                    return false;
+
+            return true;
+        }
+
+        /**
+         * @return Return count of bytes occupied by indexes built so far (not
+         * counting those of a session image which are not read yet).
+         */
+        size_t memoryUsage() const {
+            return TStorageOps::memoryUsage(storage_[IN])
+                + TStorageOps::memoryUsage(storage_[OUT]);
+        }
+
+        /**
+         * Write all indexes computed so far to an image (see Image.hh), tagged
+         * with the hash of the graph. Indexes of each type are stored as rows
+         * of words (as written by IndexStorage), a row for each indexed
+         * component, with the start of each row and the row of each vertex.
+         */
+        void save(ImageWriter &img) const {
+            using BitmapIndexImpl::NO_ROW;
+
+            const size_t nVert = num_vertices(graph_);
+            img.put(graphHash(graph_));
+            img.put(static_cast<boost::uint32_t>(TStorageOps::KIND));
+            this->components();
+
+            std::vector<TWord> words;
+            for (int dir = IN; dir <= OUT; ++dir) {
+                const TIndexList &list = storage_[dir];
+                const TMappedRows &mapped = mapped_[dir];
+
+                // vertex providing the row of each component
+                TCompList rowOf(nVert, NO_ROW);
+                TCompList rowOfComp(nComp_, NO_ROW);
+                TCompList rowSource;
+                std::vector<boost::uint64_t> rowStart(1, 0);
+                for (TVertex v = 0; v < nVert; ++v) {
+                    const boost::uint32_t c = compOf_[v];
+                    const boost::uint32_t r = mappedRow(mapped, v);
+                    if (NO_ROW == rowOfComp[c]) {
+                        size_t size;
+                        if (isBuilt(list, c))
+                            size = TStorageOps::words(list[c]);
+                        else if (NO_ROW != r)
+                            size = mapped.rowEnd(r) - mapped.rowBegin(r);
+                        else
+                            continue;
+
+                        rowOfComp[c] = rowSource.size();
+                        rowSource.push_back(v);
+                        rowStart.push_back(rowStart.back() + size);
+                    }
+                    rowOf[v] = rowOfComp[c];
+                }
+
+                img.putVector(rowOf);
+                img.putVector(rowStart);
+                img.beginArray(rowStart.back());
+                for (size_t row = 0; row < rowSource.size(); ++row) {
+                    const TVertex v = rowSource[row];
+                    const boost::uint32_t c = compOf_[v];
+                    if (isBuilt(list, c)) {
+                        words.clear();
+                        TStorageOps::save(list[c], words);
+                        img.append(&words[0], words.size());
+                    }
+                    else {
+                        const boost::uint32_t r = mappedRow(mapped, v);
+                        img.append(mapped.rowBegin(r),
+                                   mapped.rowEnd(r) - mapped.rowBegin(r));
+                    }
+                }
+            }
+        }
+
+        /**
+         * Read indexes previously written by save() for the same graph. All
+         * other indexes are freed. Indexes are not read until they are asked
+         * for, they are used in place till then, so the image has to stay
+         * mapped as long as the indexer is used (or cleared).
+         * @return Return false if the image does not contain indexes of a
+         * graph of the same hash (see graphHash()), or their storage is of
+         * another kind.
+         */
+        bool load(ImageReader &img) {
+            using BitmapIndexImpl::NO_ROW;
+
+            this->clear();
+            const size_t nVert = num_vertices(graph_);
+            boost::uint64_t hash;
+            boost::uint32_t kind;
+            if (!img.get(hash) || hash != graphHash(graph_) || !img.get(kind)
+                    || kind != static_cast<boost::uint32_t>(TStorageOps::KIND))
+                return false;
+
+            bool ok = true;
+            for (int dir = IN; ok && dir <= OUT; ++dir) {
+                TMappedRows &mapped = mapped_[dir];
+                size_t nRowOf, nRowStart, nWords;
+                ok = img.view(mapped.rowOf, nRowOf) && nRowOf == nVert
+                    && img.view(mapped.rowStart, nRowStart) && nRowStart
+                    && img.view(mapped.words, nWords)
+                    && mapped.rowStart[0] == 0
+                    && mapped.rowStart[nRowStart - 1] == nWords;
+
+                mapped.nRows = (ok) ? nRowStart - 1 : 0;
+                for (size_t row = 0; ok && row < mapped.nRows; ++row)
+                    ok = mapped.rowStart[row] <= mapped.rowStart[row + 1];
+
+                for (TVertex v = 0; ok && v < nVert; ++v) {
+                    const size_t row = mapped.rowOf[v];
+                    ok = NO_ROW == row || row < mapped.nRows;
+                }
+            }
+
+            if (!ok)
+                this->clear();
+
+            return ok;
         }
 
     private:
-        typedef typename std::vector<TIndex>            TIndexList;
+        typedef IndexStorage<TIndex>                    TStorageOps;
+        typedef typename TStorageOps::TList             TIndexList;
+        typedef typename TStorageOps::TWord             TWord;
+        typedef std::vector<boost::uint32_t>            TCompList;
 
-        const TGraph    &graph_;
-        TIndexList      storage_[2];
+        /// indexes of a session image, used in place until asked for
+        struct TMappedRows {
+            const boost::uint32_t   *rowOf;     ///< row of each vertex
+            const boost::uint64_t   *rowStart;  ///< first word of each row
+            const TWord             *words;     ///< rows of words
+            size_t                  nRows;
+
+            const TWord* rowBegin(boost::uint32_t row) const {
+                return words + rowStart[row];
+            }
+
+            const TWord* rowEnd(boost::uint32_t row) const {
+                return words + rowStart[row + 1];
+            }
+        };
+
+        const TGraph        &graph_;
+        mutable TCompList   compOf_;    ///< component of each vertex
+        mutable size_t      nComp_;
+        TIndexList          storage_[2];    ///< index of each component
+        TMappedRows         mapped_[2];
 
     private:
+        /// find strongly connected components if not done yet
+        const TCompList& components() const {
+            if (compOf_.size() != num_vertices(graph_))
+                nComp_ = strongComponents(graph_, compOf_);
+
+            return compOf_;
+        }
+
+        const TCompList& initStorage(EDirection dir) {
+            const TCompList &compOf = this->components();
+            TIndexList &list = storage_[dir];
+            if (list.size() != nComp_)
+                TStorageOps::init(list, nComp_, num_vertices(graph_));
+
+            return compOf;
+        }
+
+        void clearMapped(EDirection dir) {
+            TMappedRows &mapped = mapped_[dir];
+            mapped.rowOf = 0;
+            mapped.rowStart = 0;
+            mapped.words = 0;
+            mapped.nRows = 0;
+        }
+
+        bool isBuilt(const TIndexList &list, boost::uint32_t comp) const {
+            return comp < list.size()
+                && list[comp].size() == num_vertices(graph_);
+        }
+
+        /// @return Return row of the vertex in the session image, or NO_ROW
+        boost::uint32_t mappedRow(const TMappedRows &mapped, TVertex vertex)
+            const
+        {
+            if (!mapped.rowOf)
+                return BitmapIndexImpl::NO_ROW;
+
+            return mapped.rowOf[vertex];
+        }
+
+        /// read index of the given vertex from the session image if it is there
+        bool readIfMapped(TVertex vertex, EDirection dir) {
+            TIndex &index = storage_[dir][compOf_[vertex]];
+            const size_t nVert = num_vertices(graph_);
+            if (index.size() == nVert)
+                return true;
+
+            const TMappedRows &mapped = mapped_[dir];
+            const boost::uint32_t row = mappedRow(mapped, vertex);
+            if (BitmapIndexImpl::NO_ROW == row)
+                return false;
+
+            if (TStorageOps::load(index, nVert, mapped.rowBegin(row),
+                                  mapped.rowEnd(row)))
+                return true;
+
+            // damaged row, build the index instead
+            index.clear();
+            return false;
+        }
+
         void buildIfNeeded(TVertex vertex, EDirection dir) {
-            size_t nVert = boost::num_vertices(graph_);
+            if (readIfMapped(vertex, dir))
+                return;
+
+            // build index
+            TIndex &index = storage_[dir][compOf_[vertex]];
+            index.resize(num_vertices(graph_), false);
+            BitmapIndexer::build(vertex, dir);
+            TStorageOps::shrink(index);
+        }
+
+        /**
+         * compute level of each component, a component without neighbors (in
+         * the given direction) has level 0, others are one above the highest
+         * neighbor
+         * @return Return count of levels.
+         */
+        size_t levels(EDirection dir, const TCompList &start,
+                      const TCompList &members, TCompList &level) const
+        {
+            using namespace boost;
+
+            // components are numbered callees first
+            size_t nLevels = 0;
+            level.assign(nComp_, 0);
+            for (size_t i = 0; i < nComp_; ++i) {
+                const uint32_t c = (OUT == dir) ? i : nComp_ - 1 - i;
+                uint32_t &lc = level[c];
+                for (uint32_t m = start[c]; m < start[c + 1]; ++m) {
+                    const TVertex current = members[m];
+                    if (dir == IN) {
+                        typename Traits::in_edge_iterator ii, ii_end;
+                        for(tie(ii, ii_end) = in_edges(current, graph_);
+                                ii != ii_end; ++ii)
+                        {
+                            const uint32_t d = compOf_[source(*ii, graph_)];
+                            if (d != c)
+                                lc = std::max(lc, level[d] + 1);
+                        }
+                    } else {
+                        typename Traits::out_edge_iterator oi, oi_end;
+                        for(tie(oi, oi_end) = out_edges(current, graph_);
+                                oi != oi_end; ++oi)
+                        {
+                            const uint32_t d = compOf_[target(*oi, graph_)];
+                            if (d != c)
+                                lc = std::max(lc, level[d] + 1);
+                        }
+                    }
+                }
+                nLevels = std::max<size_t>(nLevels, lc + 1);
+            }
+
+            return nLevels;
+        }
+
+        /**
+         * build index of one component from indexes of its neighbors, which
+         * have to be built already
+         * @param comp Component to build index for.
+         * @param first,last Vertices of the component.
+         * @param dir Type of index to build (IN or OUT).
+         * @param lastSeen Last component whose index has used the neighbor,
+         * kept between calls so that it needs no clearing.
+         */
+        void buildComponent(boost::uint32_t comp, const boost::uint32_t *first,
+                            const boost::uint32_t *last, EDirection dir,
+                            TCompList &lastSeen)
+        {
+            using namespace boost;
+
             TIndexList &list = storage_[dir];
+            TIndex &index = list[comp];
+            index.resize(num_vertices(graph_), false);
 
-            // check if index is available
-            TIndex &index = list[vertex];
-            if (index.size() != nVert) {
-                // build index
-                index.resize(nVert, false);
-                BitmapIndexer::build(vertex, dir);
+            bool cyclic = false;
+            for (const boost::uint32_t *i = first; i != last; ++i) {
+                const TVertex current = *i;
+                if (dir == IN) {
+                    typename Traits::in_edge_iterator ii, ii_end;
+                    for(tie(ii, ii_end) = in_edges(current, graph_);
+                            ii != ii_end; ++ii)
+                        cyclic |= addNeighbor(index, comp,
+                                              source(*ii, graph_), dir,
+                                              lastSeen);
+                } else {
+                    typename Traits::out_edge_iterator oi, oi_end;
+                    for(tie(oi, oi_end) = out_edges(current, graph_);
+                            oi != oi_end; ++oi)
+                        cyclic |= addNeighbor(index, comp,
+                                              target(*oi, graph_), dir,
+                                              lastSeen);
+                }
+            }
+
+            if (cyclic) {
+                // all vertices of a cycle reach each other (and themselves)
+                for (; first != last; ++first)
+                    index.set(*first);
             }
+
+            TStorageOps::shrink(index);
+        }
+
+        template <typename TList>
+        void transposeAll(TList &, EDirection dir) {
+            BitmapIndexer::build(dir);
+        }
+
+        /// transpose rows of the bit matrix of the other type, see transpose()
+        void transposeAll(BitMatrix &dst, EDirection dir) {
+            using namespace BitMatrixImpl;
+            const EDirection other = (IN == dir) ? OUT : IN;
+            BitmapIndexer::build(other);
+            BitmapIndexer::clear(dir);
+            this->initStorage(dir);
+            TStorageOps::willBuildAll(dst);
+
+            const BitMatrix &src = storage_[other];
+            const size_t nVert = num_vertices(graph_);
+            const size_t nWords = BitRow::paddedWords(nVert);
+            if (!nWords)
+                return;
+
+            // bits of the index of a component come from its first member
+            TCompList first(nComp_);
+            for (TVertex v = nVert; v--; )
+                first[compOf_[v]] = v;
+
+            // row of each vertex to read, vertices above nVert read zeros
+            const std::vector<TWord> zeros(nWords, 0);
+            std::vector<const TWord *> srcOf(nWords * WORD_BITS, &zeros[0]);
+            for (TVertex v = 0; v < nVert; ++v)
+                srcOf[v] = src[compOf_[v]].data();
+
+            // row of each vertex to write, only first members have one
+            std::vector<TWord *> dstOf(nWords * WORD_BITS, 0);
+            for (size_t c = 0; c < nComp_; ++c) {
+                BitRow &row = dst[c];
+                row.resize(nVert);
+                dstOf[first[c]] = row.data();
+            }
+
+            // block (i, j) of the source goes to block (j, i), words of a
+            // tile make a cache line of each row of both blocks
+            const long nTiles = nWords / ROW_ALIGN_WORDS;
+#ifdef _OPENMP
+#   pragma omp parallel for schedule(dynamic)
+#endif
+            for (long tile = 0; tile < nTiles; ++tile) {
+                TWord block[WORD_BITS];
+                for (size_t j0 = 0; j0 < nWords; j0 += ROW_ALIGN_WORDS) {
+                    const size_t i0 = tile * ROW_ALIGN_WORDS;
+                    for (size_t i = i0; i < i0 + ROW_ALIGN_WORDS; ++i) {
+                        const TWord *const *rows = &srcOf[i * WORD_BITS];
+                        for (size_t j = j0; j < j0 + ROW_ALIGN_WORDS; ++j) {
+                            TWord any = 0;
+                            for (size_t k = 0; k < WORD_BITS; ++k)
+                                any |= block[k] = rows[k][j];
+                            if (!any)
+                                continue;
+
+                            transpose64(block);
+                            TWord *const *out = &dstOf[j * WORD_BITS];
+                            for (size_t k = 0; k < WORD_BITS; ++k)
+                                if (out[k])
+                                    out[k][i] = block[k];
+                        }
+                    }
+                }
+            }
+        }
+
+        /// @return Return true if the neighbor is in the same component
+        bool addNeighbor(TIndex &index, boost::uint32_t comp, TVertex next,
+                         EDirection dir, TCompList &lastSeen)
+        {
+            const boost::uint32_t nextComp = compOf_[next];
+            if (nextComp == comp)
+                return true;
+
+            index.set(next);
+            if (lastSeen[nextComp] != comp) {
+                lastSeen[nextComp] = comp;
+                index |= storage_[dir][nextComp];
+            }
+
+            return false;
         }
 
         /**
@@ -199,12 +909,12 @@ class BitmapIndexer {
             using namespace boost;
 
             // check range
-            size_t nVert = boost::num_vertices(graph_);
+            size_t nVert = num_vertices(graph_);
             assert(vertex < nVert);
 
             // obtain index reference
             TIndexList &list = storage_[dir];
-            TIndex &index = list[vertex];
+            TIndex &index = list[compOf_[vertex]];
 
             // working stack
             typedef typename std::stack<TVertex> TStack;
@@ -224,12 +934,12 @@ class BitmapIndexer {
                             ii != ii_end; ++ii)
                     {
                         TVertex next = source(*ii, graph_);
-                        if (!index[next])
+                        if (!index.test(next))
                             // schedule vertex for next wheel
                             stack.push(next);
 
                         // mark vertex as reachable
-                        index[next] = true;
+                        index.set(next);
                     }
                 } else {
                     // for all successors
@@ -238,12 +948,12 @@ class BitmapIndexer {
                         ii != ii_end; ++ii)
                     {
                         TVertex next = target(*ii, graph_);
-                        if (!index[next])
+                        if (!index.test(next))
                             // schedule vertex for next wheel
                             stack.push(next);
 
                         // mark vertex as reachable
-                        index[next] = true;
+                        index.set(next);
                     }
                 }
             }
@@ -279,7 +989,16 @@ class BitmapVertexPredicate {
         BitmapVertexPredicate(const TGraph &graph, const TBitmap &bitmap):
             bitmap_(bitmap)
         {
-            assert(bitmap.size() == boost::num_vertices(graph));
+            assert(bitmap.size() == num_vertices(graph));
+        }
+
+        /**
+         * @graph Original graph ought to be filtered.
+         * @param index Index (of BitmapIndexer) to use as predicate.
+         */
+        BitmapVertexPredicate(const TGraph &graph, const BitRow &index) {
+            copyIndex(bitmap_, index);
+            assert(bitmap_.size() == num_vertices(graph));
         }
 
         /**
@@ -293,12 +1012,12 @@ class BitmapVertexPredicate {
          * @param dst Destination vertex.
          */
         template <typename TBitmapIndexer>
-        BitmapVertexPredicate(TBitmapIndexer &indexer, TVertex src, TVertex dst):
-            bitmap_(indexer.index(src, TBitmapIndexer::OUT))
+        BitmapVertexPredicate(TBitmapIndexer &indexer, TVertex src, TVertex dst)
         {
-            bitmap_ &= indexer.index(dst, TBitmapIndexer::IN);
-            bitmap_ [src] = true;
-            bitmap_ [dst] = true;
+            intersectIndexes(bitmap_, indexer.index(src, TBitmapIndexer::OUT),
+                             indexer.index(dst, TBitmapIndexer::IN));
+            bitmap_.set(src);
+            bitmap_.set(dst);
         }
 
         /**
@@ -346,6 +1065,15 @@ class BitmapFilter:
             assert(num_vertices(graph) == bitmap.size());
         }
 
+        /**
+         * @graph Original graph ought to be filtered.
+         * @param index Index (of BitmapIndexer) to use as predicate.
+         */
+        BitmapFilter(const TGraph &graph, const BitRow &index):
+            TFilter(graph, TPred(graph, index))
+        {
+        }
+
         /**
          * This creates special kind of factor where:
          * 1. all vertices are reachable from the src vertex
@@ -363,4 +1091,13 @@ class BitmapFilter:
         }
 };
 
+namespace boost {
+    /// property maps of BitmapFilter are those of the original graph
+    template <typename TGraph, typename TTag>
+    struct property_map<BitmapFilter<TGraph>, TTag>:
+        public property_map<TGraph, TTag>
+    {
+    };
+}
+
 #endif // BITMAP_INDEX_H
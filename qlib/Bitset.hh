@@ -0,0 +1,592 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BITSET_H
+#define BITSET_H
+
+#include "config.hh"
+
+/**
+ * If set to 1, bitwise operations and counting of long bitsets use AVX2 or
+ * AVX-512 if the processor has them (checked at run time, the rest of the
+ * program does not need to be built for them). Other targets than x86 with
+ * GCC compatible compilers always use the portable loops.
+ */
+#ifndef BITSET_SIMD
+#   define BITSET_SIMD 1
+#endif
+
+#if BITSET_SIMD && !(defined(__GNUC__) && defined(__x86_64__))
+#   undef BITSET_SIMD
+#   define BITSET_SIMD 0
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iterator>
+#include <new>
+
+#include <boost/cstdint.hpp>
+
+#if BITSET_SIMD
+#   include <immintrin.h>
+#endif
+
+/**
+ * Word kernels shared by Bitset and BitRow (see BitMatrix.hh), which keep
+ * their bits in the same layout: words start on a cache line and they are
+ * padded to whole cache lines with zeros, so that the kernels run over whole
+ * vector registers with no tail to care about.
+ */
+namespace BitsetImpl {
+    typedef boost::uint64_t                             TWord;
+
+    const size_t WORD_BITS = 64;
+
+    /// words are kept in blocks of a cache line (an AVX-512 register)
+    const size_t ALIGN = 64;
+    const size_t BLOCK_WORDS = ALIGN / sizeof(TWord);
+
+    inline unsigned popCount(TWord word) {
+        return __builtin_popcountll(word);
+    }
+
+    /// count of trailing zeros (tzcnt), the word must not be zero
+    inline unsigned lowestBit(TWord word) {
+        return __builtin_ctzll(word);
+    }
+
+    /// @return Return count of words of the given count of bits, padded
+    inline size_t paddedWords(size_t nBits) {
+        const size_t n = (nBits + WORD_BITS - 1) / WORD_BITS;
+        return (n + BLOCK_WORDS - 1) / BLOCK_WORDS * BLOCK_WORDS;
+    }
+
+    /**
+     * @return Return position of the first bit set at pos or above among
+     * nBits bits, or npos if there is none. Set bits are found a word at a
+     * time by counting trailing zeros.
+     */
+    inline size_t findFrom(const TWord *words, size_t nBits, size_t pos,
+                           size_t npos)
+    {
+        const size_t n = (nBits + WORD_BITS - 1) / WORD_BITS;
+        size_t i = pos / WORD_BITS;
+        if (n <= i)
+            return npos;
+
+        TWord word = words[i] & (~TWord(0) << (pos % WORD_BITS));
+        while (!word) {
+            if (++i == n)
+                return npos;
+            word = words[i];
+        }
+
+        return i * WORD_BITS + lowestBit(word);
+    }
+
+    /// tell the compiler the words are aligned
+    inline TWord* aligned(TWord *words) {
+        return static_cast<TWord *>(__builtin_assume_aligned(words, ALIGN));
+    }
+
+    inline const TWord* aligned(const TWord *words) {
+        return static_cast<const TWord *>(
+                __builtin_assume_aligned(words, ALIGN));
+    }
+
+    // portable kernels, n is a multiple of BLOCK_WORDS, dst may be a or b
+
+    inline void orWordsPlain(TWord *dst, const TWord *a, const TWord *b,
+                             size_t n)
+    {
+        dst = aligned(dst);
+        a = aligned(a);
+        b = aligned(b);
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = a[i] | b[i];
+    }
+
+    inline void andWordsPlain(TWord *dst, const TWord *a, const TWord *b,
+                              size_t n)
+    {
+        dst = aligned(dst);
+        a = aligned(a);
+        b = aligned(b);
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = a[i] & b[i];
+    }
+
+    inline void andNotWordsPlain(TWord *dst, const TWord *a, const TWord *b,
+                                 size_t n)
+    {
+        dst = aligned(dst);
+        a = aligned(a);
+        b = aligned(b);
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = a[i] & ~b[i];
+    }
+
+    inline size_t countWordsPlain(const TWord *words, size_t n) {
+        size_t cnt = 0;
+        for (size_t i = 0; i < n; ++i)
+            cnt += popCount(words[i]);
+        return cnt;
+    }
+
+#if BITSET_SIMD
+    // AVX2 kernels, words aligned to ALIGN
+
+    __attribute__((target("avx2")))
+    inline void orWordsAvx2(TWord *dst, const TWord *a, const TWord *b,
+                            size_t n)
+    {
+        for (size_t i = 0; i < n; i += 4) {
+            const __m256i x = _mm256_load_si256((const __m256i *)(a + i));
+            const __m256i y = _mm256_load_si256((const __m256i *)(b + i));
+            _mm256_store_si256((__m256i *)(dst + i), _mm256_or_si256(x, y));
+        }
+    }
+
+    __attribute__((target("avx2")))
+    inline void andWordsAvx2(TWord *dst, const TWord *a, const TWord *b,
+                             size_t n)
+    {
+        for (size_t i = 0; i < n; i += 4) {
+            const __m256i x = _mm256_load_si256((const __m256i *)(a + i));
+            const __m256i y = _mm256_load_si256((const __m256i *)(b + i));
+            _mm256_store_si256((__m256i *)(dst + i), _mm256_and_si256(x, y));
+        }
+    }
+
+    __attribute__((target("avx2")))
+    inline void andNotWordsAvx2(TWord *dst, const TWord *a, const TWord *b,
+                                size_t n)
+    {
+        for (size_t i = 0; i < n; i += 4) {
+            const __m256i x = _mm256_load_si256((const __m256i *)(a + i));
+            const __m256i y = _mm256_load_si256((const __m256i *)(b + i));
+            _mm256_store_si256((__m256i *)(dst + i),
+                               _mm256_andnot_si256(y, x));
+        }
+    }
+
+    /// bits of each nibble are looked up by a byte shuffle, bytes are summed
+    __attribute__((target("avx2")))
+    inline size_t countWordsAvx2(const TWord *words, size_t n) {
+        const __m256i lookup = _mm256_setr_epi8(
+                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i nibble = _mm256_set1_epi8(0x0F);
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i sum = zero;
+        for (size_t i = 0; i < n; i += 4) {
+            const __m256i x = _mm256_load_si256((const __m256i *)(words + i));
+            const __m256i lo = _mm256_and_si256(x, nibble);
+            const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4),
+                                                nibble);
+            const __m256i cnt = _mm256_add_epi8(
+                    _mm256_shuffle_epi8(lookup, lo),
+                    _mm256_shuffle_epi8(lookup, hi));
+            sum = _mm256_add_epi64(sum, _mm256_sad_epu8(cnt, zero));
+        }
+
+        return _mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1)
+            + _mm256_extract_epi64(sum, 2) + _mm256_extract_epi64(sum, 3);
+    }
+
+    // AVX-512 kernels, a block of words at a time
+
+    __attribute__((target("avx512f")))
+    inline void orWordsAvx512(TWord *dst, const TWord *a, const TWord *b,
+                              size_t n)
+    {
+        for (size_t i = 0; i < n; i += BLOCK_WORDS)
+            _mm512_store_si512(dst + i, _mm512_or_si512(
+                        _mm512_load_si512(a + i), _mm512_load_si512(b + i)));
+    }
+
+    __attribute__((target("avx512f")))
+    inline void andWordsAvx512(TWord *dst, const TWord *a, const TWord *b,
+                               size_t n)
+    {
+        for (size_t i = 0; i < n; i += BLOCK_WORDS)
+            _mm512_store_si512(dst + i, _mm512_and_si512(
+                        _mm512_load_si512(a + i), _mm512_load_si512(b + i)));
+    }
+
+    /// b is complemented by XOR, which the compiler folds into vpandn;
+    /// GCC 12 warns about the mask operand of _mm512_andnot_si512
+    __attribute__((target("avx512f")))
+    inline void andNotWordsAvx512(TWord *dst, const TWord *a, const TWord *b,
+                                  size_t n)
+    {
+        const __m512i ones = _mm512_set1_epi64(-1);
+        for (size_t i = 0; i < n; i += BLOCK_WORDS)
+            _mm512_store_si512(dst + i, _mm512_and_si512(
+                        _mm512_load_si512(a + i),
+                        _mm512_xor_si512(_mm512_load_si512(b + i), ones)));
+    }
+
+    __attribute__((target("avx512f,avx512vpopcntdq")))
+    inline size_t countWordsAvx512(const TWord *words, size_t n) {
+        __m512i sum = _mm512_setzero_si512();
+        for (size_t i = 0; i < n; i += BLOCK_WORDS)
+            sum = _mm512_add_epi64(sum,
+                    _mm512_popcnt_epi64(_mm512_load_si512(words + i)));
+
+        TWord lanes[BLOCK_WORDS] __attribute__((aligned(ALIGN)));
+        _mm512_store_si512(lanes, sum);
+        size_t total = 0;
+        for (size_t i = 0; i < BLOCK_WORDS; ++i)
+            total += lanes[i];
+
+        return total;
+    }
+
+    /// vector extensions of the processor the kernels can use
+    enum ESimd {
+        SIMD_NONE,
+        SIMD_AVX2,          ///< AVX2
+        SIMD_AVX512,        ///< AVX-512F (AVX2 for counting)
+        SIMD_AVX512_POPCNT  ///< AVX-512F and AVX-512 VPOPCNTDQ
+    };
+
+    inline ESimd detectSimd() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return (__builtin_cpu_supports("avx512vpopcntdq"))
+                ? SIMD_AVX512_POPCNT
+                : SIMD_AVX512;
+        }
+
+        return (__builtin_cpu_supports("avx2")) ? SIMD_AVX2 : SIMD_NONE;
+    }
+
+    /// the processor is checked once
+    inline ESimd simd() {
+        static const ESimd level = detectSimd();
+        return level;
+    }
+#endif // BITSET_SIMD
+
+    /// dst = a | b
+    inline void orWords(TWord *dst, const TWord *a, const TWord *b, size_t n) {
+#if BITSET_SIMD
+        const ESimd level = simd();
+        if (SIMD_AVX512 <= level)
+            return orWordsAvx512(dst, a, b, n);
+        if (SIMD_AVX2 == level)
+            return orWordsAvx2(dst, a, b, n);
+#endif
+        orWordsPlain(dst, a, b, n);
+    }
+
+    /// dst = a & b
+    inline void andWords(TWord *dst, const TWord *a, const TWord *b, size_t n)
+    {
+#if BITSET_SIMD
+        const ESimd level = simd();
+        if (SIMD_AVX512 <= level)
+            return andWordsAvx512(dst, a, b, n);
+        if (SIMD_AVX2 == level)
+            return andWordsAvx2(dst, a, b, n);
+#endif
+        andWordsPlain(dst, a, b, n);
+    }
+
+    /// dst = a & ~b
+    inline void andNotWords(TWord *dst, const TWord *a, const TWord *b,
+                            size_t n)
+    {
+#if BITSET_SIMD
+        const ESimd level = simd();
+        if (SIMD_AVX512 <= level)
+            return andNotWordsAvx512(dst, a, b, n);
+        if (SIMD_AVX2 == level)
+            return andNotWordsAvx2(dst, a, b, n);
+#endif
+        andNotWordsPlain(dst, a, b, n);
+    }
+
+    /// @return Return count of bits set in the words
+    inline size_t countWords(const TWord *words, size_t n) {
+#if BITSET_SIMD
+        const ESimd level = simd();
+        if (SIMD_AVX512_POPCNT == level)
+            return countWordsAvx512(words, n);
+        if (SIMD_NONE != level)
+            return countWordsAvx2(words, n);
+#endif
+        return countWordsPlain(words, n);
+    }
+
+    /// @return Return true if any of the words is not zero
+    inline bool anyWords(const TWord *words, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            if (words[i])
+                return true;
+        return false;
+    }
+}
+
+/**
+ * Bitset of vertices, the interface follows boost::dynamic_bitset (size(),
+ * resize(), test(), set(), count(), find_next(), operator|=, ...) as far as
+ * the predicates, the Python binding and the tests need it. Words are laid
+ * out like rows of BitMatrix (see BitsetImpl), so that bitwise operations and
+ * counting run over whole vector registers, and indexes are copied from rows
+ * word by word. Bits above size() are always clear.
+ */
+class Bitset {
+    public:
+        typedef BitsetImpl::TWord                       TWord;
+
+        /// used by RoaringBitmap::copyTo(), as of boost::dynamic_bitset
+        typedef TWord                                   block_type;
+        static const size_t bits_per_block = BitsetImpl::WORD_BITS;
+
+        /// returned by find_first() and find_next() if there is no bit set
+        static const size_t npos = static_cast<size_t>(-1);
+
+    public:
+        Bitset():
+            words_(0),
+            size_(0),
+            nWords_(0)
+        {
+        }
+
+        explicit Bitset(size_t size, bool value = false):
+            words_(0),
+            size_(0),
+            nWords_(0)
+        {
+            this->resize(size, value);
+        }
+
+        /// bits of the given words, size is the count of words times 64
+        template <typename TIter>
+        Bitset(TIter first, TIter last):
+            words_(0),
+            size_(0),
+            nWords_(0)
+        {
+            this->resize(std::distance(first, last) * BitsetImpl::WORD_BITS);
+            std::copy(first, last, words_);
+        }
+
+        Bitset(const Bitset &other):
+            words_(0),
+            size_(0),
+            nWords_(0)
+        {
+            this->assign(other.words_, other.size_);
+        }
+
+        ~Bitset() {
+            std::free(words_);
+        }
+
+        Bitset& operator=(Bitset other) {
+            this->swap(other);
+            return *this;
+        }
+
+        void swap(Bitset &other) {
+            std::swap(words_, other.words_);
+            std::swap(size_, other.size_);
+            std::swap(nWords_, other.nWords_);
+        }
+
+        size_t size() const {
+            return size_;
+        }
+
+        /// @return Return count of words, including the padding
+        size_t num_blocks() const {
+            return nWords_;
+        }
+
+        TWord* data() {
+            return words_;
+        }
+
+        const TWord* data() const {
+            return words_;
+        }
+
+        /**
+         * Change count of bits, bits kept keep their values, new bits get the
+         * given value.
+         */
+        void resize(size_t size, bool value = false) {
+            using BitsetImpl::WORD_BITS;
+            const size_t nWords = BitsetImpl::paddedWords(size);
+            if (nWords != nWords_) {
+                TWord *words = Bitset::allocate(nWords);
+                const size_t nKept = std::min(nWords, nWords_);
+                std::copy(words_, words_ + nKept, words);
+                std::fill(words + nKept, words + nWords, 0);
+                std::free(words_);
+                words_ = words;
+                nWords_ = nWords;
+            }
+
+            if (value && size_ < size) {
+                // set the bits from the old size to the new one
+                size_t i = size_ / WORD_BITS;
+                if (size_ % WORD_BITS)
+                    words_[i++] |= ~TWord(0) << (size_ % WORD_BITS);
+                std::fill(words_ + i, words_ + nWords, ~TWord(0));
+            }
+
+            size_ = size;
+            this->clearPadding();
+        }
+
+        /// drop all bits
+        void clear() {
+            Bitset().swap(*this);
+        }
+
+        /// take size bits of the given words, padded like the words of Bitset
+        Bitset& assign(const TWord *words, size_t size) {
+            this->resize(size);
+            std::copy(words, words + nWords_, words_);
+            return *this;
+        }
+
+        /// take bitwise and of the given words, see assign()
+        Bitset& assignAnd(const TWord *a, const TWord *b, size_t size) {
+            this->resize(size);
+            BitsetImpl::andWords(words_, a, b, nWords_);
+            return *this;
+        }
+
+        bool test(size_t pos) const {
+            assert(pos < size_);
+            return (words_[pos / BitsetImpl::WORD_BITS]
+                    >> (pos % BitsetImpl::WORD_BITS)) & 1;
+        }
+
+        bool operator[](size_t pos) const {
+            return this->test(pos);
+        }
+
+        Bitset& set(size_t pos, bool value = true) {
+            assert(pos < size_);
+            const TWord bit = TWord(1) << (pos % BitsetImpl::WORD_BITS);
+            TWord &word = words_[pos / BitsetImpl::WORD_BITS];
+            if (value)
+                word |= bit;
+            else
+                word &= ~bit;
+            return *this;
+        }
+
+        Bitset& reset(size_t pos) {
+            return this->set(pos, false);
+        }
+
+        /// clear all bits
+        Bitset& reset() {
+            std::fill(words_, words_ + nWords_, 0);
+            return *this;
+        }
+
+        size_t count() const {
+            return BitsetImpl::countWords(words_, nWords_);
+        }
+
+        bool any() const {
+            return BitsetImpl::anyWords(words_, nWords_);
+        }
+
+        bool none() const {
+            return !this->any();
+        }
+
+        size_t find_first() const {
+            return BitsetImpl::findFrom(words_, size_, 0, npos);
+        }
+
+        size_t find_next(size_t pos) const {
+            return (pos + 1 < size_)
+                ? BitsetImpl::findFrom(words_, size_, pos + 1, npos)
+                : npos;
+        }
+
+        Bitset& operator|=(const Bitset &other) {
+            assert(size_ == other.size_);
+            BitsetImpl::orWords(words_, words_, other.words_, nWords_);
+            return *this;
+        }
+
+        Bitset& operator&=(const Bitset &other) {
+            assert(size_ == other.size_);
+            BitsetImpl::andWords(words_, words_, other.words_, nWords_);
+            return *this;
+        }
+
+        /// clear bits set in the other bitset, in one pass (no complement)
+        Bitset& operator-=(const Bitset &other) {
+            assert(size_ == other.size_);
+            BitsetImpl::andNotWords(words_, words_, other.words_, nWords_);
+            return *this;
+        }
+
+        friend bool operator==(const Bitset &a, const Bitset &b) {
+            return a.size_ == b.size_
+                && std::equal(a.words_, a.words_ + a.nWords_, b.words_);
+        }
+
+    private:
+        TWord           *words_;
+        size_t          size_;
+        size_t          nWords_;
+
+        /// allocate words aligned to a cache line
+        static TWord* allocate(size_t nWords) {
+            if (!nWords)
+                return 0;
+
+            void *words;
+            if (posix_memalign(&words, BitsetImpl::ALIGN,
+                               nWords * sizeof(TWord)))
+                throw std::bad_alloc();
+
+            return static_cast<TWord *>(words);
+        }
+
+        void clearPadding() {
+            using BitsetImpl::WORD_BITS;
+            const size_t used = (size_ + WORD_BITS - 1) / WORD_BITS;
+            if (size_ % WORD_BITS)
+                words_[used - 1] &= (TWord(1) << (size_ % WORD_BITS)) - 1;
+            std::fill(words_ + used, words_ + nWords_, 0);
+        }
+};
+
+inline bool operator!=(const Bitset &a, const Bitset &b) {
+    return !(a == b);
+}
+
+#endif // BITSET_H
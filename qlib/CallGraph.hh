@@ -21,124 +21,545 @@
 #define CALLGRAPH_H
 
 #include "config.hh"
+#include "FncTable.hh"
 
 #include <boost/graph/adjacency_list.hpp>
-#include <boost/shared_ptr.hpp>
+#include <boost/mpl/bool.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
-#include <map>
-#include <set>
-
-/// symbol location
-struct Location {
-    typedef boost::shared_ptr<std::string> PString;
-    PString         file;       ///< file name (shared string)
-    long            lineno;     ///< line number
-
-    Location():
-        file(new std::string),
-        lineno(-1)
-    {
-    }
-};
-inline bool operator==(Location &a, Location &b) {
-    return *(a.file) == *(b.file)
-        && a.lineno == b.lineno;
-}
-inline bool operator!=(Location &a, Location &b) {
-    return !operator==(a, b);
-}
+#include <vector>
 
-/// per-function data (vertex properties)
-struct Fnc {
-    std::string     name;       ///< function name (identifier)
-    Location        loc;        ///< symbol location
-    bool            isGlobal;   ///< true if symbol name is globally valid
-    bool            isDefined;  ///< true for definition, false for declaration
-
-    Fnc():
-        isGlobal(false),
-        isDefined(false)
-    {
-    }
+/// vertex property - function data, see FncTable
+struct FncProp {
+    typedef boost::vertex_property_tag kind;
 };
-typedef boost::shared_ptr<Fnc> PFnc;
 
-inline std::ostream &operator<< (std::ostream &str, PFnc fnc) {
-    if (!fnc->isDefined)
-        str << "@decl ";
+/**
+ * Property map of the FncProp vertex property. It gives a PFnc handle for
+ * given vertex and accepts either Fnc or PFnc (of any graph) on put.
+ */
+class FncMap {
+    public:
+        typedef boost::read_write_property_map_tag      category;
+        typedef size_t                                  key_type;
+        typedef PFnc                                    value_type;
+        typedef PFnc                                    reference;
 
-    if (!fnc->isGlobal)
-        str << "@static ";
+    public:
+        FncMap(): table_(0) { }
+        FncMap(FncTable &table): table_(&table) { }
 
-    str << fnc->name
-        << " (" << *(fnc->loc.file) << ":" << fnc->loc.lineno << ")";
+        FncTable& table() const {
+            return *table_;
+        }
 
-    return str;
+    private:
+        FncTable *table_;
+};
+inline PFnc get(const FncMap &map, size_t vertex) {
+    return PFnc(map.table(), vertex);
+}
+inline void put(const FncMap &map, size_t vertex, const Fnc &fnc) {
+    map.table().set(vertex, fnc);
+}
+inline void put(const FncMap &map, size_t vertex, const PFnc &fnc) {
+    map.table().set(vertex, fnc->table(), fnc->index());
 }
 
-/// vertex property - pointer to Fnc object
-struct FncProp {
-    typedef boost::vertex_property_tag kind;
+/**
+ * edge property - call location, interned in FncTable of the graph, see
+ * FncTable::callSite()
+ */
+struct CallProp {
+    typedef boost::edge_property_tag kind;
 };
-typedef boost::property<FncProp, PFnc> FncPropTag;
+typedef boost::property<CallProp, TCallSite> CallPropTag;
 
-/// edge property - call location (FIXME: not used now)
-struct CallProp {
+/// count of calls merged into a single edge
+typedef boost::uint32_t TCallCount;
+
+/// value of CallCountProp, edges added without the property count one call
+struct CallCount {
+    TCallCount n;
+
+    CallCount(TCallCount n_ = 1): n(n_) { }
+    operator TCallCount() const { return n; }
+};
+
+/**
+ * edge property - count of calls between the same caller and callee, see
+ * CallMerger
+ */
+struct CallCountProp {
     typedef boost::edge_property_tag kind;
 };
-typedef boost::property<CallProp, Location> CallPropTag;
+typedef boost::property<CallCountProp, CallCount> CallCountPropTag;
 
-/// call graph - defined as adjacency_list specialization
-typedef boost::adjacency_list<
+/**
+ * call graph - adjacency_list specialization, function data are not stored in
+ * vertices but in columns of FncTable
+ *
+ * Edges are kept in a vector rather than the default list, so that adding an
+ * edge does not allocate a list node. Edges are never removed from a call
+ * graph, which would be linear in the edge count then.
+ * @param TEdgeProp edge property, one of boost::no_property, CallCountPropTag
+ * or CallPropTag
+ */
+template <typename TEdgeProp>
+class BasicCallGraph: public boost::adjacency_list<
         boost::vecS,
         boost::vecS,
         boost::bidirectionalS,
-        FncPropTag,
-        CallPropTag>
-    CallGraph;
+        boost::no_property,
+        TEdgeProp,
+        boost::no_property,
+        boost::vecS>
+{
+    public:
+        FncTable& fncTable() {
+            return fncTable_;
+        }
+
+        const FncTable& fncTable() const {
+            return fncTable_;
+        }
+
+        /**
+         * Grow the graph to nVert vertices at once. Data of new vertices are
+         * whatever has been already put to their FncTable rows.
+         */
+        void resize(size_t nVert) {
+            this->m_vertices.resize(nVert);
+            fncTable_.resize(nVert);
+        }
+
+        /**
+         * Reserve space for out and in edges of the given vertex, so that
+         * adding them allocates nothing once reserveEdges() is called too.
+         */
+        void reserveCalls(size_t vertex, size_t nOut, size_t nIn) {
+            this->m_vertices[vertex].m_out_edges.reserve(nOut);
+            this->m_vertices[vertex].m_in_edges.reserve(nIn);
+        }
 
-/// write graph using given TWriter object
+        /**
+         * Reserve space for nEdges more edges in the edge list of the graph.
+         * The list at least doubles, so that edges added in many batches are
+         * copied only a few times.
+         */
+        void reserveEdges(size_t nEdges) {
+            const size_t need = this->m_edges.size() + nEdges;
+            const size_t cap = this->m_edges.capacity();
+            if (cap < need)
+                this->m_edges.reserve(std::max(need, 2 * cap));
+        }
+
+    private:
+        FncTable fncTable_;
+};
+
+/// call graph with one edge per caller-callee pair, the common case
+typedef BasicCallGraph<CallCountPropTag>                CallGraph;
+
+/// call graph keeping call-site location of each edge
+typedef BasicCallGraph<CallPropTag>                     CallSiteGraph;
+
+template <typename, template <typename> class> class VertexFilter;
+template <typename> class BitmapFilter;
+
+/// tells if the graph keeps call sites, i.e. has the CallProp edge property
+template <typename TGraph>
+struct HasCallSites: public boost::mpl::false_ { };
+
+template <>
+struct HasCallSites<CallSiteGraph>: public boost::mpl::true_ { };
+
+template <typename TGraph, template <typename> class TPred>
+struct HasCallSites<VertexFilter<TGraph, TPred> >:
+    public HasCallSites<TGraph> { };
+
+template <typename TGraph>
+struct HasCallSites<BitmapFilter<TGraph> >:
+    public HasCallSites<TGraph> { };
+
+/// tells if the graph counts calls, i.e. has the CallCountProp edge property
+template <typename TGraph>
+struct HasCallCounts: public boost::mpl::false_ { };
+
+template <>
+struct HasCallCounts<CallGraph>: public boost::mpl::true_ { };
+
+template <typename TGraph, template <typename> class TPred>
+struct HasCallCounts<VertexFilter<TGraph, TPred> >:
+    public HasCallCounts<TGraph> { };
+
+template <typename TGraph>
+struct HasCallCounts<BitmapFilter<TGraph> >:
+    public HasCallCounts<TGraph> { };
+
+namespace boost {
+    template <typename TEdgeProp>
+    struct property_map<BasicCallGraph<TEdgeProp>, FncProp> {
+        typedef FncMap type;
+        typedef FncMap const_type;
+    };
+
+    // the base class needs it too, as get(FncProp, adjacency_list) is
+    // otherwise ill-formed while resolving overloads of get()
+    template <typename TEdgeProp>
+    struct property_map<adjacency_list<vecS, vecS, bidirectionalS,
+                                       no_property, TEdgeProp, no_property,
+                                       vecS>, FncProp>
+    {
+        typedef FncMap type;
+        typedef FncMap const_type;
+    };
+}
+
+template <typename TEdgeProp>
+inline FncMap get(FncProp, BasicCallGraph<TEdgeProp> &graph) {
+    return FncMap(graph.fncTable());
+}
+template <typename TEdgeProp>
+inline FncMap get(FncProp, const BasicCallGraph<TEdgeProp> &graph) {
+    // FncMap is read-write, but put() is never used on const graphs
+    return FncMap(const_cast<FncTable &>(graph.fncTable()));
+}
+
+/// add vertex with the given function data
+template <typename TEdgeProp>
+inline typename BasicCallGraph<TEdgeProp>::vertex_descriptor
+add_vertex(const Fnc &fnc, BasicCallGraph<TEdgeProp> &g)
+{
+    typename BasicCallGraph<TEdgeProp>::vertex_descriptor v
+        = boost::add_vertex(g);
+    put(get(FncProp(), g), v, fnc);
+    return v;
+}
+
+/// add vertex with function data copied from another graph
+template <typename TEdgeProp>
+inline typename BasicCallGraph<TEdgeProp>::vertex_descriptor
+add_vertex(const PFnc &fnc, BasicCallGraph<TEdgeProp> &g)
+{
+    typename BasicCallGraph<TEdgeProp>::vertex_descriptor v
+        = boost::add_vertex(g);
+    put(get(FncProp(), g), v, fnc);
+    return v;
+}
+
+/// add call (edge) located at the given call site
+inline CallSiteGraph::edge_descriptor add_call(
+        CallSiteGraph::vertex_descriptor u,
+        CallSiteGraph::vertex_descriptor v,
+        const Location &site,
+        CallSiteGraph &g)
+{
+    return add_edge(u, v, g.fncTable().internCallSite(site), g).first;
+}
+
+/// location of the given call, empty if not known
+inline Location call_site(CallSiteGraph::edge_descriptor e,
+                          const CallSiteGraph &g)
+{
+    return g.fncTable().callSite(get(CallProp(), g, e));
+}
+
+template <typename TGraph, typename TEdge>
+inline TCallCount call_count(const TEdge &, const TGraph &, boost::mpl::false_)
+{
+    return 1;
+}
+
+template <typename TGraph, typename TEdge>
+inline TCallCount call_count(const TEdge &e, const TGraph &g, boost::mpl::true_)
+{
+    return get(CallCountProp(), g, e);
+}
+
+/// count of calls merged into the given edge, 1 if the graph does not count
+template <typename TGraph>
+inline TCallCount call_count(
+        const typename boost::graph_traits<TGraph>::edge_descriptor &e,
+        const TGraph &g)
+{
+    return call_count(e, g, HasCallCounts<TGraph>());
+}
+
+template <typename TGraph, typename TEdge>
+inline TCallSite call_site_id(const TEdge &, const TGraph &, boost::mpl::false_)
+{
+    return NO_CALL_SITE;
+}
+
+template <typename TGraph, typename TEdge>
+inline TCallSite call_site_id(const TEdge &e, const TGraph &g, boost::mpl::true_)
+{
+    return get(CallProp(), g, e);
+}
+
+/// call site of the given edge, NO_CALL_SITE if the graph does not keep them
+template <typename TGraph>
+inline TCallSite call_site_id(
+        const typename boost::graph_traits<TGraph>::edge_descriptor &e,
+        const TGraph &g)
+{
+    return call_site_id(e, g, HasCallSites<TGraph>());
+}
+
+/**
+ * Adds calls to BasicCallGraph. Unless the graph keeps call sites, there is at
+ * most one edge per caller-callee pair, so that traversals and path search see
+ * each pair once. Repeated calls only increase the count of the edge, if the
+ * graph counts calls (CallCountProp).
+ *
+ * Calls are collected by add() and added to the graph by flush(), which also
+ * reserves exact space in edge lists of vertices added since the last flush.
+ * Out edges keep order of the first call of each pair.
+ */
+template <typename TGraph>
+class CallMerger {
+    public:
+        typedef typename boost::graph_traits<TGraph>    Traits;
+        typedef typename Traits::vertex_descriptor      TVertex;
+        typedef typename Traits::edge_descriptor        TEdge;
+
+    public:
+        CallMerger(TGraph &graph):
+            graph_(graph),
+            gen_(0)
+        {
+        }
+
+        void add(TVertex src, TVertex dst, TCallCount count = 1,
+                 TCallSite site = NO_CALL_SITE)
+        {
+            calls_.push_back(Call(src, dst, count, site));
+        }
+
+        /**
+         * Add all collected calls to the graph.
+         * @param firstNew Vertices from this one on have no edges yet.
+         */
+        void flush(TVertex firstNew);
+
+    private:
+        struct Call {
+            TVertex     src;
+            TVertex     dst;
+            TCallCount  count;
+            TCallSite   site;
+
+            Call(TVertex src_, TVertex dst_, TCallCount count_,
+                 TCallSite site_):
+                src(src_), dst(dst_), count(count_), site(site_)
+            {
+            }
+        };
+        typedef std::vector<Call>                       TCallList;
+
+        /// last call to a vertex from the current caller
+        struct Mark {
+            size_t      gen;        ///< caller generation, see gen_
+            size_t      pos;        ///< position in out edges or merged list
+            bool        existing;   ///< true for an edge already in the graph
+
+            Mark(): gen(0), pos(0), existing(false) { }
+        };
+
+        static bool lessBySrc(const Call &a, const Call &b) {
+            return a.src < b.src;
+        }
+
+        void merge(TCallList &merged);
+        void addCount(TEdge, TCallCount, boost::mpl::false_) { }
+        void addCount(TEdge e, TCallCount count, boost::mpl::true_) {
+            get(CallCountProp(), graph_, e).n += count;
+        }
+        void addEdge(const Call &c, boost::mpl::false_, boost::mpl::false_) {
+            add_edge(c.src, c.dst, graph_);
+        }
+        void addEdge(const Call &c, boost::mpl::true_, boost::mpl::false_) {
+            add_edge(c.src, c.dst, CallCount(c.count), graph_);
+        }
+        void addEdge(const Call &c, boost::mpl::false_, boost::mpl::true_) {
+            add_edge(c.src, c.dst, c.site, graph_);
+        }
+
+    private:
+        TGraph              &graph_;
+        TCallList           calls_;
+        std::vector<Mark>   marks_;     ///< by callee vertex
+        size_t              gen_;
+};
+
+template <typename TGraph>
+void CallMerger<TGraph>::merge(TCallList &merged) {
+    using namespace boost;
+
+    // group by caller, each group keeps order of calls
+    std::stable_sort(calls_.begin(), calls_.end(), lessBySrc);
+    marks_.resize(num_vertices(graph_));
+    merged.reserve(calls_.size());
+
+    typename TCallList::const_iterator i = calls_.begin();
+    while (i != calls_.end()) {
+        const TVertex src = i->src;
+        ++gen_;
+
+        // mark calls already in the graph
+        typename Traits::out_edge_iterator oi, oi_end;
+        tie(oi, oi_end) = out_edges(src, graph_);
+        for (size_t pos = 0; oi != oi_end; ++oi, ++pos) {
+            Mark &m = marks_[target(*oi, graph_)];
+            m.gen = gen_;
+            m.pos = pos;
+            m.existing = true;
+        }
+
+        for (; i != calls_.end() && i->src == src; ++i) {
+            Mark &m = marks_[i->dst];
+            if (m.gen != gen_) {
+                // first call of the pair
+                m.gen = gen_;
+                m.pos = merged.size();
+                m.existing = false;
+                merged.push_back(*i);
+            } else if (m.existing) {
+                addCount(*(out_edges(src, graph_).first + m.pos), i->count,
+                         HasCallCounts<TGraph>());
+            } else {
+                merged[m.pos].count += i->count;
+            }
+        }
+    }
+}
+
+template <typename TGraph>
+void CallMerger<TGraph>::flush(TVertex firstNew) {
+    TCallList merged;
+    if (HasCallSites<TGraph>::value)
+        // every call site has its own edge
+        merged.swap(calls_);
+    else
+        this->merge(merged);
+    TCallList().swap(calls_);
+
+    // edge lists of new vertices get exact capacity, so adding the calls
+    // allocates nothing but (rarely) a bigger edge list of the graph
+    graph_.reserveEdges(merged.size());
+    const size_t nNew = num_vertices(graph_) - firstNew;
+    std::vector<size_t> nOut(nNew, 0);
+    std::vector<size_t> nIn(nNew, 0);
+    typename TCallList::const_iterator i;
+    for (i = merged.begin(); i != merged.end(); ++i) {
+        if (firstNew <= i->src)
+            ++nOut[i->src - firstNew];
+        if (firstNew <= i->dst)
+            ++nIn[i->dst - firstNew];
+    }
+    for (size_t v = 0; v < nNew; ++v)
+        graph_.reserveCalls(firstNew + v, nOut[v], nIn[v]);
+
+    for (i = merged.begin(); i != merged.end(); ++i)
+        addEdge(*i, HasCallCounts<TGraph>(), HasCallSites<TGraph>());
+}
+
+/// order of interned file names, used by write()
+class FileNameLess {
+    public:
+        FileNameLess(const StringTable &files): files_(&files) { }
+
+        bool operator()(StringTable::TId a, StringTable::TId b) const {
+            return std::strcmp((*files_)[a], (*files_)[b]) < 0;
+        }
+
+    private:
+        const StringTable *files_;
+};
+
+/**
+ * Write graph using given TWriter object. Functions are grouped by file, files
+ * are written in order of their names and functions of one file in order of
+ * their vertices. The grouping is a counting sort over interned file ids, so
+ * apart from sorting the distinct file names it runs in O(V+E).
+ */
 template <typename TGraph, typename TWriter>
 static void write(const TGraph &graph, TWriter &builder) {
     using namespace boost;
 
     typedef graph_traits<TGraph>                        Traits;
     typedef typename Traits::vertex_descriptor          TVertex;
-    typedef std::set<TVertex>                           TVertexSet;
-    typedef std::map<std::string, TVertexSet>           TFileMap;
+    typedef FncTable::TStrId                            TFileId;
+    typedef std::vector<size_t>                         TCounts;
 
     // fnc property
     typedef property_map<TGraph, FncProp>               TPropMapping;
     typedef typename TPropMapping::const_type           TProp;
     TProp prop = get(FncProp(), graph);
 
-    // sort by file name
-    TFileMap fileMap;
     typename Traits::vertex_iterator vi, vi_end;
+    tie(vi, vi_end) = vertices(graph);
+    if (vi == vi_end)
+        return;
+
+    // all functions of a graph live in one table
+    const FncTable &table = get(prop, *vi)->table();
+    const StringTable &files = table.files();
+    const size_t nFiles = files.size();
+
+    // count functions per file
+    TCounts start(nFiles + 1, 0);
+    size_t nVert = 0;
+    for (; vi != vi_end; ++vi, ++nVert) {
+        const PFnc fnc = get(prop, *vi);
+        assert(&fnc->table() == &table);
+        ++start[table.fileId(fnc->index())];
+    }
+
+    // order the used files by name
+    std::vector<TFileId> order;
+    for (TFileId f = 0; f < nFiles; ++f)
+        if (start[f])
+            order.push_back(f);
+    std::sort(order.begin(), order.end(), FileNameLess(files));
+
+    // turn counts into bucket offsets, in order of file names
+    size_t pos = 0;
+    typename std::vector<TFileId>::const_iterator fi;
+    for (fi = order.begin(); fi != order.end(); ++fi) {
+        const size_t n = start[*fi];
+        start[*fi] = pos;
+        pos += n;
+    }
+
+    // place vertices into their buckets, keeping their order
+    std::vector<TVertex> sorted(nVert);
     for (tie(vi, vi_end) = vertices(graph); vi != vi_end; ++vi) {
-        PFnc fnc = get(prop, *vi);
-        const std::string &fileName = *(fnc->loc.file);
-        fileMap[fileName].insert(*vi);
+        const PFnc fnc = get(prop, *vi);
+        sorted[start[table.fileId(fnc->index())]++] = *vi;
     }
 
     // for each file
-    typename TFileMap::iterator it;
-    for(it = fileMap.begin(); it != fileMap.end(); ++it) {
-        builder.writeFile(it->first);
-        TVertexSet &set = it->second;
-
-        // for each function
-        typename TVertexSet::iterator i;
-        for(i = set.begin(); i!= set.end(); ++i) {
+    typename std::vector<TVertex>::const_iterator i = sorted.begin();
+    for (fi = order.begin(); fi != order.end(); ++fi) {
+        builder.writeFile(std::string(files[*fi], files.length(*fi)));
+
+        // for each function, start[] now points past the end of the bucket
+        const typename std::vector<TVertex>::const_iterator end =
+            sorted.begin() + start[*fi];
+        for (; i != end; ++i) {
             TVertex v = *i;
             builder.writeFnc(v, get(prop, v));
 
-            // for each call
+            // for each call, merged calls are written as many times
             typename Traits::out_edge_iterator oi, oi_end;
             for (tie(oi, oi_end) = out_edges(v, graph); oi != oi_end; ++oi) {
                 TVertex ov = target(*oi, graph);
-                builder.writeCall(ov, get(prop, ov));
+                for (TCallCount n = call_count(*oi, graph); n; --n)
+                    builder.writeCall(ov, get(prop, ov));
             }
             builder.writeFncEnd();
         }
@@ -157,14 +578,14 @@ class DropUnusedDeclarations {
 
         DropUnusedDeclarations(const TGraph &graph):
             graph_(&graph),
-            fncProp_(boost::get(FncProp(), graph))
+            fncProp_(get(FncProp(), graph))
         {
         }
 
         bool operator()(const TVertex &vertex) const {
-            return boost::get(fncProp_, vertex)->isDefined
-                || (0 != boost::in_degree(vertex, *graph_))
-                || (0 != boost::out_degree(vertex, *graph_));
+            return get(fncProp_, vertex)->isDefined()
+                || (0 != in_degree(vertex, *graph_))
+                || (0 != out_degree(vertex, *graph_));
         }
 
     private:
@@ -23,38 +23,63 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/regex.hpp>
 
+#include <algorithm>
+
 #ifndef DEBUG_DEMANGLE
 #   define DEBUG_DEMANGLE 0
 #endif
 
 #define REGEX_ID "[A-Za-z_][A-Za-z0-9_]*"
 
-// part of non-public include/demangle.h from binutils
-extern "C" {
-    extern char* cplus_demangle(const char *mangled, int options);
-#define DMGL_NO_OPTS	 0		/* For readability... */
-#define DMGL_PARAMS	 (1 << 0)	/* Include function args */
-#define DMGL_ANSI	 (1 << 1)	/* Include const, volatile, etc */
-#define DMGL_JAVA	 (1 << 2)	/* Demangle as Java rather than C++. */
-#define DMGL_VERBOSE	 (1 << 3)	/* Include implementation details.  */
-#define DMGL_TYPES	 (1 << 4)	/* Also try to demangle type encodings.  */
-#define DMGL_RET_POSTFIX (1 << 5)       /* Print function return types (when
-                                           present) after function signature */
-}
-
-void demangle(PFnc fnc) {
-    const char *demangled = cplus_demangle(fnc->name.c_str(), DMGL_PARAMS);
-    if (demangled) {
+void demangle(Fnc &fnc) {
+    const std::string demangled = demangledName(fnc.name);
+    if (!demangled.empty()) {
 #if DEBUG_DEMANGLE
         std::cerr
-            << Color(C_LIGHT_BLUE) << fnc->name
+            << Color(C_LIGHT_BLUE) << fnc.name
             << Color(C_NO_COLOR) << " --> "
             << Color(C_YELLOW) << demangled
             << Color(C_NO_COLOR)
             << std::endl << std::endl;
 #endif
-        fnc->name = demangled;
+        fnc.name = demangled;
+    }
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// FncIdTable implementation
+const FncIdTable::TIdx FncIdTable::NOT_FOUND;
+
+FncIdTable::TIdx FncIdTable::insert(TFncId id) {
+    const TIdx found = this->find(id);
+    if (NOT_FOUND != found)
+        return found;
+
+    const TIdx idx = size_++;
+    if (0 <= id && static_cast<size_t>(id) < dense_.size()) {
+        dense_[id] = idx;
+    } else if (0 <= id && static_cast<size_t>(id) < 2 * size_ + 1024) {
+        // keep the vector at most about half empty
+        dense_.resize(id + 1, NOT_FOUND);
+        dense_[id] = idx;
+
+        // move sparse IDs now covered by the vector, find() looks there only
+        TSparse::iterator i = sparse_.lower_bound(0);
+        while (sparse_.end() != i && i->first <= id) {
+            dense_[i->first] = i->second;
+            sparse_.erase(i++);
+        }
+    } else {
+        sparse_[id] = idx;
     }
+
+    return idx;
+}
+
+void FncIdTable::clear() {
+    dense_.clear();
+    sparse_.clear();
+    size_ = 0;
 }
 
 // /////////////////////////////////////////////////////////////////////////////
@@ -111,11 +136,11 @@ bool CgtReader::read(std::istream &input, bool performDemangle) {
 
         // match: function declaration
         if (regex_match(line, result, d->reDecl)) {
-            PFnc fnc(new Fnc);
-            fnc->name = result[4];
-            *(fnc->loc.file) = fileName;
-            fnc->loc.lineno = lexical_cast<long>(result[2]);
-            fnc->isGlobal = string(result[3]).empty();
+            Fnc fnc;
+            fnc.name = result[4];
+            fnc.loc.file = fileName;
+            fnc.loc.lineno = lexical_cast<long>(result[2]);
+            fnc.isGlobal = string(result[3]).empty();
             if (performDemangle)
                 demangle(fnc);
             d->listener->addFnc(lexical_cast<TFncId>(result[1]), fnc);
@@ -125,14 +150,14 @@ bool CgtReader::read(std::istream &input, bool performDemangle) {
         // match: function definition
         if (regex_match(line, result, d->reDef)) {
             TFncId caller = lexical_cast<TFncId>(result[1]);
-            PFnc fnc(new Fnc);
-            fnc->name = result[4];
-            *(fnc->loc.file) = fileName;
-            fnc->loc.lineno = lexical_cast<long>(result[2]);
-            fnc->isGlobal = string(result[3]).empty()
+            Fnc fnc;
+            fnc.name = result[4];
+            fnc.loc.file = fileName;
+            fnc.loc.lineno = lexical_cast<long>(result[2]);
+            fnc.isGlobal = string(result[3]).empty()
                 // FIXME: this is workaround for "static inline..."
                 || fileIsHeader;
-            fnc->isDefined = true;
+            fnc.isDefined = true;
             if (performDemangle)
                 demangle(fnc);
             d->listener->addFnc(caller, fnc);
@@ -178,6 +203,8 @@ bool CgtReader::read(std::istream &input, bool performDemangle) {
 #endif
     }
 
+    d->listener->finish();
+
     // FIXME: return false if any error is detected
     return true;
 }
@@ -185,7 +212,8 @@ bool CgtReader::read(std::istream &input, bool performDemangle) {
 // /////////////////////////////////////////////////////////////////////////////
 // CgtWriter implementation
 struct CgtWriter::Private {
-    typedef std::map<TFncId, TFncId> TMap;
+    /// output id of each vertex, vertex ids are dense so a vector is enough
+    typedef std::vector<TFncId> TMap;
 
     std::ostream    &output;
     TMap            idMap;
@@ -198,12 +226,15 @@ struct CgtWriter::Private {
     }
 
     TFncId mapId(TFncId origId) {
-        TMap::iterator i = idMap.find(origId);
-        if (i != idMap.end())
-            return i->second;
-
-        TFncId id = lastId++;
-        idMap[origId] = id;
+        assert(0 <= origId);
+        const size_t idx = origId;
+        if (idMap.size() <= idx)
+            idMap.resize(std::max<size_t>(idx + 1, 2 * idMap.size()), 0);
+
+        // 0 is never used as output id, it marks unmapped vertices
+        TFncId &id = idMap[idx];
+        if (!id)
+            id = lastId++;
         return id;
     }
 };
@@ -214,20 +245,24 @@ CgtWriter::CgtWriter(std::ostream &output):
 }
 
 CgtWriter::~CgtWriter() {
+    d->output.flush();
     delete d;
 }
 
 void CgtWriter::writeFile(std::string fileName) {
-    d->output << "F " << fileName << std::endl;
+    d->output << "F " << fileName << '\n';
 }
 
 void CgtWriter::writeFnc(TFncId id, PFnc fnc) {
-    d->output << d->mapId(id) << " (" << fnc->loc.lineno << ") ";
-    if (!fnc->isGlobal)
+    d->output << d->mapId(id) << " (" << fnc->line() << ") ";
+    if (!fnc->isGlobal())
         d->output << "@static ";
-    if (!fnc->isDefined)
+    if (!fnc->isDefined())
         d->output << "@decl ";
-    d->output << fnc->name;
+
+    // write the interned name directly, without a temporary string
+    const FncTable &table = fnc->table();
+    d->output << table.names()[table.nameId(fnc->index())];
 }
 
 void CgtWriter::writeCall(TFncId target, PFnc) {
@@ -235,5 +270,5 @@ void CgtWriter::writeCall(TFncId target, PFnc) {
 }
 
 void CgtWriter::writeFncEnd() {
-    d->output << std::endl;
+    d->output << '\n';
 }
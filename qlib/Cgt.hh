@@ -23,20 +23,72 @@
 #include "config.hh"
 #include "CallGraph.hh"
 #include "Color.hh"
+#include "Linker.hh"
 
 #include <iostream>
 #include <map>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
 
 /// type used for function ID (cgt format)
 typedef long TFncId;
 
-void demangle(PFnc fnc);
+void demangle(Fnc &fnc);
 
 class ICgtReaderListener {
     public:
         virtual ~ICgtReaderListener() { }
-        virtual void addFnc(TFncId id, PFnc fnc) = 0;
+        virtual void addFnc(TFncId id, const Fnc &fnc) = 0;
         virtual void addCall(TFncId a, TFncId b) = 0;
+
+        /// called by CgtReader once the whole input is read
+        virtual void finish() { }
+};
+
+/**
+ * Map of cgt function IDs to continuous indexes, in order of the first
+ * occurrence. IDs are numbered per file and thus small and dense, so they are
+ * looked up in a vector. IDs which would make the vector too sparse fall back
+ * to std::map.
+ */
+class FncIdTable {
+    public:
+        typedef boost::uint32_t                         TIdx;
+        static const TIdx NOT_FOUND = static_cast<TIdx>(-1);
+
+    public:
+        FncIdTable(): size_(0) { }
+
+        /// @return Return index of the given ID, or NOT_FOUND.
+        TIdx find(TFncId id) const {
+            if (0 <= id && static_cast<size_t>(id) < dense_.size())
+                return dense_[id];
+
+            TSparse::const_iterator i = sparse_.find(id);
+            return (sparse_.end() == i)
+                ? NOT_FOUND
+                : i->second;
+        }
+
+        /// @return Return index of the given ID, a new one is assigned if needed.
+        TIdx insert(TFncId id);
+
+        /// count of IDs in the table
+        size_t size() const {
+            return size_;
+        }
+
+        void clear();
+
+    private:
+        typedef std::vector<TIdx>                       TDense;
+        typedef std::map<TFncId, TIdx>                  TSparse;
+
+        TDense          dense_;
+        TSparse         sparse_;
+        size_t          size_;
 };
 
 /// cgt format reader
@@ -65,7 +117,65 @@ class CgtWriter {
         Private *d;
 };
 
-/// call graph builder for cgt format (used by parser)
+/**
+ * Listener which only records what CgtReader reads, so that it can be replayed
+ * later (and possibly in another thread) by replay(). Function data are
+ * interned in a FncTable, so that a batch is cheap to keep in memory.
+ */
+class CgtRecordBatch: public ICgtReaderListener {
+    public:
+        virtual void addFnc(TFncId id, const Fnc &fnc) {
+            const size_t idx = fncs_.size();
+            fncs_.set(idx, fnc);
+            records_.push_back(Record(id, idx, false));
+        }
+
+        virtual void addCall(TFncId a, TFncId b) {
+            records_.push_back(Record(a, b, true));
+        }
+
+        /**
+         * Replay recorded input to the given listener, which has to accept
+         * function data as PFnc. It gets finish() called at the end.
+         */
+        template <typename TListener>
+        void replay(TListener &listener) const {
+            std::vector<Record>::const_iterator i;
+            for (i = records_.begin(); i != records_.end(); ++i) {
+                if (i->isCall)
+                    listener.addCall(i->a, i->b);
+                else
+                    listener.addFnc(i->a, PFnc(fncs_, i->b));
+            }
+            listener.finish();
+        }
+
+    private:
+        struct Record {
+            TFncId      a;
+            TFncId      b;          ///< callee or index in fncs_
+            bool        isCall;
+
+            Record(TFncId a_, TFncId b_, bool isCall_):
+                a(a_), b(b_), isCall(isCall_)
+            {
+            }
+        };
+
+        FncTable                fncs_;
+        std::vector<Record>     records_;
+};
+
+/**
+ * call graph builder for cgt format (used by parser)
+ *
+ * The graph is built in two passes. While reading, function data go straight
+ * to FncTable rows of the graph past its last vertex and calls are only
+ * recorded. Once the input is read, finish() allocates all the vertices at
+ * once and adds the calls by CallMerger, which merges repeated calls and
+ * allocates edge lists of exact size.
+ * @param TGraph Type of graph, BasicCallGraph is supported.
+ */
 template <typename TGraph>
 class CgtGraphBuilder: public ICgtReaderListener {
     public:
@@ -75,60 +185,168 @@ class CgtGraphBuilder: public ICgtReaderListener {
     public:
         CgtGraphBuilder(TGraph &graph):
             graph_(graph),
-            fncProp_(get(FncProp(), graph))
+            fncProp_(get(FncProp(), graph)),
+            base_(num_vertices(graph))
         {
         }
 
-        virtual void addFnc(TFncId id, PFnc fnc) {
-            using namespace boost;
-
+        virtual void addFnc(TFncId id, const Fnc &fnc) {
 #if DEBUG_SHOW_VERTEX_PROPERTY
             std::cerr << Color(C_LIGHT_PURPLE) << "vertex property: " << Color(C_NO_COLOR)
-                << id << " --> " << fnc << std::endl;
+                << id << " --> " << fnc.name << std::endl;
 #endif
-            TMapIterator iter = map_.find(id);
-            if (iter != map_.end())
-                put(fncProp_, iter->second, fnc);
-            else
-                map_[id] = add_vertex(fnc, graph_);
+            put(fncProp_, base_ + this->vertexOf(id), fnc);
         }
 
         virtual void addCall(TFncId a, TFncId b) {
-            TMapIterator ia = map_.find(a);
-            if (ia == map_.end()) {
+            const TIdx src = ids_.find(a);
+            if (FncIdTable::NOT_FOUND == src) {
                 // FIXME: throw std logic error?
                 std::cerr << Color(C_LIGHT_RED) << "Internal error: "
                     << Color(C_NO_COLOR) << "source edge not found"
                     << std::endl;
                 return;
             }
-            add_edge(ia->second, addVertexIfNeeded(b), graph_);
+            calls_.push_back(TCall(src, this->vertexOf(b)));
+        }
+
+        virtual void finish() {
+            const size_t nVert = ids_.size();
+
+            // allocate vertices, CallMerger then allocates their edge lists
+            graph_.resize(base_ + nVert);
+            CallMerger<TGraph> merger(graph_);
+            typename TCallList::const_iterator i;
+            for (i = calls_.begin(); i != calls_.end(); ++i)
+                merger.add(base_ + i->first, base_ + i->second);
+            merger.flush(base_);
+
+            // the builder may be used for another input then
+            TCallList().swap(calls_);
+            ids_.clear();
+            base_ += nVert;
         }
 
     private:
-        TVertex addVertexIfNeeded(TFncId id) {
-            TMapIterator iter = map_.find(id);
-            if (iter != map_.end())
-                return iter->second;
+        typedef FncIdTable::TIdx                        TIdx;
+        typedef std::pair<TIdx, TIdx>                   TCall;
+        typedef std::vector<TCall>                      TCallList;
 
-            TVertex vd = boost::add_vertex(PFnc(new Fnc), graph_);
+        TIdx vertexOf(TFncId id) {
 #if DEBUG_SHOW_VERTEX_MAPPING
-            std::cerr << Color(C_LIGHT_BLUE) << "vertex mapping: " << Color(C_NO_COLOR)
-                << id << " --> " << vd << std::endl;
+            if (FncIdTable::NOT_FOUND == ids_.find(id))
+                std::cerr << Color(C_LIGHT_BLUE) << "vertex mapping: "
+                    << Color(C_NO_COLOR) << id << " --> "
+                    << (base_ + ids_.size()) << std::endl;
 #endif
-            map_[id] = vd;
-            return vd;
+            return ids_.insert(id);
         }
 
     private:
         typedef boost::property_map<TGraph, FncProp>    TPropMapping;
         typedef typename TPropMapping::type             TProp;
-        typedef typename std::map<TFncId, TVertex>      TMap;
-        typedef typename TMap::iterator                 TMapIterator;
 
-        TMap        map_;
         TGraph      &graph_;
         TProp       fncProp_;
+        size_t      base_;
+        FncIdTable  ids_;
+        TCallList   calls_;
+};
+
+/**
+ * Streaming builder for cgt format, which links functions directly into the
+ * output graph of Linker, so that no temporary graph is built per input.
+ *
+ * Functions are linked as soon as they are read. Calls are resolved at the
+ * end of each input, as a callee may be referred to before its declaration.
+ * Unused declarations are not dropped, filter them once the whole link is
+ * done (VertexFilter with DropUnusedDeclarations).
+ * @param TGraph Type of the output graph of Linker.
+ */
+template <typename TGraph>
+class CgtLinkerBuilder: public ICgtReaderListener {
+    public:
+        typedef Linker<TGraph>                          TLinker;
+        typedef typename TLinker::TVertex               TVertex;
+
+    public:
+        CgtLinkerBuilder(TLinker &linker):
+            linker_(linker),
+            firstNew_(num_vertices(linker.output()))
+        {
+        }
+
+        virtual void addFnc(TFncId id, const Fnc &fnc) {
+            // function data are interned per input to be linked by reference
+            const TIdx idx = ids_.insert(id);
+            put(FncMap(fncs_), idx, fnc);
+            this->addFnc(id, PFnc(fncs_, idx));
+        }
+
+        /// link function data kept in another table, see CgtRecordBatch
+        void addFnc(TFncId id, const PFnc &fnc) {
+            const TIdx idx = ids_.insert(id);
+            if (vertices_.size() <= idx)
+                vertices_.resize(idx + 1, NONE);
+
+            vertices_[idx] = linker_.linkFnc(fnc);
+        }
+
+        virtual void addCall(TFncId a, TFncId b) {
+            const TIdx src = ids_.find(a);
+            if (FncIdTable::NOT_FOUND == src) {
+                // FIXME: throw std logic error?
+                std::cerr << Color(C_LIGHT_RED) << "Internal error: "
+                    << Color(C_NO_COLOR) << "source edge not found"
+                    << std::endl;
+                return;
+            }
+            calls_.push_back(TCall(src, ids_.insert(b)));
+        }
+
+        virtual void finish() {
+            // callees never declared become anonymous static functions
+            vertices_.resize(ids_.size(), NONE);
+            for (TIdx i = 0; i < vertices_.size(); ++i) {
+                if (NONE == vertices_[i]) {
+                    put(FncMap(fncs_), i, Fnc());
+                    vertices_[i] = linker_.linkFnc(PFnc(fncs_, i));
+                }
+            }
+
+            // resolve calls
+            typename TCallList::iterator i;
+            for (i = calls_.begin(); i != calls_.end(); ++i) {
+                i->first = vertices_[i->first];
+                i->second = vertices_[i->second];
+            }
+            linker_.addCalls(calls_, firstNew_);
+
+            // prepare for the next input
+            ids_.clear();
+            fncs_ = FncTable();
+            TVertexList().swap(vertices_);
+            TCallList().swap(calls_);
+            firstNew_ = num_vertices(linker_.output());
+        }
+
+    private:
+        typedef FncIdTable::TIdx                        TIdx;
+        typedef std::vector<TVertex>                    TVertexList;
+        typedef std::pair<TVertex, TVertex>             TCall;
+        typedef std::vector<TCall>                      TCallList;
+
+        static const TVertex NONE = static_cast<TVertex>(-1);
+
+        TLinker         &linker_;
+        TVertex         firstNew_;
+        FncIdTable      ids_;
+        FncTable        fncs_;      ///< function data of the current input
+        TVertexList     vertices_;  ///< output vertex by index of ID
+        TCallList       calls_;     ///< by index of ID until finish()
 };
 
+template <typename TGraph>
+const typename CgtLinkerBuilder<TGraph>::TVertex CgtLinkerBuilder<TGraph>::NONE;
+
 #endif // CGT_H
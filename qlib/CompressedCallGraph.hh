@@ -0,0 +1,902 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMPRESSED_CALL_GRAPH_H
+#define COMPRESSED_CALL_GRAPH_H
+
+#include "config.hh"
+#include "CallGraph.hh"
+#include "CsrCallGraph.hh"
+#include "FncTable.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/graph/adjacency_iterator.hpp>
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/properties.hpp>
+#include <boost/iterator/counting_iterator.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/property_map/property_map.hpp>
+
+namespace CompressedImpl {
+    typedef boost::uint32_t                             TIdx;
+    typedef boost::uint64_t                             TWord;
+    typedef std::vector<unsigned char>                  TBytes;
+
+    /// append a variable-length (7 bits per byte, LSB first) number
+    inline void putVarint(TBytes &data, TWord n) {
+        while (0x80 <= n) {
+            data.push_back(static_cast<unsigned char>(n) | 0x80);
+            n >>= 7;
+        }
+        data.push_back(static_cast<unsigned char>(n));
+    }
+
+    /// read a variable-length number and move the pointer past it
+    inline TWord getVarint(const unsigned char *&p) {
+        TWord n = *p & 0x7F;
+        for (unsigned shift = 7; *p++ & 0x80; shift += 7)
+            n |= static_cast<TWord>(*p & 0x7F) << shift;
+        return n;
+    }
+
+    /// map signed difference to unsigned, small magnitudes to small numbers
+    inline TWord zigzag(TIdx to, TIdx from) {
+        return (to < from)
+            ? (static_cast<TWord>(from - to) << 1) - 1
+            : static_cast<TWord>(to - from) << 1;
+    }
+
+    inline TIdx unzigzag(TWord z, TIdx from) {
+        return (z & 1)
+            ? from - static_cast<TIdx>((z + 1) >> 1)
+            : from + static_cast<TIdx>(z >> 1);
+    }
+
+    /**
+     * Decoder of a list of neighbors without reference. The first neighbor
+     * is stored relative to the vertex owning the list, each next one as the
+     * gap to the previous one.
+     */
+    struct ListCursor {
+        const unsigned char     *ptr;
+        TIdx                    left;       ///< count of values not read yet
+        TIdx                    val;        ///< the last value read
+        bool                    first;
+
+        ListCursor(): ptr(0), left(0), val(0), first(true) { }
+
+        ListCursor(const unsigned char *ptr_, TIdx left_, TIdx base):
+            ptr(ptr_),
+            left(left_),
+            val(base),
+            first(true)
+        {
+        }
+
+        void next() {
+            assert(left);
+            --left;
+            if (first) {
+                first = false;
+                val = unzigzag(getVarint(ptr), val);
+            } else {
+                val += static_cast<TIdx>(getVarint(ptr));
+            }
+        }
+    };
+}
+
+class CompressedAdjacency;
+
+/**
+ * Iterator over neighbors of one vertex in CompressedAdjacency, the list is
+ * decoded as it is iterated. Neighbors come in ascending order.
+ */
+class CompressedNeighborIterator: public boost::iterator_facade<
+        CompressedNeighborIterator, boost::uint32_t,
+        boost::forward_traversal_tag, boost::uint32_t>
+{
+    public:
+        typedef CompressedImpl::TIdx                    TIdx;
+
+        /// end iterator
+        CompressedNeighborIterator():
+            left_(0),
+            hasRes_(false),
+            blk_(0),
+            blkLeft_(0),
+            runLeft_(0),
+            copyLeft_(0),
+            copying_(false),
+            hasCopy_(false)
+        {
+        }
+
+        inline CompressedNeighborIterator(const CompressedAdjacency &adj,
+                                          TIdx v);
+
+    private:
+        friend class boost::iterator_core_access;
+
+        TIdx dereference() const {
+            return (this->takeCopy()) ? ref_.val : res_.val;
+        }
+
+        bool equal(const CompressedNeighborIterator &o) const {
+            return left_ == o.left_;
+        }
+
+        void increment() {
+            if (this->takeCopy())
+                this->fetchCopy();
+            else
+                this->fetchRes();
+            --left_;
+        }
+
+    private:
+        typedef CompressedImpl::ListCursor              TCursor;
+
+        TIdx                    left_;      ///< neighbors not visited yet
+
+        // residual neighbors, i.e. those not copied from the reference list
+        TCursor                 res_;
+        bool                    hasRes_;
+
+        // neighbors copied from the reference list, selected by copy blocks
+        TCursor                 ref_;
+        const unsigned char     *blk_;
+        TIdx                    blkLeft_;
+        TIdx                    runLeft_;
+        TIdx                    copyLeft_;
+        bool                    copying_;
+        bool                    hasCopy_;
+
+    private:
+        bool takeCopy() const {
+            return hasCopy_ && (!hasRes_ || ref_.val <= res_.val);
+        }
+
+        void fetchRes() {
+            hasRes_ = res_.left;
+            if (hasRes_)
+                res_.next();
+        }
+
+        void fetchCopy() {
+            using CompressedImpl::getVarint;
+            hasCopy_ = copyLeft_;
+            if (!hasCopy_)
+                return;
+
+            // skip to the next element of reference list inside a copy block
+            for (;;) {
+                while (!runLeft_) {
+                    assert(blkLeft_);
+                    --blkLeft_;
+                    runLeft_ = static_cast<TIdx>(getVarint(blk_));
+                    copying_ = !copying_;
+                }
+                ref_.next();
+                --runLeft_;
+                if (copying_)
+                    break;
+            }
+            --copyLeft_;
+        }
+};
+
+/**
+ * Adjacency lists of all vertices in one direction, compressed into a byte
+ * array. Each list is sorted, the first neighbor is stored as a zig-zag
+ * difference to the vertex, the next ones as gaps, all as varints.
+ *
+ * With reference window W, a list may instead refer to the list of one of W
+ * preceding vertices: it is stored as copy blocks (alternating lengths of
+ * copied and skipped runs of the reference list) plus the remaining neighbors.
+ * Referenced lists never have a reference themselves, so that a list is
+ * decoded without recursion.
+ *
+ * Lists are located by byte offsets sampled every BLOCK vertices and byte
+ * lengths of lists in between, which takes ~1.5 bytes per vertex. Empty lists
+ * take no bytes in the array.
+ */
+class CompressedAdjacency {
+    public:
+        typedef CompressedImpl::TIdx                    TIdx;
+        typedef std::vector<TIdx>                       TIdxList;
+
+        /// count of vertices between sampled offsets
+        static const TIdx BLOCK = 16;
+
+    public:
+        CompressedAdjacency() {
+            blocks_.push_back(0);
+        }
+
+        /**
+         * Encode lists given as CSR arrays, each list has to be sorted.
+         * @param offsets Start of list of each vertex, plus the end.
+         * @param targets Concatenated lists of neighbors.
+         * @param refWindow How many preceding lists to try as reference, zero
+         * disables reference lists.
+         */
+        void assign(const TIdxList &offsets, const TIdxList &targets,
+                    unsigned refWindow = 0);
+
+        size_t numVertices() const {
+            return lens_.size();
+        }
+
+        size_t degree(TIdx v) const {
+            const unsigned char *p = this->listAt(v);
+            return (p)
+                ? static_cast<size_t>(CompressedImpl::getVarint(p) >> 1)
+                : 0;
+        }
+
+        /// @return Return encoded list of the given vertex, 0 if it is empty.
+        const unsigned char* listAt(TIdx v) const {
+            assert(v < this->numVertices());
+            if (!lens_[v])
+                return 0;
+
+            CompressedImpl::TWord off = blocks_[v / BLOCK];
+            for (TIdx u = v - v % BLOCK; u < v; ++u)
+                off += this->length(u);
+            return &data_[0] + off;
+        }
+
+        /// @return Return the count of bytes occupied by the lists.
+        size_t memoryUsage() const {
+            return data_.capacity() + lens_.capacity()
+                + sizeof(CompressedImpl::TWord) * blocks_.capacity()
+                + sizeof(TLongLen) * longLens_.capacity();
+        }
+
+        /// count of lists stored with a reference
+        size_t numReferences() const {
+            return nRefs_;
+        }
+
+    private:
+        typedef std::pair<TIdx, TIdx>                   TLongLen;
+        typedef std::vector<TLongLen>                   TLongLens;
+        static const unsigned char LONG_LIST = 0xFF;
+
+        CompressedImpl::TBytes                  data_;
+        std::vector<CompressedImpl::TWord>      blocks_;
+        CompressedImpl::TBytes                  lens_;
+        TLongLens                               longLens_;  ///< sorted
+        size_t                                  nRefs_;
+
+    private:
+        TIdx length(TIdx v) const {
+            if (LONG_LIST != lens_[v])
+                return lens_[v];
+
+            const TLongLens::const_iterator i = std::lower_bound(
+                    longLens_.begin(), longLens_.end(), TLongLen(v, 0));
+            assert(longLens_.end() != i && i->first == v);
+            return i->second;
+        }
+
+        static void encodePlain(CompressedImpl::TBytes &out, TIdx v,
+                                const TIdx *list, TIdx n);
+
+        static void encodeResidual(CompressedImpl::TBytes &out, TIdx v,
+                                   const TIdxList &list);
+
+        static void encodeRef(CompressedImpl::TBytes &out, TIdx v,
+                              const TIdx *list, TIdx n, TIdx r,
+                              const TIdx *ref, TIdx nRef);
+};
+
+inline void CompressedAdjacency::encodePlain(CompressedImpl::TBytes &out,
+                                             TIdx v, const TIdx *list, TIdx n)
+{
+    using namespace CompressedImpl;
+    putVarint(out, static_cast<TWord>(n) << 1);
+    for (TIdx i = 0; i < n; ++i)
+        putVarint(out, (i) ? list[i] - list[i - 1] : zigzag(list[0], v));
+}
+
+inline void CompressedAdjacency::encodeResidual(CompressedImpl::TBytes &out,
+                                                TIdx v, const TIdxList &list)
+{
+    using namespace CompressedImpl;
+    for (size_t i = 0; i < list.size(); ++i)
+        putVarint(out, (i) ? list[i] - list[i - 1] : zigzag(list[0], v));
+}
+
+inline void CompressedAdjacency::encodeRef(CompressedImpl::TBytes &out,
+                                           TIdx v, const TIdx *list, TIdx n,
+                                           TIdx r, const TIdx *ref, TIdx nRef)
+{
+    using namespace CompressedImpl;
+
+    // merge both lists, runs of copied and skipped neighbors of reference
+    TIdxList runs;
+    TIdxList residual;
+    bool copying = true;
+    TIdx run = 0;
+    TIdx i = 0, j = 0;
+    while (i < nRef && j < n) {
+        const bool copy = (ref[i] == list[j]);
+        if (!copy && list[j] < ref[i]) {
+            residual.push_back(list[j++]);
+            continue;
+        }
+
+        if (copy != copying) {
+            runs.push_back(run);
+            copying = copy;
+            run = 0;
+        }
+        ++run;
+        ++i;
+        if (copy)
+            ++j;
+    }
+    if (copying)
+        // trailing run of skipped neighbors is implicit
+        runs.push_back(run);
+    for (; j < n; ++j)
+        residual.push_back(list[j]);
+
+    putVarint(out, (static_cast<TWord>(n) << 1) | 1);
+    putVarint(out, v - r);
+    putVarint(out, residual.size());
+    putVarint(out, runs.size());
+    for (TIdxList::const_iterator it = runs.begin(); it != runs.end(); ++it)
+        putVarint(out, *it);
+    encodeResidual(out, v, residual);
+}
+
+inline void CompressedAdjacency::assign(const TIdxList &offsets,
+                                        const TIdxList &targets,
+                                        unsigned refWindow)
+{
+    using namespace CompressedImpl;
+    const TIdx nVert = offsets.size() - 1;
+
+    data_.clear();
+    blocks_.clear();
+    lens_.clear();
+    longLens_.clear();
+    nRefs_ = 0;
+    data_.reserve(targets.size() + nVert);
+    lens_.reserve(nVert);
+    blocks_.reserve(nVert / BLOCK + 1);
+
+    // lists stored with a reference, they can't be referenced
+    std::vector<bool> hasRef(nVert, false);
+    TBytes plain, best, tmp;
+    for (TIdx v = 0; v < nVert; ++v) {
+        if (!(v % BLOCK))
+            blocks_.push_back(data_.size());
+
+        const TIdx *list = &targets[0] + offsets[v];
+        const TIdx n = offsets[v + 1] - offsets[v];
+        assert(std::is_sorted(list, list + n));
+
+        plain.clear();
+        if (n)
+            encodePlain(plain, v, list, n);
+        const TBytes *chosen = &plain;
+
+        // try preceding lists as reference
+        for (TIdx k = 1; n && k <= refWindow && k <= v; ++k) {
+            const TIdx r = v - k;
+            const TIdx nRef = offsets[r + 1] - offsets[r];
+            if (!nRef || hasRef[r])
+                continue;
+
+            tmp.clear();
+            encodeRef(tmp, v, list, n, r, &targets[0] + offsets[r], nRef);
+            if (tmp.size() < chosen->size()) {
+                best.swap(tmp);
+                chosen = &best;
+            }
+        }
+        if (chosen != &plain) {
+            hasRef[v] = true;
+            ++nRefs_;
+        }
+
+        data_.insert(data_.end(), chosen->begin(), chosen->end());
+        const TIdx len = chosen->size();
+        if (len < LONG_LIST) {
+            lens_.push_back(static_cast<unsigned char>(len));
+        } else {
+            lens_.push_back(LONG_LIST);
+            longLens_.push_back(TLongLen(v, len));
+        }
+    }
+    if (blocks_.empty())
+        blocks_.push_back(0);
+
+    // keep &data_[0] valid even if all lists are empty
+    data_.push_back(0);
+    TBytes(data_).swap(data_);
+}
+
+inline CompressedNeighborIterator::CompressedNeighborIterator(
+        const CompressedAdjacency &adj, TIdx v):
+    hasRes_(false),
+    blk_(0),
+    blkLeft_(0),
+    runLeft_(0),
+    copyLeft_(0),
+    copying_(false),
+    hasCopy_(false)
+{
+    using CompressedImpl::getVarint;
+    const unsigned char *p = adj.listAt(v);
+    if (!p) {
+        left_ = 0;
+        return;
+    }
+
+    const CompressedImpl::TWord hdr = getVarint(p);
+    left_ = static_cast<TIdx>(hdr >> 1);
+
+    if (hdr & 1) {
+        const TIdx r = v - static_cast<TIdx>(getVarint(p));
+        const TIdx nRes = static_cast<TIdx>(getVarint(p));
+        blkLeft_ = static_cast<TIdx>(getVarint(p));
+        blk_ = p;
+        for (TIdx i = 0; i < blkLeft_; ++i)
+            getVarint(p);
+
+        const unsigned char *rp = adj.listAt(r);
+        const CompressedImpl::TWord refHdr = getVarint(rp);
+        assert(!(refHdr & 1));
+        ref_ = TCursor(rp, static_cast<TIdx>(refHdr >> 1), r);
+        copyLeft_ = left_ - nRes;
+        res_ = TCursor(p, nRes, v);
+    } else {
+        res_ = TCursor(p, left_, v);
+    }
+
+    this->fetchCopy();
+    this->fetchRes();
+}
+
+/**
+ * Edge descriptor of CompressedCallGraph. There is no edge index in a
+ * compressed list, so an edge is identified by its end points. Parallel edges
+ * are therefore not distinguished (CallGraph merges them anyway).
+ */
+struct CompressedEdge {
+    boost::uint32_t src;
+    boost::uint32_t dst;
+
+    CompressedEdge(): src(0), dst(0) { }
+    CompressedEdge(boost::uint32_t src_, boost::uint32_t dst_):
+        src(src_),
+        dst(dst_)
+    {
+    }
+};
+inline bool operator==(const CompressedEdge &a, const CompressedEdge &b) {
+    return a.src == b.src && a.dst == b.dst;
+}
+inline bool operator!=(const CompressedEdge &a, const CompressedEdge &b) {
+    return !(a == b);
+}
+inline bool operator<(const CompressedEdge &a, const CompressedEdge &b) {
+    return (a.src == b.src)
+        ? a.dst < b.dst
+        : a.src < b.src;
+}
+
+/**
+ * Iterator over out (or in) edges of a vertex of CompressedCallGraph.
+ * @param REVERSE true for iterator over in edges
+ */
+template <bool REVERSE>
+class CompressedEdgeListIterator: public boost::iterator_facade<
+        CompressedEdgeListIterator<REVERSE>, CompressedEdge,
+        boost::forward_traversal_tag, CompressedEdge>
+{
+    public:
+        CompressedEdgeListIterator(): v_(0) { }
+
+        CompressedEdgeListIterator(boost::uint32_t v,
+                                   const CompressedNeighborIterator &i):
+            v_(v),
+            i_(i)
+        {
+        }
+
+    private:
+        friend class boost::iterator_core_access;
+
+        CompressedEdge dereference() const {
+            return (REVERSE)
+                ? CompressedEdge(*i_, v_)
+                : CompressedEdge(v_, *i_);
+        }
+
+        bool equal(const CompressedEdgeListIterator &o) const {
+            return i_ == o.i_;
+        }
+
+        void increment() {
+            ++i_;
+        }
+
+    private:
+        boost::uint32_t             v_;
+        CompressedNeighborIterator  i_;
+};
+
+class CompressedCallGraph;
+
+/// iterator over all edges of CompressedCallGraph, ordered by source vertex
+class CompressedEdgeIterator: public boost::iterator_facade<
+        CompressedEdgeIterator, CompressedEdge, boost::forward_traversal_tag,
+        CompressedEdge>
+{
+    public:
+        CompressedEdgeIterator(): graph_(0), src_(0) { }
+        inline CompressedEdgeIterator(const CompressedCallGraph &graph,
+                                      boost::uint32_t src);
+
+    private:
+        friend class boost::iterator_core_access;
+
+        CompressedEdge dereference() const {
+            return CompressedEdge(src_, *i_);
+        }
+
+        bool equal(const CompressedEdgeIterator &o) const {
+            return src_ == o.src_ && i_ == o.i_;
+        }
+
+        void increment() {
+            ++i_;
+            this->skipEmpty();
+        }
+
+        inline void skipEmpty();
+
+    private:
+        const CompressedCallGraph   *graph_;
+        boost::uint32_t             src_;
+        CompressedNeighborIterator  i_;
+};
+
+/**
+ * Frozen call graph with compressed adjacency lists, an alternative of
+ * CsrCallGraph for huge graphs. Lists of callees and callers are kept in
+ * CompressedAdjacency and decoded while iterated, so that it plugs into
+ * BitmapIndexer, PathFinder and write() as any other graph. Out edges come in
+ * order of callee numbers, which is where gap encoding works best, it is thus
+ * worth to renumber the graph for locality before (see VertexOrder.hh).
+ */
+class CompressedCallGraph {
+    public:
+        typedef boost::uint32_t                         TIdx;
+        typedef std::vector<TIdx>                       TIdxList;
+
+        // graph_traits
+        typedef size_t                                  vertex_descriptor;
+        typedef CompressedEdge                          edge_descriptor;
+        typedef boost::directed_tag                     directed_category;
+        typedef boost::allow_parallel_edge_tag          edge_parallel_category;
+        typedef boost::counting_iterator<size_t>        vertex_iterator;
+        typedef CompressedEdgeListIterator<false>       out_edge_iterator;
+        typedef CompressedEdgeListIterator<true>        in_edge_iterator;
+        typedef CompressedEdgeIterator                  edge_iterator;
+        typedef boost::adjacency_iterator_generator<CompressedCallGraph,
+                vertex_descriptor, out_edge_iterator>::type
+                                                        adjacency_iterator;
+        typedef size_t                                  vertices_size_type;
+        typedef size_t                                  edges_size_type;
+        typedef size_t                                  degree_size_type;
+        typedef boost::no_property                      vertex_property_type;
+        typedef boost::no_property                      edge_property_type;
+
+        struct traversal_category:
+            public virtual boost::bidirectional_graph_tag,
+            public virtual boost::adjacency_graph_tag,
+            public virtual boost::vertex_list_graph_tag,
+            public virtual boost::edge_list_graph_tag
+        {
+        };
+
+        static vertex_descriptor null_vertex() {
+            return static_cast<vertex_descriptor>(-1);
+        }
+
+    public:
+        CompressedCallGraph(): nEdges_(0) { }
+
+        /**
+         * Build the graph from another graph, see assign().
+         */
+        template <typename TGraph>
+        explicit CompressedCallGraph(const TGraph &graph,
+                                     unsigned refWindow = 0):
+            nEdges_(0)
+        {
+            assign(graph, refWindow);
+        }
+
+        /**
+         * Replace content of the graph by the given graph. Vertices are
+         * renumbered to be continuous (if the source graph is filtered), but
+         * their order is preserved. Numbers of vertices in input of
+         * CsrCallGraph are preserved as well (see origIndex()).
+         * @param refWindow See CompressedAdjacency::assign().
+         */
+        template <typename TGraph>
+        void assign(const TGraph &graph, unsigned refWindow = 0);
+
+        FncTable& fncTable() {
+            return fncTable_;
+        }
+
+        const FncTable& fncTable() const {
+            return fncTable_;
+        }
+
+        size_t numVertices() const {
+            return out_.numVertices();
+        }
+
+        size_t numEdges() const {
+            return nEdges_;
+        }
+
+        const CompressedAdjacency& outLists() const {
+            return out_;
+        }
+
+        const CompressedAdjacency& inLists() const {
+            return in_;
+        }
+
+        /// see CsrCallGraph::origIndex()
+        size_t origIndex(size_t v) const {
+            return (origIndex_.empty()) ? v : origIndex_[v];
+        }
+
+        /// @return Return the count of bytes occupied by the graph structure.
+        size_t memoryUsage() const {
+            return out_.memoryUsage() + in_.memoryUsage()
+                + sizeof(TIdx) * origIndex_.capacity();
+        }
+
+    private:
+        CompressedAdjacency     out_;
+        CompressedAdjacency     in_;
+        size_t                  nEdges_;
+        TIdxList                origIndex_;     ///< empty if not renumbered
+        FncTable                fncTable_;
+
+    private:
+        template <typename TGraph>
+        static size_t origIndexOf(const TGraph &, size_t v) {
+            return v;
+        }
+
+        static size_t origIndexOf(const CsrCallGraph &graph, size_t v) {
+            return graph.origIndex(v);
+        }
+};
+
+template <typename TGraph>
+void CompressedCallGraph::assign(const TGraph &graph, unsigned refWindow) {
+    using namespace boost;
+    typedef graph_traits<TGraph>                        Traits;
+    typedef typename property_map<TGraph, FncProp>::const_type TProp;
+    const TProp prop = get(FncProp(), graph);
+    const TIdx NONE = static_cast<TIdx>(-1);
+
+    // number the vertices continuously
+    TIdxList index(num_vertices(graph), NONE);
+    TIdx nVert = 0;
+    typename Traits::vertex_iterator vi, vi_end;
+    for (tie(vi, vi_end) = vertices(graph); vi != vi_end; ++vi)
+        index[*vi] = nVert++;
+
+    // copy function data and collect sorted out lists
+    fncTable_ = FncTable();
+    fncTable_.reserve(nVert);
+    origIndex_.clear();
+    bool renumbered = false;
+    TIdxList offsets;
+    offsets.reserve(nVert + 1);
+    offsets.push_back(0);
+    TIdxList targets;
+    targets.reserve(num_edges(graph));
+    for (tie(vi, vi_end) = vertices(graph); vi != vi_end; ++vi) {
+        const TIdx v = index[*vi];
+        put(FncMap(fncTable_), v, get(prop, *vi));
+        origIndex_.push_back(origIndexOf(graph, *vi));
+        renumbered |= (origIndex_.back() != v);
+
+        typename Traits::out_edge_iterator ei, ei_end;
+        for (tie(ei, ei_end) = out_edges(*vi, graph); ei != ei_end; ++ei) {
+            const TIdx dst = index[target(*ei, graph)];
+            assert(NONE != dst);
+            targets.push_back(dst);
+        }
+        std::sort(targets.begin() + offsets.back(), targets.end());
+        offsets.push_back(targets.size());
+    }
+    if (!renumbered)
+        TIdxList().swap(origIndex_);
+    nEdges_ = targets.size();
+    out_.assign(offsets, targets, refWindow);
+
+    // in lists, sources come out sorted as they are scattered in order
+    TIdxList inOffsets(nVert + 1, 0);
+    for (size_t i = 0; i < nEdges_; ++i)
+        ++inOffsets[targets[i] + 1];
+    for (TIdx v = 0; v < nVert; ++v)
+        inOffsets[v + 1] += inOffsets[v];
+
+    TIdxList sources(nEdges_);
+    TIdxList pos(inOffsets.begin(), inOffsets.end() - 1);
+    for (TIdx src = 0; src < nVert; ++src)
+        for (TIdx i = offsets[src]; i < offsets[src + 1]; ++i)
+            sources[pos[targets[i]]++] = src;
+
+    in_.assign(inOffsets, sources, refWindow);
+}
+
+inline CompressedEdgeIterator::CompressedEdgeIterator(
+        const CompressedCallGraph &graph, boost::uint32_t src):
+    graph_(&graph),
+    src_(src)
+{
+    if (src_ < graph.numVertices())
+        i_ = CompressedNeighborIterator(graph.outLists(), src_);
+    this->skipEmpty();
+}
+
+inline void CompressedEdgeIterator::skipEmpty() {
+    // move src_ to the next vertex with an out edge left
+    const size_t nVert = graph_->numVertices();
+    while (src_ < nVert && CompressedNeighborIterator() == i_) {
+        if (++src_ < nVert)
+            i_ = CompressedNeighborIterator(graph_->outLists(), src_);
+    }
+}
+
+// ///////////////////////////////////////////////////////////////////////////
+// BGL interface
+inline size_t num_vertices(const CompressedCallGraph &g) {
+    return g.numVertices();
+}
+
+inline size_t num_edges(const CompressedCallGraph &g) {
+    return g.numEdges();
+}
+
+inline std::pair<CompressedCallGraph::vertex_iterator,
+                 CompressedCallGraph::vertex_iterator>
+vertices(const CompressedCallGraph &g)
+{
+    typedef CompressedCallGraph::vertex_iterator TIter;
+    return std::make_pair(TIter(0), TIter(g.numVertices()));
+}
+
+inline std::pair<CompressedEdgeIterator, CompressedEdgeIterator>
+edges(const CompressedCallGraph &g)
+{
+    return std::make_pair(CompressedEdgeIterator(g, 0),
+                          CompressedEdgeIterator(g, g.numVertices()));
+}
+
+inline std::pair<CompressedCallGraph::out_edge_iterator,
+                 CompressedCallGraph::out_edge_iterator>
+out_edges(size_t v, const CompressedCallGraph &g)
+{
+    typedef CompressedCallGraph::out_edge_iterator TIter;
+    return std::make_pair(
+            TIter(v, CompressedNeighborIterator(g.outLists(), v)),
+            TIter(v, CompressedNeighborIterator()));
+}
+
+inline std::pair<CompressedCallGraph::in_edge_iterator,
+                 CompressedCallGraph::in_edge_iterator>
+in_edges(size_t v, const CompressedCallGraph &g)
+{
+    typedef CompressedCallGraph::in_edge_iterator TIter;
+    return std::make_pair(
+            TIter(v, CompressedNeighborIterator(g.inLists(), v)),
+            TIter(v, CompressedNeighborIterator()));
+}
+
+inline std::pair<CompressedCallGraph::adjacency_iterator,
+                 CompressedCallGraph::adjacency_iterator>
+adjacent_vertices(size_t v, const CompressedCallGraph &g)
+{
+    typedef CompressedCallGraph::adjacency_iterator TIter;
+    const std::pair<CompressedCallGraph::out_edge_iterator,
+                    CompressedCallGraph::out_edge_iterator> r
+        = out_edges(v, g);
+    return std::make_pair(TIter(r.first, &g), TIter(r.second, &g));
+}
+
+inline size_t out_degree(size_t v, const CompressedCallGraph &g) {
+    return g.outLists().degree(v);
+}
+
+inline size_t in_degree(size_t v, const CompressedCallGraph &g) {
+    return g.inLists().degree(v);
+}
+
+inline size_t degree(size_t v, const CompressedCallGraph &g) {
+    return out_degree(v, g) + in_degree(v, g);
+}
+
+inline size_t source(const CompressedEdge &e, const CompressedCallGraph &) {
+    return e.src;
+}
+
+inline size_t target(const CompressedEdge &e, const CompressedCallGraph &) {
+    return e.dst;
+}
+
+// ///////////////////////////////////////////////////////////////////////////
+// property maps
+namespace boost {
+    template <> struct property_map<CompressedCallGraph, FncProp> {
+        typedef FncMap type;
+        typedef FncMap const_type;
+    };
+
+    template <> struct property_map<CompressedCallGraph, vertex_index_t> {
+        typedef typed_identity_property_map<size_t> type;
+        typedef typed_identity_property_map<size_t> const_type;
+    };
+}
+
+inline FncMap get(FncProp, CompressedCallGraph &graph) {
+    return FncMap(graph.fncTable());
+}
+inline FncMap get(FncProp, const CompressedCallGraph &graph) {
+    // FncMap is read-write, but put() is never used on const graphs
+    return FncMap(const_cast<FncTable &>(graph.fncTable()));
+}
+
+inline boost::typed_identity_property_map<size_t>
+get(boost::vertex_index_t, const CompressedCallGraph &)
+{
+    return boost::typed_identity_property_map<size_t>();
+}
+
+inline size_t get(boost::vertex_index_t, const CompressedCallGraph &,
+                  size_t v)
+{
+    return v;
+}
+
+#endif // COMPRESSED_CALL_GRAPH_H
@@ -0,0 +1,596 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSR_CALL_GRAPH_H
+#define CSR_CALL_GRAPH_H
+
+#include "config.hh"
+#include "CallGraph.hh"
+#include "FncTable.hh"
+#include "VertexOrder.hh"
+
+#include <cassert>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/graph/adjacency_iterator.hpp>
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/properties.hpp>
+#include <boost/iterator/counting_iterator.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/property_map/property_map.hpp>
+
+class CsrCallGraph;
+
+/**
+ * Edge descriptor of CsrCallGraph. An edge is identified by its position in
+ * the array of targets, the source vertex is kept aside to make source() cheap.
+ * Descriptors of the same edge obtained by out_edges() and in_edges() are
+ * equal.
+ */
+struct CsrEdge {
+    boost::uint32_t src;
+    boost::uint32_t idx;
+
+    CsrEdge(): src(0), idx(0) { }
+    CsrEdge(boost::uint32_t src_, boost::uint32_t idx_): src(src_), idx(idx_) { }
+};
+inline bool operator==(const CsrEdge &a, const CsrEdge &b) {
+    return a.idx == b.idx;
+}
+inline bool operator!=(const CsrEdge &a, const CsrEdge &b) {
+    return a.idx != b.idx;
+}
+inline bool operator<(const CsrEdge &a, const CsrEdge &b) {
+    return a.idx < b.idx;
+}
+
+/// iterator over out edges of a vertex of CsrCallGraph
+class CsrOutEdgeIterator: public boost::iterator_facade<
+        CsrOutEdgeIterator, CsrEdge, std::random_access_iterator_tag, CsrEdge>
+{
+    public:
+        CsrOutEdgeIterator(): src_(0), idx_(0) { }
+        CsrOutEdgeIterator(boost::uint32_t src, boost::uint32_t idx):
+            src_(src),
+            idx_(idx)
+        {
+        }
+
+    private:
+        friend class boost::iterator_core_access;
+
+        CsrEdge dereference() const         { return CsrEdge(src_, idx_); }
+        bool equal(const CsrOutEdgeIterator &o) const { return idx_ == o.idx_; }
+        void increment()                    { ++idx_; }
+        void decrement()                    { --idx_; }
+        void advance(std::ptrdiff_t n)      { idx_ += n; }
+        std::ptrdiff_t distance_to(const CsrOutEdgeIterator &o) const {
+            return std::ptrdiff_t(o.idx_) - std::ptrdiff_t(idx_);
+        }
+
+    private:
+        boost::uint32_t src_;
+        boost::uint32_t idx_;
+};
+
+/// iterator over in edges of a vertex of CsrCallGraph
+class CsrInEdgeIterator: public boost::iterator_facade<
+        CsrInEdgeIterator, CsrEdge, std::random_access_iterator_tag, CsrEdge>
+{
+    public:
+        CsrInEdgeIterator(): graph_(0), pos_(0) { }
+        CsrInEdgeIterator(const CsrCallGraph &graph, boost::uint32_t pos):
+            graph_(&graph),
+            pos_(pos)
+        {
+        }
+
+    private:
+        friend class boost::iterator_core_access;
+
+        inline CsrEdge dereference() const;
+        bool equal(const CsrInEdgeIterator &o) const { return pos_ == o.pos_; }
+        void increment()                    { ++pos_; }
+        void decrement()                    { --pos_; }
+        void advance(std::ptrdiff_t n)      { pos_ += n; }
+        std::ptrdiff_t distance_to(const CsrInEdgeIterator &o) const {
+            return std::ptrdiff_t(o.pos_) - std::ptrdiff_t(pos_);
+        }
+
+    private:
+        const CsrCallGraph  *graph_;
+        boost::uint32_t     pos_;
+};
+
+/// iterator over all edges of CsrCallGraph, ordered by source vertex
+class CsrEdgeIterator: public boost::iterator_facade<
+        CsrEdgeIterator, CsrEdge, boost::forward_traversal_tag, CsrEdge>
+{
+    public:
+        CsrEdgeIterator(): graph_(0), src_(0), idx_(0) { }
+        inline CsrEdgeIterator(const CsrCallGraph &graph, boost::uint32_t idx);
+
+    private:
+        friend class boost::iterator_core_access;
+
+        CsrEdge dereference() const         { return CsrEdge(src_, idx_); }
+        bool equal(const CsrEdgeIterator &o) const { return idx_ == o.idx_; }
+        inline void increment();
+        inline void skipEmpty();
+
+    private:
+        const CsrCallGraph  *graph_;
+        boost::uint32_t     src_;
+        boost::uint32_t     idx_;
+};
+
+/**
+ * Frozen call graph in the compressed sparse row format. Targets of out edges
+ * of all vertices are stored in one contiguous array indexed by per-vertex
+ * offsets, in edges are stored the same way in reverse arrays. Function data
+ * are stored in columns of FncTable, the same way as CallGraph does.
+ *
+ * The graph is built at once from another graph (usually CallGraph once
+ * loading is done) and can't be modified afterwards. It models the vertex
+ * list, edge list, incidence, bidirectional and adjacency graph concepts, so
+ * that it can be used by BitmapIndexer, PathFinder, VertexFilter and write().
+ * Vertices are numbered from zero, so it can be indexed by BitmapIndexer.
+ */
+class CsrCallGraph {
+    public:
+        typedef boost::uint32_t                         TIdx;
+        typedef std::vector<TIdx>                       TIdxList;
+
+        // graph_traits
+        typedef size_t                                  vertex_descriptor;
+        typedef CsrEdge                                 edge_descriptor;
+        typedef boost::directed_tag                     directed_category;
+        typedef boost::allow_parallel_edge_tag          edge_parallel_category;
+        typedef boost::counting_iterator<size_t>        vertex_iterator;
+        typedef CsrOutEdgeIterator                      out_edge_iterator;
+        typedef CsrInEdgeIterator                       in_edge_iterator;
+        typedef CsrEdgeIterator                         edge_iterator;
+        typedef boost::adjacency_iterator_generator<CsrCallGraph,
+                vertex_descriptor, out_edge_iterator>::type
+                                                        adjacency_iterator;
+        typedef size_t                                  vertices_size_type;
+        typedef size_t                                  edges_size_type;
+        typedef size_t                                  degree_size_type;
+        typedef boost::no_property                      vertex_property_type;
+        typedef boost::no_property                      edge_property_type;
+
+        struct traversal_category:
+            public virtual boost::bidirectional_graph_tag,
+            public virtual boost::adjacency_graph_tag,
+            public virtual boost::vertex_list_graph_tag,
+            public virtual boost::edge_list_graph_tag
+        {
+        };
+
+        static vertex_descriptor null_vertex() {
+            return static_cast<vertex_descriptor>(-1);
+        }
+
+    public:
+        CsrCallGraph() {
+            outOffsets_.push_back(0);
+            inOffsets_.push_back(0);
+        }
+
+        /**
+         * Build the graph from another graph, see assign().
+         */
+        template <typename TGraph>
+        explicit CsrCallGraph(const TGraph &graph) {
+            assign(graph);
+        }
+
+        /**
+         * Replace content of the graph by the given graph. Vertices are
+         * renumbered to be continuous (if the source graph is filtered), but
+         * their order is preserved. Order of out edges is preserved as well.
+         */
+        template <typename TGraph>
+        void assign(const TGraph &graph);
+
+        /**
+         * Renumber vertices, e.g. to improve locality of traversals (see
+         * VertexOrder.hh). Function data are moved along, out edges of each
+         * vertex keep their order.
+         * @param order New number of each vertex, indexed by the current one.
+         */
+        void renumber(const TVertexOrder &order);
+
+        /**
+         * @return Return number the vertex had when the graph was assigned,
+         * i.e. before any renumber() call. Use it to report vertices in order
+         * of the input.
+         */
+        size_t origIndex(size_t v) const {
+            return (origIndex_.empty()) ? v : origIndex_[v];
+        }
+
+        FncTable& fncTable() {
+            return fncTable_;
+        }
+
+        const FncTable& fncTable() const {
+            return fncTable_;
+        }
+
+        size_t numVertices() const {
+            return outOffsets_.size() - 1;
+        }
+
+        size_t numEdges() const {
+            return targets_.size();
+        }
+
+        /// first and last+1 position of out edges of the vertex
+        std::pair<TIdx, TIdx> outRange(size_t v) const {
+            return std::make_pair(outOffsets_[v], outOffsets_[v + 1]);
+        }
+
+        /// first and last+1 position of in edges of the vertex
+        std::pair<TIdx, TIdx> inRange(size_t v) const {
+            return std::make_pair(inOffsets_[v], inOffsets_[v + 1]);
+        }
+
+        /// target vertex of the edge at the given position
+        TIdx targetAt(TIdx idx) const {
+            return targets_[idx];
+        }
+
+        /// in edge at the given position of reverse arrays
+        CsrEdge inEdgeAt(TIdx pos) const {
+            return CsrEdge(sources_[pos], inEdges_[pos]);
+        }
+
+        /**
+         * Write the graph with its function data to a session image, see
+         * Image.hh.
+         */
+        void save(ImageWriter &img) const {
+            img.putVector(outOffsets_);
+            img.putVector(targets_);
+            img.putVector(inOffsets_);
+            img.putVector(sources_);
+            img.putVector(inEdges_);
+            img.putVector(origIndex_);
+            fncTable_.save(img);
+        }
+
+        /**
+         * Read the graph previously written by save(). Arrays are copied out
+         * of the image, which is a plain memory copy. All offsets and vertex
+         * ids are checked, so that a damaged image can't make traversals read
+         * out of the arrays.
+         * @return Return false if the image does not contain a valid graph.
+         */
+        bool load(ImageReader &img) {
+            const bool ok = img.getVector(outOffsets_)
+                && img.getVector(targets_)
+                && img.getVector(inOffsets_)
+                && img.getVector(sources_)
+                && img.getVector(inEdges_)
+                && img.getVector(origIndex_)
+                && fncTable_.load(img)
+                && !outOffsets_.empty()
+                && fncTable_.size() == outOffsets_.size() - 1
+                && (origIndex_.empty()
+                        || origIndex_.size() == outOffsets_.size() - 1)
+                && this->isConsistent();
+            if (!ok)
+                *this = CsrCallGraph();
+
+            return ok;
+        }
+
+        /// @return Return the count of bytes occupied by the graph structure.
+        size_t memoryUsage() const {
+            return sizeof(TIdx) * (outOffsets_.capacity()
+                    + targets_.capacity() + inOffsets_.capacity()
+                    + sources_.capacity() + inEdges_.capacity()
+                    + origIndex_.capacity());
+        }
+
+    private:
+        void buildReverse();
+        bool isConsistent() const;
+
+    private:
+        TIdxList        outOffsets_;
+        TIdxList        targets_;
+        TIdxList        inOffsets_;
+        TIdxList        sources_;
+        TIdxList        inEdges_;
+        TIdxList        origIndex_;     ///< empty if never renumbered
+        FncTable        fncTable_;
+};
+
+template <typename TGraph>
+void CsrCallGraph::assign(const TGraph &graph) {
+    using namespace boost;
+    typedef graph_traits<TGraph>                        Traits;
+    typedef typename property_map<TGraph, FncProp>::const_type TProp;
+    const TProp prop = get(FncProp(), graph);
+    const TIdx NONE = static_cast<TIdx>(-1);
+
+    // number the vertices continuously
+    TIdxList index(num_vertices(graph), NONE);
+    TIdx nVert = 0;
+    typename Traits::vertex_iterator vi, vi_end;
+    for (tie(vi, vi_end) = vertices(graph); vi != vi_end; ++vi)
+        index[*vi] = nVert++;
+
+    fncTable_ = FncTable();
+    fncTable_.reserve(nVert);
+    outOffsets_.clear();
+    outOffsets_.reserve(nVert + 1);
+    targets_.clear();
+    targets_.reserve(num_edges(graph));
+
+    // copy function data and out edges
+    outOffsets_.push_back(0);
+    for (tie(vi, vi_end) = vertices(graph); vi != vi_end; ++vi) {
+        put(FncMap(fncTable_), index[*vi], get(prop, *vi));
+
+        typename Traits::out_edge_iterator ei, ei_end;
+        for (tie(ei, ei_end) = out_edges(*vi, graph); ei != ei_end; ++ei) {
+            const TIdx dst = index[target(*ei, graph)];
+            assert(NONE != dst);
+            targets_.push_back(dst);
+        }
+        outOffsets_.push_back(targets_.size());
+    }
+    TIdxList(targets_).swap(targets_);
+    origIndex_.clear();
+
+    this->buildReverse();
+}
+
+inline void CsrCallGraph::renumber(const TVertexOrder &order) {
+    const size_t nVert = this->numVertices();
+    assert(order.size() == nVert);
+
+    // invert the permutation
+    TIdxList oldIndex(nVert, static_cast<TIdx>(-1));
+    for (size_t v = 0; v < nVert; ++v) {
+        assert(order[v] < nVert);
+        assert(static_cast<TIdx>(-1) == oldIndex[order[v]]);
+        oldIndex[order[v]] = v;
+    }
+
+    // move function data and out edges
+    FncTable fncTable;
+    fncTable.reserve(nVert);
+    TIdxList outOffsets;
+    outOffsets.reserve(nVert + 1);
+    outOffsets.push_back(0);
+    TIdxList targets;
+    targets.reserve(this->numEdges());
+    for (size_t v = 0; v < nVert; ++v) {
+        const TIdx old = oldIndex[v];
+        fncTable.set(v, fncTable_, old);
+        for (TIdx i = outOffsets_[old]; i < outOffsets_[old + 1]; ++i)
+            targets.push_back(order[targets_[i]]);
+        outOffsets.push_back(targets.size());
+    }
+    fncTable_ = fncTable;
+    outOffsets_.swap(outOffsets);
+    targets_.swap(targets);
+
+    // compose with previous renumbering, if any
+    if (!origIndex_.empty())
+        for (size_t v = 0; v < nVert; ++v)
+            oldIndex[v] = origIndex_[oldIndex[v]];
+    origIndex_.swap(oldIndex);
+
+    this->buildReverse();
+}
+
+inline void CsrCallGraph::buildReverse() {
+    const size_t nVert = this->numVertices();
+    const size_t nEdges = this->numEdges();
+
+    // count in edges per vertex
+    inOffsets_.assign(nVert + 1, 0);
+    for (size_t i = 0; i < nEdges; ++i)
+        ++inOffsets_[targets_[i] + 1];
+    for (size_t v = 0; v < nVert; ++v)
+        inOffsets_[v + 1] += inOffsets_[v];
+
+    // scatter edges, in edges of each vertex stay ordered by source
+    sources_.resize(nEdges);
+    inEdges_.resize(nEdges);
+    TIdxList pos(inOffsets_.begin(), inOffsets_.end() - 1);
+    for (TIdx src = 0; src < nVert; ++src) {
+        for (TIdx i = outOffsets_[src]; i < outOffsets_[src + 1]; ++i) {
+            const TIdx p = pos[targets_[i]]++;
+            sources_[p] = src;
+            inEdges_[p] = i;
+        }
+    }
+}
+
+/// O(V+E) check of arrays read from an image, fncTable_ is checked by itself
+inline bool CsrCallGraph::isConsistent() const {
+    const size_t nVert = outOffsets_.size() - 1;
+    const size_t nEdges = targets_.size();
+    if (outOffsets_.size() != inOffsets_.size()
+            || sources_.size() != nEdges || inEdges_.size() != nEdges
+            || outOffsets_.front() || outOffsets_.back() != nEdges
+            || inOffsets_.front() || inOffsets_.back() != nEdges)
+        return false;
+
+    for (size_t v = 0; v < nVert; ++v)
+        if (outOffsets_[v + 1] < outOffsets_[v]
+                || inOffsets_[v + 1] < inOffsets_[v])
+            return false;
+
+    for (size_t i = 0; i < nEdges; ++i)
+        if (nVert <= targets_[i])
+            return false;
+
+    // each in edge refers to an out edge of its source to its target
+    for (size_t v = 0; v < nVert; ++v) {
+        for (TIdx p = inOffsets_[v]; p < inOffsets_[v + 1]; ++p) {
+            const TIdx src = sources_[p];
+            const TIdx idx = inEdges_[p];
+            if (nVert <= src || idx < outOffsets_[src]
+                    || outOffsets_[src + 1] <= idx || targets_[idx] != v)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+inline CsrEdge CsrInEdgeIterator::dereference() const {
+    return graph_->inEdgeAt(pos_);
+}
+
+inline CsrEdgeIterator::CsrEdgeIterator(const CsrCallGraph &graph,
+                                        boost::uint32_t idx):
+    graph_(&graph),
+    src_(0),
+    idx_(idx)
+{
+    this->skipEmpty();
+}
+
+inline void CsrEdgeIterator::increment() {
+    ++idx_;
+    this->skipEmpty();
+}
+
+inline void CsrEdgeIterator::skipEmpty() {
+    // move src_ to the vertex owning the edge at idx_
+    const size_t nVert = graph_->numVertices();
+    while (src_ < nVert && graph_->outRange(src_).second <= idx_)
+        ++src_;
+}
+
+// ///////////////////////////////////////////////////////////////////////////
+// BGL interface
+inline size_t num_vertices(const CsrCallGraph &g) {
+    return g.numVertices();
+}
+
+inline size_t num_edges(const CsrCallGraph &g) {
+    return g.numEdges();
+}
+
+inline std::pair<CsrCallGraph::vertex_iterator, CsrCallGraph::vertex_iterator>
+vertices(const CsrCallGraph &g)
+{
+    typedef CsrCallGraph::vertex_iterator TIter;
+    return std::make_pair(TIter(0), TIter(g.numVertices()));
+}
+
+inline std::pair<CsrEdgeIterator, CsrEdgeIterator>
+edges(const CsrCallGraph &g)
+{
+    return std::make_pair(CsrEdgeIterator(g, 0),
+                          CsrEdgeIterator(g, g.numEdges()));
+}
+
+inline std::pair<CsrOutEdgeIterator, CsrOutEdgeIterator>
+out_edges(size_t v, const CsrCallGraph &g)
+{
+    const std::pair<CsrCallGraph::TIdx, CsrCallGraph::TIdx> r = g.outRange(v);
+    return std::make_pair(CsrOutEdgeIterator(v, r.first),
+                          CsrOutEdgeIterator(v, r.second));
+}
+
+inline std::pair<CsrInEdgeIterator, CsrInEdgeIterator>
+in_edges(size_t v, const CsrCallGraph &g)
+{
+    const std::pair<CsrCallGraph::TIdx, CsrCallGraph::TIdx> r = g.inRange(v);
+    return std::make_pair(CsrInEdgeIterator(g, r.first),
+                          CsrInEdgeIterator(g, r.second));
+}
+
+inline std::pair<CsrCallGraph::adjacency_iterator,
+                 CsrCallGraph::adjacency_iterator>
+adjacent_vertices(size_t v, const CsrCallGraph &g)
+{
+    typedef CsrCallGraph::adjacency_iterator TIter;
+    const std::pair<CsrOutEdgeIterator, CsrOutEdgeIterator> r
+        = out_edges(v, g);
+    return std::make_pair(TIter(r.first, &g), TIter(r.second, &g));
+}
+
+inline size_t out_degree(size_t v, const CsrCallGraph &g) {
+    const std::pair<CsrCallGraph::TIdx, CsrCallGraph::TIdx> r = g.outRange(v);
+    return r.second - r.first;
+}
+
+inline size_t in_degree(size_t v, const CsrCallGraph &g) {
+    const std::pair<CsrCallGraph::TIdx, CsrCallGraph::TIdx> r = g.inRange(v);
+    return r.second - r.first;
+}
+
+inline size_t degree(size_t v, const CsrCallGraph &g) {
+    return out_degree(v, g) + in_degree(v, g);
+}
+
+inline size_t source(const CsrEdge &e, const CsrCallGraph &) {
+    return e.src;
+}
+
+inline size_t target(const CsrEdge &e, const CsrCallGraph &g) {
+    return g.targetAt(e.idx);
+}
+
+// ///////////////////////////////////////////////////////////////////////////
+// property maps
+namespace boost {
+    template <> struct property_map<CsrCallGraph, FncProp> {
+        typedef FncMap type;
+        typedef FncMap const_type;
+    };
+
+    template <> struct property_map<CsrCallGraph, vertex_index_t> {
+        typedef typed_identity_property_map<size_t> type;
+        typedef typed_identity_property_map<size_t> const_type;
+    };
+}
+
+inline FncMap get(FncProp, CsrCallGraph &graph) {
+    return FncMap(graph.fncTable());
+}
+inline FncMap get(FncProp, const CsrCallGraph &graph) {
+    // FncMap is read-write, but put() is never used on const graphs
+    return FncMap(const_cast<FncTable &>(graph.fncTable()));
+}
+
+inline boost::typed_identity_property_map<size_t>
+get(boost::vertex_index_t, const CsrCallGraph &)
+{
+    return boost::typed_identity_property_map<size_t>();
+}
+
+inline size_t get(boost::vertex_index_t, const CsrCallGraph &, size_t v) {
+    return v;
+}
+
+#endif // CSR_CALL_GRAPH_H
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "Demangler.hh"
+
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// part of non-public include/demangle.h from binutils
+extern "C" {
+    extern char* cplus_demangle(const char *mangled, int options);
+#define DMGL_NO_OPTS	 0		/* For readability... */
+#define DMGL_PARAMS	 (1 << 0)	/* Include function args */
+#define DMGL_ANSI	 (1 << 1)	/* Include const, volatile, etc */
+#define DMGL_JAVA	 (1 << 2)	/* Demangle as Java rather than C++. */
+#define DMGL_VERBOSE	 (1 << 3)	/* Include implementation details.  */
+#define DMGL_TYPES	 (1 << 4)	/* Also try to demangle type encodings.  */
+#define DMGL_RET_POSTFIX (1 << 5)       /* Print function return types (when
+                                           present) after function signature */
+}
+
+std::string demangledName(const std::string &name) {
+    char *demangled = cplus_demangle(name.c_str(), DMGL_PARAMS);
+    if (!demangled)
+        return std::string();
+
+    const std::string result(demangled);
+    free(demangled);
+    return result;
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// Demangler implementation
+const unsigned Demangler::N_SHARDS;
+
+std::string Demangler::name(const StringTable &names, TId id) const {
+    Shard &shard = this->shardOf(id);
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        TCache::const_iterator i = shard.cache.find(id);
+        if (shard.cache.end() != i)
+            return (i->second.empty())
+                ? std::string(names[id], names.length(id))
+                : i->second;
+    }
+
+    // demangle without holding the lock, a concurrent duplicate is harmless
+    const std::string raw(names[id], names.length(id));
+    const std::string demangled = demangledName(raw);
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.cache.insert(TCache::value_type(id, demangled));
+    }
+
+    return (demangled.empty())
+        ? raw
+        : demangled;
+}
+
+void Demangler::demangleRange(const StringTable &names, TId first, TId step)
+    const
+{
+    typedef std::vector<TCache::value_type>             TResults;
+    TResults results[N_SHARDS];
+
+    const TId size = names.size();
+    for (TId id = first; id < size; id += step) {
+        Shard &shard = this->shardOf(id);
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            if (shard.cache.count(id))
+                continue;
+        }
+
+        const std::string raw(names[id], names.length(id));
+        results[id % N_SHARDS].push_back(
+                TCache::value_type(id, demangledName(raw)));
+    }
+
+    // store the results by shards, each lock is taken only once
+    for (unsigned i = 0; i < N_SHARDS; ++i) {
+        Shard &shard = shards_[i];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.cache.insert(results[i].begin(), results[i].end());
+    }
+}
+
+void Demangler::demangleAll(const StringTable &names, unsigned nThreads) const {
+    if (!nThreads)
+        nThreads = std::thread::hardware_concurrency();
+    if (!nThreads)
+        nThreads = 1;
+
+    // thread i takes every nThreads-th name starting with i
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < nThreads; ++i)
+        workers.push_back(std::thread(&Demangler::demangleRange, this,
+                    std::cref(names), i, nThreads));
+
+    this->demangleRange(names, 0, nThreads);
+    for (unsigned i = 0; i < workers.size(); ++i)
+        workers[i].join();
+}
+
+size_t Demangler::size() const {
+    size_t size = 0;
+    for (unsigned i = 0; i < N_SHARDS; ++i) {
+        std::lock_guard<std::mutex> guard(shards_[i].lock);
+        size += shards_[i].cache.size();
+    }
+    return size;
+}
+
+void Demangler::clear() {
+    for (unsigned i = 0; i < N_SHARDS; ++i) {
+        std::lock_guard<std::mutex> guard(shards_[i].lock);
+        shards_[i].cache.clear();
+    }
+}
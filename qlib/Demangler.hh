@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DEMANGLER_H
+#define DEMANGLER_H
+
+#include "config.hh"
+#include "StringTable.hh"
+
+#include <map>
+#include <mutex>
+#include <string>
+
+/**
+ * @return Return demangled form of the given symbol name, or an empty string
+ * if the name is not a mangled C++ name.
+ */
+std::string demangledName(const std::string &name);
+
+/**
+ * Memoized demangling of names interned in a StringTable. A name is demangled
+ * the first time it is asked for, the result is kept for the next time. Only
+ * a small fraction of names is ever displayed, so this is much cheaper than
+ * demangling all names while reading the input.
+ *
+ * The cache is split into shards by name id, each with its own lock, so
+ * that name() can be called from more threads at once. demangleAll() fills
+ * the whole cache ahead on a pool of threads.
+ *
+ * The cache is bound to the ids of one table; a copy of Demangler starts with
+ * an empty cache.
+ */
+class Demangler {
+    public:
+        typedef StringTable::TId                        TId;
+
+        /// count of independently locked parts of the cache
+        static const unsigned N_SHARDS = 64;
+
+    public:
+        Demangler() { }
+
+        Demangler(const Demangler &) { }
+
+        Demangler& operator=(const Demangler &) {
+            this->clear();
+            return *this;
+        }
+
+        /**
+         * @return Return demangled form of the name of the given id, or the
+         * name itself if it is not mangled. Safe to call from more threads.
+         */
+        std::string name(const StringTable &names, TId id) const;
+
+        /**
+         * Demangle all names of the table which are not cached yet, on the
+         * given count of threads (zero means one per hardware thread).
+         */
+        void demangleAll(const StringTable &names, unsigned nThreads = 0) const;
+
+        /**
+         * @return Return count of names in the cache.
+         */
+        size_t size() const;
+
+        /**
+         * Drop all cached names.
+         */
+        void clear();
+
+    private:
+        /// demangled name of each id, empty if the name is not mangled
+        typedef std::map<TId, std::string>              TCache;
+
+        struct Shard {
+            std::mutex      lock;
+            TCache          cache;
+        };
+
+        mutable Shard       shards_[N_SHARDS];
+
+    private:
+        Shard& shardOf(TId id) const {
+            return shards_[id % N_SHARDS];
+        }
+
+        void demangleRange(const StringTable &names, TId first, TId step) const;
+};
+
+#endif // DEMANGLER_H
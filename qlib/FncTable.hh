@@ -0,0 +1,388 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FNC_TABLE_H
+#define FNC_TABLE_H
+
+#include "config.hh"
+#include "Demangler.hh"
+#include "Image.hh"
+#include "StringTable.hh"
+
+#include <cassert>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+/// symbol location
+struct Location {
+    std::string     file;       ///< file name
+    long            lineno;     ///< line number
+
+    Location():
+        lineno(-1)
+    {
+    }
+};
+inline bool operator==(const Location &a, const Location &b) {
+    return a.file == b.file
+        && a.lineno == b.lineno;
+}
+inline bool operator!=(const Location &a, const Location &b) {
+    return !operator==(a, b);
+}
+
+/**
+ * per-function data as produced by a reader, FncTable stores them in columns
+ */
+struct Fnc {
+    std::string     name;       ///< function name (identifier)
+    Location        loc;        ///< symbol location
+    bool            isGlobal;   ///< true if symbol name is globally valid
+    bool            isDefined;  ///< true for definition, false for declaration
+
+    Fnc():
+        isGlobal(false),
+        isDefined(false)
+    {
+    }
+};
+
+/// id of an interned call-site location, see FncTable::internCallSite()
+typedef boost::uint32_t TCallSite;
+
+/// call-site id of calls whose location is not known
+const TCallSite NO_CALL_SITE = 0;
+
+/**
+ * Per-function data (vertex properties) of a whole graph, stored by columns.
+ * Names and file names are interned in string tables, so each function costs
+ * only a few integers and there is no per-function heap allocation. Functions
+ * are indexed by vertex index.
+ *
+ * The table also interns call-site locations of graphs which keep them on
+ * edges. Call sites share the file name table with functions.
+ *
+ * Names are kept as read (mangled), prettyName() demangles them on demand.
+ */
+class FncTable {
+    public:
+        typedef StringTable::TId                        TStrId;
+
+        enum EFlags {
+            F_GLOBAL        = 1 << 0,   ///< symbol name is globally valid
+            F_DEFINED       = 1 << 1    ///< definition, not a declaration
+        };
+
+    public:
+        size_t size() const {
+            return name_.size();
+        }
+
+        void reserve(size_t n) {
+            name_.reserve(n);
+            file_.reserve(n);
+            line_.reserve(n);
+            flags_.reserve(n);
+        }
+
+        void resize(size_t n) {
+            name_.resize(n, names_.intern(std::string()));
+            file_.resize(n, files_.intern(std::string()));
+            line_.resize(n, -1);
+            flags_.resize(n, 0);
+        }
+
+        /**
+         * Set properties of the given function, the table grows if needed.
+         */
+        void set(size_t idx, const Fnc &fnc) {
+            set(idx, names_.intern(fnc.name), files_.intern(fnc.loc.file),
+                    fnc.loc.lineno, flagsOf(fnc.isGlobal, fnc.isDefined));
+        }
+
+        /**
+         * Copy properties of a function from another table.
+         */
+        void set(size_t idx, const FncTable &src, size_t srcIdx) {
+            if (&src == this) {
+                set(idx, src.name_[srcIdx], src.file_[srcIdx],
+                        src.line_[srcIdx], src.flags_[srcIdx]);
+                return;
+            }
+            const TStrId name = src.name_[srcIdx];
+            const TStrId file = src.file_[srcIdx];
+            set(idx,
+                    names_.intern(src.names_[name], src.names_.length(name)),
+                    files_.intern(src.files_[file], src.files_.length(file)),
+                    src.line_[srcIdx], src.flags_[srcIdx]);
+        }
+
+        TStrId nameId(size_t idx) const     { return name_[idx]; }
+        TStrId fileId(size_t idx) const     { return file_[idx]; }
+        long line(size_t idx) const         { return line_[idx]; }
+        unsigned flags(size_t idx) const    { return flags_[idx]; }
+
+        std::string name(size_t idx) const {
+            return names_[name_[idx]];
+        }
+
+        std::string file(size_t idx) const {
+            return files_[file_[idx]];
+        }
+
+        /**
+         * @return Return demangled name of the given function, or its name if
+         * it is not mangled. Names are demangled once and cached.
+         */
+        std::string prettyName(size_t idx) const {
+            return demangler_.name(names_, name_[idx]);
+        }
+
+        /**
+         * Demangle all names ahead on the given count of threads (zero means
+         * one per hardware thread), so that prettyName() only hits the cache.
+         */
+        void demangleAll(unsigned nThreads = 0) const {
+            demangler_.demangleAll(names_, nThreads);
+        }
+
+        /**
+         * Write the table to a session image, see Image.hh.
+         */
+        void save(ImageWriter &img) const {
+            names_.save(img);
+            files_.save(img);
+            img.putVector(name_);
+            img.putVector(file_);
+            img.putVector(line_);
+            img.putVector(flags_);
+            img.putVector(sites_);
+        }
+
+        /**
+         * Read the table previously written by save(). Ids of names and files
+         * are checked to be in their string tables.
+         * @return Return false if the image does not contain a valid table.
+         */
+        bool load(ImageReader &img) {
+            *this = FncTable();
+            if (!names_.load(img) || !files_.load(img)
+                    || !img.getVector(name_) || !img.getVector(file_)
+                    || !img.getVector(line_) || !img.getVector(flags_)
+                    || !img.getVector(sites_) || !this->isConsistent())
+            {
+                *this = FncTable();
+                return false;
+            }
+
+            for (size_t i = 0; i < sites_.size(); ++i)
+                siteMap_[sites_[i]] = i + 1;
+
+            return true;
+        }
+
+        /// table of interned function names
+        const StringTable& names() const    { return names_; }
+
+        /// table of interned file names
+        const StringTable& files() const    { return files_; }
+
+        /**
+         * @return Return id of the given call-site location, the location
+         * is added to the table if not already there.
+         */
+        TCallSite internCallSite(const Location &loc) {
+            return internCallSite(files_.intern(loc.file), loc.lineno);
+        }
+
+        /**
+         * Intern a call-site location taken from another table.
+         */
+        TCallSite internCallSite(const FncTable &src, TCallSite site) {
+            if (NO_CALL_SITE == site)
+                return NO_CALL_SITE;
+
+            const TStrId file = src.sites_[site - 1].first;
+            return internCallSite(
+                    files_.intern(src.files_[file], src.files_.length(file)),
+                    src.sites_[site - 1].second);
+        }
+
+        /**
+         * @return Return location of the given call site.
+         */
+        Location callSite(TCallSite site) const {
+            Location loc;
+            if (NO_CALL_SITE != site) {
+                loc.file = files_[sites_[site - 1].first];
+                loc.lineno = sites_[site - 1].second;
+            }
+            return loc;
+        }
+
+    private:
+        typedef std::vector<TStrId>                     TStrColumn;
+        typedef std::vector<boost::int32_t>             TLineColumn;
+        typedef std::vector<unsigned char>              TFlagColumn;
+        typedef std::pair<TStrId, boost::int32_t>       TSite;
+        typedef std::vector<TSite>                      TSiteList;
+        typedef std::map<TSite, TCallSite>              TSiteMap;
+
+        StringTable     names_;
+        StringTable     files_;
+        TStrColumn      name_;
+        TStrColumn      file_;
+        TLineColumn     line_;
+        TFlagColumn     flags_;
+        TSiteList       sites_;
+        TSiteMap        siteMap_;
+        Demangler       demangler_;
+
+    private:
+        TCallSite internCallSite(TStrId file, long line) {
+            const TSite site(file, line);
+            TSiteMap::iterator i = siteMap_.find(site);
+            if (siteMap_.end() != i)
+                return i->second;
+
+            sites_.push_back(site);
+            return siteMap_[site] = sites_.size();
+        }
+
+        /// check of columns read from an image
+        bool isConsistent() const {
+            const size_t n = name_.size();
+            if (file_.size() != n || line_.size() != n || flags_.size() != n)
+                return false;
+
+            for (size_t i = 0; i < n; ++i)
+                if (names_.size() <= name_[i] || files_.size() <= file_[i])
+                    return false;
+
+            for (size_t i = 0; i < sites_.size(); ++i)
+                if (files_.size() <= sites_[i].first)
+                    return false;
+
+            return true;
+        }
+
+        static unsigned flagsOf(bool isGlobal, bool isDefined) {
+            return (isGlobal ? F_GLOBAL : 0)
+                | (isDefined ? F_DEFINED : 0);
+        }
+
+        void set(size_t idx, TStrId name, TStrId file, long line,
+                 unsigned flags)
+        {
+            if (size() <= idx)
+                resize(idx + 1);
+
+            name_[idx]  = name;
+            file_[idx]  = file;
+            line_[idx]  = line;
+            flags_[idx] = flags;
+        }
+};
+
+/**
+ * Read-only view of one function in FncTable. It is cheap to create and copy,
+ * all data are fetched from the table on demand.
+ */
+class FncRef {
+    public:
+        FncRef(const FncTable *table, size_t idx):
+            table_(table),
+            idx_(idx)
+        {
+        }
+
+        std::string name() const        { return table_->name(idx_); }
+        std::string prettyName() const  { return table_->prettyName(idx_); }
+        std::string file() const        { return table_->file(idx_); }
+        long line() const               { return table_->line(idx_); }
+
+        bool isGlobal() const {
+            return table_->flags(idx_) & FncTable::F_GLOBAL;
+        }
+
+        bool isDefined() const {
+            return table_->flags(idx_) & FncTable::F_DEFINED;
+        }
+
+        /// true if both functions are at the same location (file and line)
+        bool sameLocation(const FncRef &other) const {
+            if (table_ == other.table_)
+                return table_->fileId(idx_) == table_->fileId(other.idx_)
+                    && line() == other.line();
+
+            return file() == other.file()
+                && line() == other.line();
+        }
+
+        const FncTable& table() const   { return *table_; }
+        size_t index() const            { return idx_; }
+
+    private:
+        const FncTable  *table_;
+        size_t          idx_;
+};
+
+/**
+ * Pointer-like handle of function properties, returned by property map of the
+ * FncProp vertex property. Use -> to access the data.
+ */
+class PFnc {
+    public:
+        PFnc(const FncTable &table, size_t idx):
+            ref_(&table, idx)
+        {
+            assert(idx < table.size());
+        }
+
+        const FncRef* operator->() const {
+            return &ref_;
+        }
+
+        const FncRef& operator*() const {
+            return ref_;
+        }
+
+    private:
+        FncRef ref_;
+};
+
+inline std::ostream &operator<< (std::ostream &str, PFnc fnc) {
+    if (!fnc->isDefined())
+        str << "@decl ";
+
+    if (!fnc->isGlobal())
+        str << "@static ";
+
+    str << fnc->prettyName()
+        << " (" << fnc->file() << ":" << fnc->line() << ")";
+
+    return str;
+}
+
+#endif // FNC_TABLE_H
@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "config.hh"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Session image (snapshot) is a binary file which is memory-mapped when
+ * loaded. It is a sequence of arrays, each of them stored as its element
+ * count followed by raw elements. Elements of each array start on an ALIGN
+ * boundary of the file, so that they can be used in place once the file is
+ * mapped. Objects write themselves by save(ImageWriter &) and read themselves
+ * back by load(ImageReader &) in the same order.
+ *
+ * Images are meant to be loaded on the machine they were written on, there
+ * is no conversion of byte order or sizes, the header only guards against
+ * mismatches.
+ */
+namespace Image {
+    /// alignment of arrays in the image (cache line)
+    const size_t ALIGN = 64;
+
+    const char MAGIC[] = "cgt-image-3";
+}
+
+/**
+ * Writes arrays to an image (see Image.hh), the stream has to be binary.
+ */
+class ImageWriter {
+    public:
+        ImageWriter(std::ostream &str):
+            str_(str),
+            pos_(0)
+        {
+            this->putBytes(Image::MAGIC, sizeof Image::MAGIC);
+            const boost::uint32_t hdr[] = {
+                0x01020304,                     // byte order
+                sizeof(void *),
+                sizeof(long)
+            };
+            this->putArray(hdr, sizeof hdr / sizeof *hdr);
+        }
+
+        /// write an array of trivially copyable elements
+        template <typename T>
+        void putArray(const T *data, size_t count) {
+            this->beginArray(count);
+            this->append(data, count);
+        }
+
+        /**
+         * Start an array of the given element count, the elements are then
+         * written piecewise by append(). It is used to write arrays which are
+         * not contiguous in memory.
+         */
+        void beginArray(size_t count) {
+            const boost::uint64_t n = count;
+            this->putBytes(&n, sizeof n);
+            this->pad();
+        }
+
+        /// write elements of the array started by beginArray()
+        template <typename T>
+        void append(const T *data, size_t count) {
+            this->putBytes(data, count * sizeof(T));
+        }
+
+        template <typename T>
+        void putVector(const std::vector<T> &vec) {
+            this->putArray(vec.empty() ? 0 : &vec[0], vec.size());
+        }
+
+        /// write one trivially copyable value
+        template <typename T>
+        void put(const T &value) {
+            this->putArray(&value, 1);
+        }
+
+        bool good() const {
+            return str_.good();
+        }
+
+    private:
+        std::ostream        &str_;
+        boost::uint64_t     pos_;
+
+    private:
+        void putBytes(const void *data, size_t size) {
+            if (size)
+                str_.write(static_cast<const char *>(data), size);
+            pos_ += size;
+        }
+
+        void pad() {
+            static const char zeros[Image::ALIGN] = { 0 };
+            this->putBytes(zeros, (Image::ALIGN - pos_ % Image::ALIGN)
+                    % Image::ALIGN);
+        }
+};
+
+/**
+ * Reads arrays of an image (see Image.hh) which is whole in memory, usually
+ * mapped by MappedFile. Arrays can be either copied, or viewed in place as
+ * long as the memory stays mapped. Once anything fails, good() returns false
+ * and all further reads fail.
+ */
+class ImageReader {
+    public:
+        ImageReader(const char *data, size_t size):
+            data_(data),
+            size_(size),
+            pos_(0),
+            good_(true)
+        {
+            const boost::uint32_t *hdr;
+            size_t n;
+            good_ = sizeof Image::MAGIC <= size
+                && !std::memcmp(data, Image::MAGIC, sizeof Image::MAGIC);
+            pos_ = sizeof Image::MAGIC;
+            good_ = good_
+                && this->view(hdr, n) && 3 == n
+                && 0x01020304 == hdr[0]
+                && sizeof(void *) == hdr[1]
+                && sizeof(long) == hdr[2];
+        }
+
+        /// point data to an array in the image, count is its element count
+        template <typename T>
+        bool view(const T *&data, size_t &count) {
+            boost::uint64_t n;
+            if (!this->getBytes(&n, sizeof n))
+                return false;
+
+            pos_ += (Image::ALIGN - pos_ % Image::ALIGN) % Image::ALIGN;
+            if (size_ < pos_ || (size_ - pos_) / sizeof(T) < n)
+                return good_ = false;
+
+            data = reinterpret_cast<const T *>(data_ + pos_);
+            count = n;
+            pos_ += n * sizeof(T);
+            return true;
+        }
+
+        /// copy an array of the image to the given vector
+        template <typename T>
+        bool getVector(std::vector<T> &vec) {
+            const T *data;
+            size_t count;
+            if (!this->view(data, count))
+                return false;
+
+            vec.assign(data, data + count);
+            return true;
+        }
+
+        /// read one value written by ImageWriter::put()
+        template <typename T>
+        bool get(T &value) {
+            const T *data;
+            size_t count;
+            if (!this->view(data, count) || 1 != count)
+                return good_ = false;
+
+            value = *data;
+            return true;
+        }
+
+        bool good() const {
+            return good_;
+        }
+
+    private:
+        const char          *data_;
+        size_t              size_;
+        size_t              pos_;
+        bool                good_;
+
+    private:
+        bool getBytes(void *dst, size_t size) {
+            if (!good_ || size_ < pos_ || size_ - pos_ < size)
+                return good_ = false;
+
+            std::memcpy(dst, data_ + pos_, size);
+            pos_ += size;
+            return true;
+        }
+};
+
+/**
+ * Read-only array which either owns its elements, or uses them in place of a
+ * mapped image.
+ */
+template <typename T>
+class ImageArray {
+    public:
+        ImageArray():
+            view_(0),
+            size_(0)
+        {
+        }
+
+        /// take over elements of the given vector, which is left empty
+        void assign(std::vector<T> &vec) {
+            own_.clear();
+            own_.swap(vec);
+            view_ = 0;
+            size_ = own_.size();
+        }
+
+        const T* data() const {
+            if (view_)
+                return view_;
+
+            return (own_.empty()) ? 0 : &own_[0];
+        }
+
+        size_t size() const {
+            return size_;
+        }
+
+        const T& operator[](size_t idx) const {
+            return this->data()[idx];
+        }
+
+        /// @return Return count of bytes owned by the array.
+        size_t memoryUsage() const {
+            return own_.capacity() * sizeof(T);
+        }
+
+        void save(ImageWriter &img) const {
+            img.putArray(this->data(), size_);
+        }
+
+        /// use the array of the image in place
+        bool load(ImageReader &img) {
+            own_.clear();
+            if (img.view(view_, size_))
+                return true;
+
+            view_ = 0;
+            size_ = 0;
+            return false;
+        }
+
+    private:
+        std::vector<T>      own_;
+        const T             *view_;
+        size_t              size_;
+};
+
+/**
+ * Read-only memory mapping of a whole file. Pages are read in lazily by the
+ * kernel as they are touched.
+ */
+class MappedFile {
+    public:
+        MappedFile():
+            data_(0),
+            size_(0)
+        {
+        }
+
+        ~MappedFile() {
+            this->close();
+        }
+
+        /**
+         * Map the given file, a previously mapped file is unmapped.
+         * @return Return false if the file can't be opened or mapped.
+         */
+        bool open(const std::string &fileName) {
+            this->close();
+
+            const int fd = ::open(fileName.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+
+            struct stat st;
+            if (fstat(fd, &st) || !st.st_size) {
+                ::close(fd);
+                return false;
+            }
+
+            void *addr = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (MAP_FAILED == addr)
+                return false;
+
+            data_ = static_cast<const char *>(addr);
+            size_ = st.st_size;
+            return true;
+        }
+
+        void close() {
+            if (data_)
+                munmap(const_cast<char *>(data_), size_);
+
+            data_ = 0;
+            size_ = 0;
+        }
+
+        const char* data() const {
+            return data_;
+        }
+
+        size_t size() const {
+            return size_;
+        }
+
+        /// @return Return true if the mapped file begins as an image does
+        bool isImage() const {
+            return sizeof Image::MAGIC <= size_
+                && !std::memcmp(data_, Image::MAGIC, sizeof Image::MAGIC);
+        }
+
+    private:
+        const char      *data_;
+        size_t          size_;
+
+    private:
+        MappedFile(const MappedFile &);
+        MappedFile& operator=(const MappedFile &);
+};
+
+#endif // IMAGE_H
@@ -22,13 +22,13 @@
 
 #include "config.hh"
 #include "CallGraph.hh"
+#include "StringTable.hh"
 // FIXME: do not write directly to stderr
 #include "Color.hh"
 
 // FIXME: do not write directly to stderr
 #include <iostream>
-#include <map>
-#include <string>
+#include <vector>
 
 #include <boost/graph/adjacency_list.hpp>
 
@@ -41,7 +41,8 @@ class Linker {
 
     public:
         Linker():
-            fncProp_(get(FncProp(), graph_))
+            fncProp_(get(FncProp(), graph_)),
+            merger_(graph_)
         {
         }
 
@@ -54,74 +55,104 @@ class Linker {
             using namespace boost;
 
             typedef graph_traits<TChunk>                TChunkTraits;
-            typedef std::map<TVertex, TVertex>          TVertexMap;
-            TVertexMap vertexMap;
+            typedef std::vector<TVertex>                TVertexMap;
+            TVertexMap vertexMap(num_vertices(chunk));
+            const TVertex firstNew = num_vertices(graph_);
 
             // for each vertex
             typename TChunkTraits::vertex_iterator vi, vi_end;
-            for(tie(vi, vi_end) = vertices(chunk); vi != vi_end; ++vi) {
-                TVertex v = *vi;
-                PFnc fnc = get(get(FncProp(), chunk), v);
-                if (!fnc->isGlobal) {
-                    // static declaration/definition
-                    vertexMap[v] = add_vertex(fnc, graph_);
-                    continue;
-                }
-
-                std::string &symbol = fnc->name;
-                typename TSymbolTable::iterator i = symbolTable_.find(symbol);
-                if (i == symbolTable_.end()) {
-                    // add function to symbol table
-                    TVertex mv = add_vertex(fnc, graph_);
-                    symbolTable_[symbol] = mv;
-                    vertexMap[v] = mv;
-                    continue;
-                }
-                TVertex masterVertex = i->second;
-                vertexMap[v] = masterVertex;
-                PFnc prev = get(fncProp_, masterVertex);
-                if (fnc->isDefined) {
-                    // function already in symbol table
-
-                    if (prev->isDefined) {
-                        // function redefinition
-                        if (fnc->loc != prev->loc) {
-                            // FIXME: do not write directly to stderr
-                            std::cerr << Color(C_LIGHT_RED)
-                                << "Redefinition: " << fnc
-                                << Color(C_NO_COLOR) << std::endl;
-                            std::cerr << Color(C_LIGHT_PURPLE)
-                                << "Previous definition: " << prev
-                                << Color(C_NO_COLOR) << std::endl;
-                        }
-                    } else {
-                        // rewrite declaration by definition
-                        put(fncProp_, masterVertex, fnc);
-                    }
-                }
-            }
-
-            // edge (call) property
-            typedef property_map<TChunk, CallProp>      TEdgePropMapping;
-            typedef typename TEdgePropMapping::type     TEdgeProp;
-            TEdgeProp edgeProp = get(CallProp(), chunk);
+            for(tie(vi, vi_end) = vertices(chunk); vi != vi_end; ++vi)
+                vertexMap[*vi] = this->linkFnc(get(get(FncProp(), chunk), *vi));
 
             // for each edge (call)
+            const FncTable &chunkTable = get(FncProp(), chunk).table();
             typename TChunkTraits::edge_iterator ei, ei_end;
             for(tie(ei, ei_end) = edges(chunk); ei != ei_end; ++ei) {
-                add_edge(vertexMap[source(*ei, chunk)],
-                    vertexMap[target(*ei, chunk)], get(edgeProp, *ei),
-                    graph_);
+                const TCallSite site = (HasCallSites<TGraph>::value)
+                    ? graph_.fncTable().internCallSite(chunkTable,
+                                                       call_site_id(*ei, chunk))
+                    : NO_CALL_SITE;
+
+                merger_.add(vertexMap[source(*ei, chunk)],
+                        vertexMap[target(*ei, chunk)],
+                        call_count(*ei, chunk), site);
+            }
+            merger_.flush(firstNew);
+        }
+
+        /**
+         * Link a single function into the output graph.
+         * @return Return vertex of the function in the output graph. It is
+         * a new one for static functions and for global symbols not seen
+         * before, the vertex of the symbol otherwise.
+         */
+        TVertex linkFnc(const PFnc &fnc) {
+            if (!fnc->isGlobal()) {
+                // static declaration/definition
+                return add_vertex(fnc, graph_);
+            }
+
+            // look up the symbol by name interned in the source table
+            const StringTable &names = fnc->table().names();
+            const FncTable::TStrId name = fnc->table().nameId(fnc->index());
+            const StringTable::TId symbol =
+                symbols_.intern(names[name], names.length(name));
+            if (symbolVertex_.size() == symbol) {
+                // add function to symbol table
+                TVertex mv = add_vertex(fnc, graph_);
+                symbolVertex_.push_back(mv);
+                return mv;
             }
+            TVertex masterVertex = symbolVertex_[symbol];
+            PFnc prev = get(fncProp_, masterVertex);
+            if (fnc->isDefined()) {
+                // function already in symbol table
+
+                if (prev->isDefined()) {
+                    // function redefinition
+                    if (!fnc->sameLocation(*prev)) {
+                        // FIXME: do not write directly to stderr
+                        std::cerr << Color(C_LIGHT_RED)
+                            << "Redefinition: " << fnc
+                            << Color(C_NO_COLOR) << std::endl;
+                        std::cerr << Color(C_LIGHT_PURPLE)
+                            << "Previous definition: " << prev
+                            << Color(C_NO_COLOR) << std::endl;
+                    }
+                } else {
+                    // rewrite declaration by definition
+                    put(fncProp_, masterVertex, fnc);
+                }
+            }
+            return masterVertex;
+        }
+
+        /**
+         * Add calls between vertices of the output graph, repeated calls are
+         * merged, see CallMerger.
+         * @param calls Container of (caller, callee) pairs of vertices.
+         * @param firstNew Vertices from this one on were added since the last
+         * call and their edge lists get exact capacity.
+         */
+        template <typename TCallList>
+        void addCalls(const TCallList &calls, TVertex firstNew) {
+            typename TCallList::const_iterator i;
+            for (i = calls.begin(); i != calls.end(); ++i)
+                merger_.add(i->first, i->second);
+
+            merger_.flush(firstNew);
         }
+
     private:
         typedef boost::property_map<TGraph, FncProp>    TPropMapping;
         typedef typename TPropMapping::type             TProp;
-        typedef typename std::map<std::string, TVertex> TSymbolTable;
+        typedef std::vector<TVertex>                    TSymbolVertices;
 
         TGraph          graph_;
         TProp           fncProp_;
-        TSymbolTable    symbolTable_;
+        CallMerger<TGraph> merger_;
+        StringTable     symbols_;       ///< names of global symbols
+        TSymbolVertices symbolVertex_;  ///< vertex of each global symbol
 };
 
 #endif // LINKER_H
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "config.hh"
+#include "NameDict.hh"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    void putVarint(std::vector<unsigned char> &data, size_t val) {
+        while (0x80 <= val) {
+            data.push_back(static_cast<unsigned char>(val | 0x80));
+            val >>= 7;
+        }
+        data.push_back(static_cast<unsigned char>(val));
+    }
+
+    size_t getVarint(const unsigned char *&ptr) {
+        size_t val = 0;
+        unsigned shift = 0;
+        unsigned char c;
+        do {
+            c = *ptr++;
+            val |= static_cast<size_t>(c & 0x7F) << shift;
+            shift += 7;
+        } while (c & 0x80);
+        return val;
+    }
+
+    size_t commonPrefix(const std::string &a, const std::string &b) {
+        size_t len = std::min(a.size(), b.size());
+        size_t i = 0;
+        while (i < len && a[i] == b[i])
+            ++i;
+        return i;
+    }
+
+    /// decode one bucket entry into name (which holds the previous entry)
+    const unsigned char* decodeEntry(const unsigned char *ptr, std::string &name,
+                                     bool head)
+    {
+        size_t lcp = head ? 0 : getVarint(ptr);
+        size_t len = getVarint(ptr);
+        name.resize(lcp);
+        name.append(reinterpret_cast<const char *>(ptr), len);
+        return ptr + len;
+    }
+
+    int cmpBytes(const unsigned char *ptr, size_t len, const std::string &str) {
+        int rv = std::memcmp(ptr, str.data(), std::min(len, str.size()));
+        if (rv)
+            return rv;
+        return (len < str.size()) ? -1 : (len > str.size());
+    }
+}
+
+NameDict::NameDict():
+    size_(0)
+{
+}
+
+void NameDict::build(std::vector<std::string> &names) {
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    size_ = names.size();
+    data_.clear();
+    buckets_.clear();
+    buckets_.reserve((size_ + BUCKET_SIZE - 1) / BUCKET_SIZE);
+
+    for (size_t i = 0; i < size_; ++i) {
+        const std::string &name = names[i];
+        size_t lcp = 0;
+        if (i % BUCKET_SIZE)
+            lcp = commonPrefix(names[i - 1], name);
+        else
+            buckets_.push_back(data_.size());
+
+        if (i % BUCKET_SIZE)
+            putVarint(data_, lcp);
+        putVarint(data_, name.size() - lcp);
+        data_.insert(data_.end(), name.begin() + lcp, name.end());
+    }
+
+    // release the excess capacity, the dictionary is not going to grow
+    TData(data_).swap(data_);
+}
+
+int NameDict::cmpHead(size_t bucket, const std::string &name) const {
+    const unsigned char *ptr = &data_[buckets_[bucket]];
+    size_t len = getVarint(ptr);
+    return cmpBytes(ptr, len, name);
+}
+
+size_t NameDict::findBucket(const std::string &name) const {
+    // find the last bucket whose head is not greater than name
+    size_t lo = 0, hi = buckets_.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (cmpHead(mid, name) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+NameDict::TId NameDict::lowerBound(const std::string &name) const {
+    size_t bucket = findBucket(name);
+    if (!bucket)
+        // name precedes all bucket heads
+        return 0;
+    --bucket;
+
+    TId id = bucket * BUCKET_SIZE;
+    const TId last = std::min<size_t>(size_, id + BUCKET_SIZE);
+    const unsigned char *ptr = &data_[buckets_[bucket]];
+    std::string current;
+    for (; id < last; ++id) {
+        ptr = decodeEntry(ptr, current, id % BUCKET_SIZE == 0);
+        if (name <= current)
+            return id;
+    }
+    return id;
+}
+
+NameDict::TId NameDict::find(const std::string &name) const {
+    TId id = lowerBound(name);
+    if (id < size_ && (*this)[id] == name)
+        return id;
+    return NOT_FOUND;
+}
+
+NameDict::TRange NameDict::prefixRange(const std::string &prefix) const {
+    TId first = lowerBound(prefix);
+
+    // the smallest string greater than all strings with the given prefix
+    std::string succ(prefix);
+    while (!succ.empty() && static_cast<unsigned char>(*succ.rbegin()) == 0xFF)
+        succ.erase(succ.size() - 1);
+    if (succ.empty())
+        return TRange(first, size_);
+    ++*succ.rbegin();
+
+    return TRange(first, lowerBound(succ));
+}
+
+std::string NameDict::operator[](TId id) const {
+    size_t bucket = id / BUCKET_SIZE;
+    const unsigned char *ptr = &data_[buckets_[bucket]];
+    std::string name;
+    for (TId i = bucket * BUCKET_SIZE; i <= id; ++i)
+        ptr = decodeEntry(ptr, name, i == bucket * BUCKET_SIZE);
+    return name;
+}
+
+size_t NameDict::memoryUsage() const {
+    return sizeof(*this)
+        + data_.capacity() * sizeof(TData::value_type)
+        + buckets_.capacity() * sizeof(TOffsets::value_type);
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NAME_DICT_H
+#define NAME_DICT_H
+
+#include "config.hh"
+#include "CallGraph.hh"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+/**
+ * Immutable sorted dictionary of symbol names. Names are front-coded in
+ * buckets of BUCKET_SIZE names: the first name of each bucket is stored as is,
+ * the others only as the length of the prefix shared with the previous name
+ * plus the remaining suffix. Mangled C++ names share long prefixes, so this
+ * is several times smaller than keeping each name in its own std::string.
+ *
+ * Each name is identified by its position in the sorted order (TId). Lookup
+ * is a binary search over bucket heads followed by a scan of one bucket. Since
+ * the order is lexicographical, all names sharing a prefix form a continuous
+ * range of ids.
+ *
+ * The dictionary only serves prefix queries (see SymbolMap::findPrefix()), it
+ * is built in memory when first needed. Names of a graph are stored in its
+ * FncTable, which is also what an image of the graph keeps on disk.
+ */
+class NameDict {
+    public:
+        typedef boost::uint32_t                         TId;
+        typedef std::pair<TId, TId>                     TRange;
+
+        /// returned by find() if there is no such name
+        static const TId NOT_FOUND = static_cast<TId>(-1);
+
+        /// count of names per bucket
+        static const unsigned BUCKET_SIZE = 16;
+
+    public:
+        NameDict();
+
+        /**
+         * (Re)build the dictionary from the given names. The list does not
+         * need to be sorted and may contain duplicates, it is sorted in place.
+         */
+        void build(std::vector<std::string> &names);
+
+        /**
+         * @return Return the count of (unique) names in the dictionary.
+         */
+        size_t size() const {
+            return size_;
+        }
+
+        /**
+         * @return Return id of the given name or NOT_FOUND.
+         */
+        TId find(const std::string &name) const;
+
+        /**
+         * @return Return id of the first name which is not less than the given
+         * one. Return size() if there is no such name.
+         */
+        TId lowerBound(const std::string &name) const;
+
+        /**
+         * @return Return range [first, last) of ids of all names beginning
+         * with the given prefix. The range is empty if there is none.
+         */
+        TRange prefixRange(const std::string &prefix) const;
+
+        /**
+         * Decode name of the given id.
+         */
+        std::string operator[](TId id) const;
+
+        /**
+         * @return Return count of bytes occupied by the dictionary.
+         */
+        size_t memoryUsage() const;
+
+    private:
+        typedef std::vector<unsigned char>              TData;
+        typedef std::vector<boost::uint32_t>            TOffsets;
+
+        size_t          size_;
+        TData           data_;
+        TOffsets        buckets_;
+
+    private:
+        int cmpHead(size_t bucket, const std::string &name) const;
+        size_t findBucket(const std::string &name) const;
+};
+
+/**
+ * Build dictionary of names of all functions in the given call graph.
+ */
+template <typename TGraph>
+void buildNameDict(NameDict &dict, const TGraph &graph) {
+    using namespace boost;
+
+    typedef graph_traits<TGraph>                        Traits;
+    typedef property_map<TGraph, FncProp>               TPropMapping;
+    typedef typename TPropMapping::const_type           TProp;
+    TProp prop = get(FncProp(), graph);
+
+    std::vector<std::string> names;
+    names.reserve(num_vertices(graph));
+
+    typename Traits::vertex_iterator vi, vi_end;
+    for (tie(vi, vi_end) = vertices(graph); vi != vi_end; ++vi)
+        names.push_back(get(prop, *vi)->name());
+
+    dict.build(names);
+}
+
+#endif // NAME_DICT_H
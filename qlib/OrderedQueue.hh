@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ORDERED_QUEUE_H
+#define ORDERED_QUEUE_H
+
+#include "config.hh"
+
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+/**
+ * Bounded queue connecting several producers with one consumer, which takes
+ * items in order of their sequence numbers, no matter in which order they were
+ * produced. Producers claim sequence numbers by claim(). At most capacity
+ * items can be claimed and not yet consumed, so that producers are blocked
+ * while the consumer is behind.
+ * @param T Type of item, the queue takes ownership of items pushed to it.
+ */
+template <typename T>
+class OrderedQueue {
+    public:
+        /**
+         * @param count Count of items to pass through the queue.
+         * @param capacity Maximal count of items claimed and not yet popped.
+         */
+        OrderedQueue(size_t count, size_t capacity):
+            count_(count),
+            capacity_(capacity),
+            claimed_(0),
+            popped_(0)
+        {
+            assert(0 < capacity);
+        }
+
+        ~OrderedQueue() {
+            typename TWindow::iterator i;
+            for (i = window_.begin(); i != window_.end(); ++i)
+                delete *i;
+        }
+
+        /**
+         * Claim the next sequence number, wait if the queue is full.
+         * @return Return the sequence number, or count if all are claimed.
+         */
+        size_t claim() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (claimed_ < count_ && popped_ + capacity_ <= claimed_)
+                canClaim_.wait(lock);
+
+            if (count_ <= claimed_)
+                return count_;
+
+            window_.push_back(0);
+            return claimed_++;
+        }
+
+        /// push item of the claimed sequence number
+        void push(size_t seq, T *item) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            assert(popped_ <= seq && seq < claimed_);
+            window_[seq - popped_] = item;
+            if (seq == popped_)
+                canPop_.notify_one();
+        }
+
+        /**
+         * Wait for the next item in order.
+         * @return Return the item (to be deleted by caller), or 0 if all items
+         * are already consumed.
+         */
+        T* pop() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (count_ <= popped_)
+                return 0;
+
+            while (window_.empty() || !window_.front())
+                canPop_.wait(lock);
+
+            T *item = window_.front();
+            window_.pop_front();
+            ++popped_;
+            canClaim_.notify_all();
+            return item;
+        }
+
+    private:
+        typedef std::deque<T *>                         TWindow;
+
+        const size_t            count_;
+        const size_t            capacity_;
+        size_t                  claimed_;
+        size_t                  popped_;
+        TWindow                 window_;    ///< items from popped_ to claimed_
+        std::mutex              mutex_;
+        std::condition_variable canClaim_;
+        std::condition_variable canPop_;
+};
+
+#endif // ORDERED_QUEUE_H
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "PerfectHash.hh"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    const boost::uint64_t GOLDEN = 0x9E3779B97F4A7C15ULL;
+
+    /// mean count of keys per bucket
+    const size_t BUCKET_SIZE = 4;
+
+    /// seeds tried for one bucket before the whole hash is salted again
+    const boost::uint32_t MAX_SEED = 1U << 28;
+
+    // finalizer of splitmix64
+    inline boost::uint64_t mix(boost::uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ULL;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    boost::uint64_t hashKey(const char *str, size_t len, boost::uint64_t salt) {
+        boost::uint64_t hash = salt ^ (len * GOLDEN);
+        size_t i = 0;
+        for (; i + sizeof hash <= len; i += sizeof hash) {
+            boost::uint64_t word;
+            std::memcpy(&word, str + i, sizeof word);
+            hash = mix(hash ^ word);
+        }
+
+        boost::uint64_t tail = 0;
+        std::memcpy(&tail, str + i, len - i);
+        return mix(hash ^ tail);
+    }
+
+    inline size_t bucketOf(boost::uint64_t hash, size_t nBuckets) {
+        return (hash >> 32) % nBuckets;
+    }
+
+    inline size_t positionOf(boost::uint64_t hash, boost::uint32_t seed,
+                             size_t size)
+    {
+        return mix(hash + seed * GOLDEN) % size;
+    }
+}
+
+PerfectHash::PerfectHash():
+    salt_(0),
+    size_(0),
+    nBuckets_(0)
+{
+}
+
+void PerfectHash::build(const char *data, const boost::uint32_t *offsets,
+                        size_t n)
+{
+    size_ = n;
+    nBuckets_ = std::max<size_t>(1, n / BUCKET_SIZE);
+
+    // different salt on each failure, it does not happen for sane key sets
+    for (salt_ = 0; !this->place(data, offsets); salt_ = mix(salt_ + GOLDEN))
+        ;
+}
+
+bool PerfectHash::place(const char *data, const boost::uint32_t *offsets) {
+    typedef std::vector<boost::uint64_t>                THashList;
+    typedef std::vector<boost::uint32_t>                TList;
+
+    // hash keys into buckets (bucket b has keys inBucket[start[b]..])
+    THashList hash(size_);
+    TList start(nBuckets_ + 1, 0);
+    for (size_t i = 0; i < size_; ++i) {
+        hash[i] = hashKey(data + offsets[i], offsets[i + 1] - offsets[i] - 1,
+                          salt_);
+        ++start[bucketOf(hash[i], nBuckets_) + 1];
+    }
+    size_t maxSize = 0;
+    for (size_t b = 0; b < nBuckets_; ++b) {
+        maxSize = std::max<size_t>(maxSize, start[b + 1]);
+        start[b + 1] += start[b];
+    }
+    THashList inBucket(size_);
+    {
+        TList fill(start.begin(), start.end() - 1);
+        for (size_t i = 0; i < size_; ++i)
+            inBucket[fill[bucketOf(hash[i], nBuckets_)]++] = hash[i];
+    }
+
+    // order buckets from the largest one (counting sort)
+    TList bySize;
+    bySize.reserve(nBuckets_);
+    {
+        std::vector<TList> ofSize(maxSize + 1);
+        for (size_t b = 0; b < nBuckets_; ++b)
+            ofSize[start[b + 1] - start[b]].push_back(b);
+        for (size_t s = maxSize; 0 < s; --s)
+            bySize.insert(bySize.end(), ofSize[s].begin(), ofSize[s].end());
+    }
+
+    // find a seed for each bucket which moves all its keys to free positions
+    TList seeds(nBuckets_, 0);
+    std::vector<bool> taken(size_, false);
+    TList pos(maxSize);
+    for (TList::const_iterator bi = bySize.begin(); bi != bySize.end(); ++bi) {
+        const THashList::iterator first = inBucket.begin() + start[*bi];
+        const THashList::iterator last = inBucket.begin() + start[*bi + 1];
+
+        // keys of the same hash can't be separated by any seed
+        std::sort(first, last);
+        if (std::adjacent_find(first, last) != last)
+            return false;
+
+        for (boost::uint32_t seed = 0;; ++seed) {
+            if (MAX_SEED == seed)
+                return false;
+
+            size_t cnt = 0;
+            for (THashList::const_iterator i = first; i != last; ++i, ++cnt) {
+                const size_t p = positionOf(*i, seed, size_);
+                if (taken[p])
+                    break;
+
+                taken[p] = true;
+                pos[cnt] = p;
+            }
+            if (first + cnt == last) {
+                seeds[*bi] = seed;
+                break;
+            }
+
+            // roll back the keys placed with this seed
+            while (cnt)
+                taken[pos[--cnt]] = false;
+        }
+    }
+
+    seeds_.assign(seeds);
+    return true;
+}
+
+size_t PerfectHash::operator()(const char *str, size_t len) const {
+    if (!size_)
+        return 0;
+
+    const boost::uint64_t hash = hashKey(str, len, salt_);
+    return positionOf(hash, seeds_[bucketOf(hash, nBuckets_)], size_);
+}
+
+size_t PerfectHash::memoryUsage() const {
+    return sizeof(*this)
+        + seeds_.memoryUsage();
+}
+
+void PerfectHash::save(ImageWriter &img) const {
+    const boost::uint64_t hdr[] = { salt_, size_, nBuckets_ };
+    img.putArray(hdr, sizeof hdr / sizeof *hdr);
+    seeds_.save(img);
+}
+
+bool PerfectHash::load(ImageReader &img) {
+    const boost::uint64_t *hdr;
+    size_t n;
+    if (!img.view(hdr, n) || 3 != n || !seeds_.load(img)
+            || seeds_.size() != hdr[2] || (hdr[1] && !hdr[2]))
+    {
+        *this = PerfectHash();
+        return false;
+    }
+
+    salt_ = hdr[0];
+    size_ = hdr[1];
+    nBuckets_ = hdr[2];
+    return true;
+}
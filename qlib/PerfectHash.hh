@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PERFECT_HASH_H
+#define PERFECT_HASH_H
+
+#include "config.hh"
+#include "Image.hh"
+
+#include <string>
+
+#include <boost/cstdint.hpp>
+
+/**
+ * Minimal perfect hash of a fixed set of strings. Each of the N keys given to
+ * build() is mapped to a distinct position in 0..N-1. Strings which are not
+ * among the keys are mapped to an arbitrary position, so callers have to
+ * compare the key stored at that position.
+ *
+ * It is a hash-and-displace scheme (CHD): keys are hashed into buckets of
+ * about four keys, and each bucket is given a seed which moves all its keys to
+ * free positions. Buckets are placed from the largest one, when there are
+ * still many free positions. The hash takes a 32-bit seed per bucket, i.e. one
+ * byte per key, and each lookup hashes the key once.
+ *
+ * The seeds can be used in place of a mapped image (see Image.hh), so a hash
+ * loaded from an image costs nothing until it is used.
+ */
+class PerfectHash {
+    public:
+        PerfectHash();
+
+        /**
+         * Build the hash of the given keys, which are zero-terminated strings
+         * in data, key i starting at offsets[i] (there are N + 1 offsets, the
+         * last one is the end of data). Keys have to be distinct.
+         */
+        void build(const char *data, const boost::uint32_t *offsets, size_t n);
+
+        /**
+         * @return Return position of the given string, it is less than size()
+         * unless the hash is empty.
+         */
+        size_t operator()(const char *str, size_t len) const;
+
+        size_t operator()(const std::string &str) const {
+            return (*this)(str.data(), str.size());
+        }
+
+        /**
+         * @return Return count of keys.
+         */
+        size_t size() const {
+            return size_;
+        }
+
+        /**
+         * @return Return count of bytes occupied by the hash (without the
+         * image it may be using in place).
+         */
+        size_t memoryUsage() const;
+
+        /**
+         * Write the hash to a session image.
+         */
+        void save(ImageWriter &) const;
+
+        /**
+         * Read the hash previously written by save(). The seeds are used in
+         * place, so the image has to stay mapped as long as the hash is used.
+         * @return Return false if the image does not contain a hash.
+         */
+        bool load(ImageReader &);
+
+    private:
+        typedef ImageArray<boost::uint32_t>             TSeeds;
+
+        boost::uint64_t         salt_;
+        size_t                  size_;
+        size_t                  nBuckets_;
+        TSeeds                  seeds_;     ///< seed of each bucket
+
+    private:
+        bool place(const char *data, const boost::uint32_t *offsets);
+};
+
+#endif // PERFECT_HASH_H
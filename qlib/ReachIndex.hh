@@ -0,0 +1,577 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REACH_INDEX_H
+#define REACH_INDEX_H
+
+#include "config.hh"
+#include "BitmapIndex.hh"
+#include "Image.hh"
+#include "VertexFilter.hh"
+#include "VertexOrder.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/graph/graph_traits.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace ReachIndexImpl {
+    const boost::uint32_t NONE = static_cast<boost::uint32_t>(-1);
+}
+
+/**
+ * ReachIndexer answers reachability queries on graphs too big for bitmap
+ * indexes of all vertices. It has the interface of BitmapIndexer, but it
+ * keeps O(N + E) data only: strongly connected components, their
+ * condensation (a DAG) and interval labels of the condensation in the manner
+ * of GRAIL. Each label is [lowest post-order rank of descendants, own rank]
+ * from a depth-first traversal of the DAG, each traversal visits children in
+ * another order. If component u reaches component v, v's interval lies
+ * within u's one in all labels, so most negative queries are answered by
+ * comparing the labels. Components are numbered callees first, which rules
+ * out another half of pairs. The first traversal also gives intervals of its
+ * spanning tree, which prove reachability of descendants in the tree. What is
+ * left is answered by a search of the DAG which skips components whose labels
+ * do not contain the target and stops at any tree ancestor of it.
+ *
+ * Reachability has the meaning of BitmapIndexer: u reaches v if there is a
+ * path of at least one edge, so a vertex reaches itself only if it is in a
+ * cycle.
+ *
+ * index() computes one index at a time on demand, the returned bitmap is only
+ * valid till the next call for the same direction. Labels are computed on the
+ * first query, they are not written to session images (they are cheaper to
+ * compute again than to read).
+ *
+ * @param TGraph Type of graph with continuous vertex numbers.
+ */
+template <typename TGraph>
+class ReachIndexer;
+
+/**
+ * Vertex predicate of the factor of paths from src to dst, the same as that of
+ * BitmapVertexPredicate created from indexes. Vertices are tested by queries
+ * of ReachIndexer as they are asked for, and the answers are remembered (two
+ * bits per vertex, shared by copies of the predicate) since path finders ask
+ * for each vertex many times.
+ */
+template <typename TGraph>
+class ReachVertexPredicate {
+    public:
+        typedef typename boost::graph_traits<TGraph>    Traits;
+        typedef typename Traits::vertex_descriptor      TVertex;
+
+    public:
+        /**
+         * Dummy constructor internally used by boost::filtered_graph which
+         * should be never used manually.
+         */
+        ReachVertexPredicate():
+            indexer_(0)
+        {
+        }
+
+        ReachVertexPredicate(ReachIndexer<TGraph> &indexer, TVertex src,
+                             TVertex dst):
+            indexer_(&indexer),
+            src_(src),
+            dst_(dst),
+            known_(new TBitmapIndex(num_vertices(indexer.graph()))),
+            member_(new TBitmapIndex(num_vertices(indexer.graph())))
+        {
+        }
+
+        bool operator() (TVertex vertex) const {
+            if ((*known_)[vertex])
+                return (*member_)[vertex];
+
+            const bool member = vertex == src_ || vertex == dst_
+                || (indexer_->reaches(src_, vertex)
+                        && indexer_->reaches(vertex, dst_));
+            known_->set(vertex);
+            member_->set(vertex, member);
+            return member;
+        }
+
+    private:
+        typedef boost::shared_ptr<TBitmapIndex>         TBitmapPtr;
+
+        ReachIndexer<TGraph>    *indexer_;
+        TVertex                 src_;
+        TVertex                 dst_;
+        TBitmapPtr              known_;
+        TBitmapPtr              member_;
+};
+
+/**
+ * Factor of paths from src to dst defined by ReachIndexer queries, the
+ * counterpart of BitmapFilter.
+ */
+template <typename TGraph>
+class ReachFilter:
+    public VertexFilter<TGraph, ReachVertexPredicate>
+{
+    typedef VertexFilter<TGraph, ReachVertexPredicate> TFilter;
+    public:
+        typedef boost::graph_traits<TGraph>             Traits;
+        typedef ReachVertexPredicate<TGraph>            TPred;
+        typedef typename Traits::vertex_descriptor      TVertex;
+
+    public:
+        ReachFilter(ReachIndexer<TGraph> &indexer, TVertex src, TVertex dst):
+            TFilter(indexer.graph(), TPred(indexer, src, dst))
+        {
+        }
+};
+
+template <typename TGraph>
+class ReachIndexer {
+    public:
+        typedef typename boost::graph_traits<TGraph>    Traits;
+        typedef typename Traits::vertex_descriptor      TVertex;
+        typedef TBitmapIndex                            TIndex;
+        typedef ReachFilter<TGraph>                     TFilter;
+        typedef enum { IN, OUT }                        EDirection;
+
+    public:
+        /**
+         * @param graph Graph to answer queries on, it must stay valid and
+         * unchanged as long as the indexer is used.
+         * @param nLabels Count of interval labels of each component.
+         */
+        ReachIndexer(const TGraph &graph, unsigned nLabels = 3):
+            graph_(graph),
+            nLabels_(nLabels),
+            nComp_(0),
+            epoch_(0)
+        {
+            assert(nLabels_);
+        }
+
+        const TGraph& graph() const {
+            return graph_;
+        }
+
+        /**
+         * @return Return true if there is a path (of at least one edge) from
+         * vertex u to vertex v.
+         */
+        bool reaches(TVertex u, TVertex v) {
+            assert(u < num_vertices(graph_) && v < num_vertices(graph_));
+            this->build();
+
+            const boost::uint32_t cu = comp_[u];
+            const boost::uint32_t cv = comp_[v];
+            if (cu == cv)
+                return cyclic_[cu];
+
+            return this->reachesComp(cu, cv);
+        }
+
+        /**
+         * Compute the bitmap index of the given vertex, see
+         * BitmapIndexer::index(). It takes O(N + E) and the result is
+         * overwritten by the next call for the same direction.
+         */
+        const TIndex& index(TVertex vertex, EDirection dir) {
+            assert(vertex < num_vertices(graph_));
+            this->build();
+
+            TIndex &index = scratch_[dir];
+            index.resize(num_vertices(graph_));
+            index.reset();
+
+            const TCompList &start = (OUT == dir) ? childStart_ : parentStart_;
+            const TCompList &next = (OUT == dir) ? children_ : parents_;
+            const boost::uint32_t comp = comp_[vertex];
+            if (cyclic_[comp])
+                this->setMembers(index, comp);
+
+            const boost::uint32_t epoch = this->nextEpoch();
+            TCompList &stack = stack_;
+            stack.assign(1, comp);
+            while (!stack.empty()) {
+                const boost::uint32_t c = stack.back();
+                stack.pop_back();
+                for (boost::uint32_t i = start[c]; i < start[c + 1]; ++i) {
+                    const boost::uint32_t d = next[i];
+                    if (epoch == visited_[d])
+                        continue;
+
+                    visited_[d] = epoch;
+                    this->setMembers(index, d);
+                    stack.push_back(d);
+                }
+            }
+
+            return index;
+        }
+
+        /**
+         * Compute the condensation and its labels if not done yet. Indexes
+         * of both directions are answered by the same labels.
+         */
+        void build() {
+            if (comp_.size() != num_vertices(graph_))
+                this->buildLabels();
+        }
+
+        void build(EDirection) {
+            this->build();
+        }
+
+        /**
+         * Labels answer both directions, there is nothing to transpose.
+         */
+        void transpose(EDirection) {
+            this->build();
+        }
+
+        /**
+         * Free everything computed so far.
+         */
+        void clear() {
+            nComp_ = 0;
+            TCompList().swap(comp_);
+            TCompList().swap(memberStart_);
+            TCompList().swap(members_);
+            TCompList().swap(childStart_);
+            TCompList().swap(children_);
+            TCompList().swap(parentStart_);
+            TCompList().swap(parents_);
+            TCompList().swap(labels_);
+            TCompList().swap(treeLow_);
+            TCompList().swap(visited_);
+            std::vector<bool>().swap(cyclic_);
+            scratch_[IN].clear();
+            scratch_[OUT].clear();
+        }
+
+        void clear(EDirection) {
+            this->clear();
+        }
+
+        /**
+         * @return Return count of bytes occupied by the labels and the
+         * condensation.
+         */
+        size_t memoryUsage() const {
+            return sizeof(boost::uint32_t) * (comp_.capacity()
+                    + memberStart_.capacity() + members_.capacity()
+                    + childStart_.capacity() + children_.capacity()
+                    + parentStart_.capacity() + parents_.capacity()
+                    + labels_.capacity() + treeLow_.capacity()
+                    + visited_.capacity())
+                + cyclic_.capacity() / 8;
+        }
+
+        /**
+         * Labels are never worth storing, see save().
+         */
+        bool isComplete(EDirection) const {
+            return false;
+        }
+
+        /**
+         * Labels are not stored, only the graph hash and the kind of indexes
+         * are, so that bitmap indexers refuse the image.
+         */
+        void save(ImageWriter &img) const {
+            img.put(graphHash(graph_));
+            img.put(static_cast<boost::uint32_t>(IS_LABELS));
+        }
+
+        /**
+         * @return Return false if the image was not written by ReachIndexer
+         * for a graph of the same hash.
+         */
+        bool load(ImageReader &img) {
+            this->clear();
+            boost::uint64_t hash;
+            boost::uint32_t kind;
+            return img.get(hash) && hash == graphHash(graph_)
+                && img.get(kind)
+                && kind == static_cast<boost::uint32_t>(IS_LABELS);
+        }
+
+    private:
+        typedef std::vector<boost::uint32_t>            TCompList;
+
+        const TGraph        &graph_;
+        const unsigned      nLabels_;
+        TCompList           comp_;          ///< component of each vertex
+        size_t              nComp_;
+        TCompList           memberStart_;   ///< vertices of each component
+        TCompList           members_;
+        TCompList           childStart_;    ///< edges of the condensation
+        TCompList           children_;
+        TCompList           parentStart_;   ///< reversed edges
+        TCompList           parents_;
+        std::vector<bool>   cyclic_;        ///< components which reach self
+        TCompList           labels_;        ///< (low, post) pairs per comp
+        TCompList           treeLow_;       ///< low of the first DFS tree
+        TCompList           visited_;       ///< epoch of the last visit
+        boost::uint32_t     epoch_;
+        TCompList           stack_;
+        TIndex              scratch_[2];
+
+    private:
+        /// @return Return true if labels of a allow it to reach b
+        bool contains(boost::uint32_t a, boost::uint32_t b) const {
+            const boost::uint32_t *la = &labels_[2 * nLabels_ * a];
+            const boost::uint32_t *lb = &labels_[2 * nLabels_ * b];
+            for (unsigned i = 0; i < 2 * nLabels_; i += 2)
+                if (lb[i] < la[i] || la[i + 1] < lb[i + 1])
+                    return false;
+
+            return true;
+        }
+
+        /// @return Return true if b is below a in the first DFS tree
+        bool treeContains(boost::uint32_t a, boost::uint32_t b) const {
+            const size_t stride = 2 * nLabels_;
+            const boost::uint32_t post = labels_[stride * b + 1];
+            return treeLow_[a] <= post && post <= labels_[stride * a + 1];
+        }
+
+        bool reachesComp(boost::uint32_t cu, boost::uint32_t cv) {
+            // components are numbered callees first
+            if (cu < cv || !this->contains(cu, cv))
+                return false;
+            if (this->treeContains(cu, cv))
+                return true;
+
+            // search children whose labels do not rule the target out
+            const boost::uint32_t epoch = this->nextEpoch();
+            TCompList &stack = stack_;
+            stack.assign(1, cu);
+            while (!stack.empty()) {
+                const boost::uint32_t c = stack.back();
+                stack.pop_back();
+                for (boost::uint32_t i = childStart_[c]; i < childStart_[c + 1];
+                        ++i)
+                {
+                    const boost::uint32_t d = children_[i];
+                    if (d == cv || this->treeContains(d, cv))
+                        return true;
+
+                    if (epoch == visited_[d] || d < cv
+                            || !this->contains(d, cv))
+                        continue;
+
+                    visited_[d] = epoch;
+                    stack.push_back(d);
+                }
+            }
+
+            return false;
+        }
+
+        boost::uint32_t nextEpoch() {
+            if (!++epoch_) {
+                std::fill(visited_.begin(), visited_.end(), 0);
+                epoch_ = 1;
+            }
+
+            return epoch_;
+        }
+
+        void setMembers(TIndex &index, boost::uint32_t comp) const {
+            for (boost::uint32_t i = memberStart_[comp];
+                    i < memberStart_[comp + 1]; ++i)
+                index.set(members_[i]);
+        }
+
+        void buildLabels() {
+            this->clear();
+            nComp_ = strongComponents(graph_, comp_);
+            this->buildCondensation();
+            labels_.resize(2 * nLabels_ * nComp_);
+            treeLow_.assign(nComp_, ReachIndexImpl::NONE);
+            visited_.assign(nComp_, 0);
+            epoch_ = 0;
+
+            for (unsigned i = 0; i < nLabels_; ++i)
+                this->buildLabel(i);
+        }
+
+        void buildCondensation() {
+            using namespace boost;
+            const size_t nVert = num_vertices(graph_);
+
+            // members of each component
+            memberStart_.assign(nComp_ + 1, 0);
+            for (TVertex v = 0; v < nVert; ++v)
+                ++memberStart_[comp_[v] + 1];
+            for (size_t c = 0; c < nComp_; ++c)
+                memberStart_[c + 1] += memberStart_[c];
+            members_.resize(nVert);
+            {
+                TCompList fill(memberStart_.begin(), memberStart_.end() - 1);
+                for (TVertex v = 0; v < nVert; ++v)
+                    members_[fill[comp_[v]]++] = v;
+            }
+
+            // edges between components, each one once
+            cyclic_.assign(nComp_, false);
+            childStart_.assign(1, 0);
+            childStart_.reserve(nComp_ + 1);
+            TCompList lastSeen(nComp_, ReachIndexImpl::NONE);
+            TCompList inDegree(nComp_, 0);
+            for (boost::uint32_t c = 0; c < nComp_; ++c) {
+                if (1 < memberStart_[c + 1] - memberStart_[c])
+                    cyclic_[c] = true;
+
+                for (boost::uint32_t i = memberStart_[c];
+                        i < memberStart_[c + 1]; ++i)
+                {
+                    typename Traits::out_edge_iterator oi, oi_end;
+                    for (tie(oi, oi_end) = out_edges(members_[i], graph_);
+                            oi != oi_end; ++oi)
+                    {
+                        const boost::uint32_t d = comp_[target(*oi, graph_)];
+                        if (d == c)
+                            cyclic_[c] = true;
+                        else if (lastSeen[d] != c) {
+                            lastSeen[d] = c;
+                            children_.push_back(d);
+                            ++inDegree[d];
+                        }
+                    }
+                }
+                childStart_.push_back(children_.size());
+            }
+
+            // reversed edges
+            parentStart_.assign(nComp_ + 1, 0);
+            for (boost::uint32_t c = 0; c < nComp_; ++c)
+                parentStart_[c + 1] = parentStart_[c] + inDegree[c];
+            parents_.resize(children_.size());
+            TCompList fill(parentStart_.begin(), parentStart_.end() - 1);
+            for (boost::uint32_t c = 0; c < nComp_; ++c)
+                for (boost::uint32_t i = childStart_[c]; i < childStart_[c + 1];
+                        ++i)
+                    parents_[fill[children_[i]]++] = c;
+        }
+
+        /// assign one interval label by a DFS of the condensation
+        void buildLabel(unsigned label) {
+            using ReachIndexImpl::NONE;
+            using BitmapIndexImpl::mix;
+
+            // roots (components without callers) in shuffled order
+            TCompList roots;
+            for (boost::uint32_t c = nComp_; c; --c)
+                if (parentStart_[c - 1] == parentStart_[c])
+                    roots.push_back(c - 1);
+            for (size_t i = roots.size(); label && 1 < i; --i)
+                std::swap(roots[i - 1], roots[mix(label * i) % i]);
+
+            struct Frame {
+                boost::uint32_t     comp;
+                boost::uint32_t     offset;     ///< first child visited
+                boost::uint32_t     next;       ///< count of children done
+            };
+
+            std::vector<Frame> frames;
+            boost::uint32_t rank = 0;
+            const size_t stride = 2 * nLabels_;
+            boost::uint32_t *const lbl = &labels_[2 * label];
+            for (boost::uint32_t c = 0; c < nComp_; ++c)
+                lbl[c * stride] = lbl[c * stride + 1] = NONE;
+
+            for (TCompList::const_iterator ri = roots.begin(); ri != roots.end();
+                    ++ri)
+            {
+                frames.push_back(this->frame<Frame>(*ri, label));
+                lbl[*ri * stride] = NONE - 1;
+
+                while (!frames.empty()) {
+                    Frame &top = frames.back();
+                    const boost::uint32_t c = top.comp;
+                    const boost::uint32_t deg = childStart_[c + 1]
+                        - childStart_[c];
+                    if (top.next < deg) {
+                        const boost::uint32_t d = children_[childStart_[c]
+                            + (top.offset + top.next++) % deg];
+                        boost::uint32_t &low = lbl[c * stride];
+                        if (NONE != lbl[d * stride + 1]) {
+                            // done already
+                            low = std::min(low, lbl[d * stride]);
+                            continue;
+                        }
+
+                        // descend (the condensation has no cycles)
+                        lbl[d * stride] = NONE - 1;
+                        frames.push_back(this->frame<Frame>(d, label));
+                        continue;
+                    }
+
+                    // post-order rank, low is the lowest rank below
+                    const boost::uint32_t post = rank++;
+                    boost::uint32_t &low = lbl[c * stride];
+                    lbl[c * stride + 1] = post;
+                    low = std::min(low, post);
+                    if (!label)
+                        treeLow_[c] = std::min(treeLow_[c], post);
+
+                    frames.pop_back();
+                    if (frames.empty())
+                        continue;
+
+                    // the parent in the tree
+                    const boost::uint32_t parent = frames.back().comp;
+                    boost::uint32_t &parentLow = lbl[parent * stride];
+                    parentLow = std::min(parentLow, low);
+                    if (!label)
+                        treeLow_[parent] = std::min(treeLow_[parent],
+                                                    treeLow_[c]);
+                }
+            }
+
+            assert(rank == nComp_);
+        }
+
+        template <typename TFrame>
+        TFrame frame(boost::uint32_t comp, unsigned label) const {
+            const boost::uint32_t deg = childStart_[comp + 1]
+                - childStart_[comp];
+            TFrame f;
+            f.comp = comp;
+            f.offset = (label && deg)
+                ? BitmapIndexImpl::mix(comp * 31 + label) % deg
+                : 0;
+            f.next = 0;
+            return f;
+        }
+};
+
+namespace boost {
+    /// property maps of ReachFilter are those of the original graph
+    template <typename TGraph, typename TTag>
+    struct property_map<ReachFilter<TGraph>, TTag>:
+        public property_map<TGraph, TTag>
+    {
+    };
+}
+
+#endif // REACH_INDEX_H
@@ -0,0 +1,862 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "RoaringBitmap.hh"
+
+#include <cassert>
+#include <cstring>
+
+using namespace RoaringImpl;
+
+const size_t RoaringBitmap::npos;
+
+namespace {
+    const boost::uint32_t CHUNK_BITS    = 16;
+    const boost::uint32_t CHUNK_SIZE    = 1 << CHUNK_BITS;
+    const boost::uint32_t LOW_MASK      = CHUNK_SIZE - 1;
+    const boost::uint32_t ARRAY_MAX     = 4096;
+    const boost::uint32_t WORDS         = CHUNK_SIZE / 64;
+
+    typedef std::vector<boost::uint64_t>                TBits;
+    typedef std::vector<TWord>                          TData;
+
+    inline unsigned popCount(boost::uint64_t word) {
+        return __builtin_popcountll(word);
+    }
+
+    inline unsigned lowestBit(boost::uint64_t word) {
+        return __builtin_ctzll(word);
+    }
+
+    /// set bits first..last (inclusive) of a bitset
+    void setRange(boost::uint64_t *bits, boost::uint32_t first,
+                  boost::uint32_t last)
+    {
+        const boost::uint32_t fw = first / 64;
+        const boost::uint32_t lw = last / 64;
+        const boost::uint64_t fm = ~0ULL << (first % 64);
+        const boost::uint64_t lm = ~0ULL >> (63 - last % 64);
+        if (fw == lw) {
+            bits[fw] |= fm & lm;
+            return;
+        }
+
+        bits[fw] |= fm;
+        for (boost::uint32_t i = fw + 1; i < lw; ++i)
+            bits[i] = ~0ULL;
+        bits[lw] |= lm;
+    }
+
+    boost::uint32_t countBits(const TBits &bits) {
+        boost::uint32_t cnt = 0;
+        for (size_t i = 0; i < bits.size(); ++i)
+            cnt += popCount(bits[i]);
+        return cnt;
+    }
+
+    /// @return Return the lowest bit set (or clear) from pos, or CHUNK_SIZE
+    boost::uint32_t nextBit(const TBits &bits, boost::uint32_t pos, bool set) {
+        if (CHUNK_SIZE <= pos)
+            return CHUNK_SIZE;
+
+        boost::uint32_t i = pos / 64;
+        boost::uint64_t word = (set) ? bits[i] : ~bits[i];
+        word &= ~0ULL << (pos % 64);
+        while (!word) {
+            if (WORDS == ++i)
+                return CHUNK_SIZE;
+            word = (set) ? bits[i] : ~bits[i];
+        }
+
+        return i * 64 + lowestBit(word);
+    }
+
+    inline boost::uint32_t runCount(const Container &c) {
+        return c.data.size() / 2;
+    }
+
+    inline boost::uint32_t runStart(const Container &c, boost::uint32_t i) {
+        return c.data[2 * i];
+    }
+
+    inline boost::uint32_t runLast(const Container &c, boost::uint32_t i) {
+        return c.data[2 * i] + c.data[2 * i + 1];
+    }
+
+    void pushRun(TData &runs, boost::uint32_t first, boost::uint32_t last) {
+        runs.push_back(first);
+        runs.push_back(last - first);
+    }
+
+    void makeBitset(Container &c) {
+        if (K_BITSET == c.kind)
+            return;
+
+        TBits bits(WORDS, 0);
+        if (K_ARRAY == c.kind) {
+            for (TData::const_iterator i = c.data.begin(); i != c.data.end(); ++i)
+                bits[*i / 64] |= 1ULL << (*i % 64);
+        }
+        else {
+            for (boost::uint32_t i = 0; i < runCount(c); ++i)
+                setRange(&bits[0], runStart(c, i), runLast(c, i));
+        }
+
+        c.bits.swap(bits);
+        TData().swap(c.data);
+        c.kind = K_BITSET;
+    }
+
+    void makeArray(Container &c) {
+        if (K_ARRAY == c.kind)
+            return;
+
+        assert(c.card <= ARRAY_MAX);
+        TData data;
+        data.reserve(c.card);
+        if (K_BITSET == c.kind) {
+            for (boost::uint32_t i = 0; i < WORDS; ++i)
+                for (boost::uint64_t w = c.bits[i]; w; w &= w - 1)
+                    data.push_back(i * 64 + lowestBit(w));
+        }
+        else {
+            for (boost::uint32_t i = 0; i < runCount(c); ++i)
+                for (boost::uint32_t v = runStart(c, i); v <= runLast(c, i); ++v)
+                    data.push_back(v);
+        }
+
+        c.data.swap(data);
+        TBits().swap(c.bits);
+        c.kind = K_ARRAY;
+    }
+
+    void makeRuns(Container &c) {
+        TData runs;
+        if (K_RUN == c.kind)
+            return;
+
+        if (K_ARRAY == c.kind) {
+            boost::uint32_t first = c.data[0];
+            for (size_t i = 1; i < c.data.size(); ++i) {
+                if (c.data[i] == c.data[i - 1] + 1)
+                    continue;
+                pushRun(runs, first, c.data[i - 1]);
+                first = c.data[i];
+            }
+            pushRun(runs, first, c.data.back());
+        }
+        else {
+            boost::uint32_t pos = nextBit(c.bits, 0, true);
+            while (pos < CHUNK_SIZE) {
+                const boost::uint32_t end = nextBit(c.bits, pos, false);
+                pushRun(runs, pos, end - 1);
+                pos = nextBit(c.bits, end, true);
+            }
+        }
+
+        c.data.swap(runs);
+        TBits().swap(c.bits);
+        c.kind = K_RUN;
+    }
+
+    boost::uint32_t countRuns(const Container &c) {
+        boost::uint32_t cnt = 0;
+        switch (c.kind) {
+            case K_ARRAY:
+                for (size_t i = 0; i < c.data.size(); ++i)
+                    if (!i || c.data[i] != c.data[i - 1] + 1)
+                        ++cnt;
+                break;
+
+            case K_BITSET: {
+                // a run starts where a bit is set and the one below is not
+                boost::uint64_t carry = 0;
+                for (boost::uint32_t i = 0; i < WORDS; ++i) {
+                    const boost::uint64_t w = c.bits[i];
+                    cnt += popCount(w & ~((w << 1) | carry));
+                    carry = w >> 63;
+                }
+                break;
+            }
+
+            case K_RUN:
+                cnt = runCount(c);
+                break;
+        }
+
+        return cnt;
+    }
+
+    /// convert the container to the smallest kind
+    void optimizeContainer(Container &c) {
+        const size_t runBytes = 4 * countRuns(c);
+        const size_t arrayBytes = (c.card <= ARRAY_MAX)
+            ? 2 * c.card
+            : static_cast<size_t>(-1);
+        const size_t bitsetBytes = 8 * WORDS;
+
+        if (runBytes < std::min(arrayBytes, bitsetBytes))
+            makeRuns(c);
+        else if (arrayBytes <= bitsetBytes)
+            makeArray(c);
+        else
+            makeBitset(c);
+
+        // drop the slack of arrays grown by set()
+        if (c.data.size() < c.data.capacity())
+            TData(c.data).swap(c.data);
+    }
+
+    /// @return Return index of the run containing low, or of the run below
+    /// it, or -1 if there is none
+    int findRun(const Container &c, boost::uint32_t low) {
+        int lo = 0;
+        int hi = runCount(c);
+        while (lo < hi) {
+            const int mid = (lo + hi) / 2;
+            if (runStart(c, mid) <= low)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        return lo - 1;
+    }
+
+    bool testContainer(const Container &c, boost::uint32_t low) {
+        switch (c.kind) {
+            case K_ARRAY:
+                return std::binary_search(c.data.begin(), c.data.end(), low);
+
+            case K_BITSET:
+                return (c.bits[low / 64] >> (low % 64)) & 1;
+
+            case K_RUN: {
+                const int i = findRun(c, low);
+                return 0 <= i && low <= runLast(c, i);
+            }
+        }
+
+        return false;
+    }
+
+    /// @return Return the lowest bit set from low, or CHUNK_SIZE
+    boost::uint32_t nextInContainer(const Container &c, boost::uint32_t low) {
+        switch (c.kind) {
+            case K_ARRAY: {
+                TData::const_iterator i =
+                    std::lower_bound(c.data.begin(), c.data.end(), low);
+                return (c.data.end() == i) ? CHUNK_SIZE : *i;
+            }
+
+            case K_BITSET:
+                return nextBit(c.bits, low, true);
+
+            case K_RUN: {
+                const int i = findRun(c, low);
+                if (0 <= i && low <= runLast(c, i))
+                    return low;
+                if (static_cast<boost::uint32_t>(i + 1) < runCount(c))
+                    return runStart(c, i + 1);
+                return CHUNK_SIZE;
+            }
+        }
+
+        return CHUNK_SIZE;
+    }
+
+    /// @return Return the highest bit set
+    boost::uint32_t lastInContainer(const Container &c) {
+        switch (c.kind) {
+            case K_ARRAY:
+                return c.data.back();
+
+            case K_BITSET:
+                for (boost::uint32_t i = WORDS; i; --i)
+                    if (c.bits[i - 1])
+                        return (i - 1) * 64 + 63 - __builtin_clzll(c.bits[i - 1]);
+                break;
+
+            case K_RUN:
+                return runLast(c, runCount(c) - 1);
+        }
+
+        return 0;
+    }
+
+    /// or bits of the container to a bitset
+    void orInto(TBits &bits, const Container &c) {
+        switch (c.kind) {
+            case K_ARRAY:
+                for (TData::const_iterator i = c.data.begin(); i != c.data.end();
+                        ++i)
+                    bits[*i / 64] |= 1ULL << (*i % 64);
+                break;
+
+            case K_BITSET:
+                for (boost::uint32_t i = 0; i < WORDS; ++i)
+                    bits[i] |= c.bits[i];
+                break;
+
+            case K_RUN:
+                for (boost::uint32_t i = 0; i < runCount(c); ++i)
+                    setRange(&bits[0], runStart(c, i), runLast(c, i));
+                break;
+        }
+    }
+
+    /// keep only positions of an array which are (or are not) in the other
+    void filterArray(Container &c, const Container &other, bool keep) {
+        TData data;
+        for (TData::const_iterator i = c.data.begin(); i != c.data.end(); ++i)
+            if (testContainer(other, *i) == keep)
+                data.push_back(*i);
+
+        c.data.swap(data);
+        c.card = c.data.size();
+    }
+
+    void orContainer(Container &c, const Container &other) {
+        if (K_RUN == c.kind && CHUNK_SIZE == c.card)
+            // full already
+            return;
+
+        if (K_ARRAY == c.kind && K_ARRAY == other.kind) {
+            TData data;
+            data.reserve(c.data.size() + other.data.size());
+            std::set_union(c.data.begin(), c.data.end(),
+                           other.data.begin(), other.data.end(),
+                           std::back_inserter(data));
+            c.data.swap(data);
+            c.card = c.data.size();
+            if (ARRAY_MAX < c.card)
+                makeBitset(c);
+            return;
+        }
+
+        if (K_RUN == c.kind && K_RUN == other.kind) {
+            // merge runs by their start, join overlapping and adjacent ones
+            TData runs;
+            boost::uint32_t i = 0, j = 0;
+            const boost::uint32_t ni = runCount(c), nj = runCount(other);
+            boost::uint32_t card = 0;
+            int first = -1, last = -1;
+            while (i < ni || j < nj) {
+                boost::uint32_t s, e;
+                if (j == nj || (i < ni && runStart(c, i) <= runStart(other, j))) {
+                    s = runStart(c, i);
+                    e = runLast(c, i++);
+                }
+                else {
+                    s = runStart(other, j);
+                    e = runLast(other, j++);
+                }
+
+                if (0 <= last && static_cast<int>(s) <= last + 1) {
+                    last = std::max<int>(last, e);
+                    continue;
+                }
+                if (0 <= first) {
+                    pushRun(runs, first, last);
+                    card += last - first + 1;
+                }
+                first = s;
+                last = e;
+            }
+            pushRun(runs, first, last);
+            card += last - first + 1;
+
+            c.data.swap(runs);
+            c.card = card;
+            return;
+        }
+
+        if (K_RUN == other.kind && CHUNK_SIZE == other.card) {
+            c = other;
+            return;
+        }
+
+        makeBitset(c);
+        orInto(c.bits, other);
+        c.card = countBits(c.bits);
+    }
+
+    /// and (or and not) the container with another one, it may become empty
+    void andContainer(Container &c, const Container &other, bool negate) {
+        if (K_ARRAY == c.kind) {
+            filterArray(c, other, !negate);
+            return;
+        }
+
+        if (!negate && K_ARRAY == other.kind) {
+            Container tmp(other);
+            filterArray(tmp, c, true);
+            tmp.key = c.key;
+            c = tmp;
+            return;
+        }
+
+        if (!negate && K_RUN == c.kind && K_RUN == other.kind) {
+            // intersect runs
+            TData runs;
+            boost::uint32_t i = 0, j = 0, card = 0;
+            while (i < runCount(c) && j < runCount(other)) {
+                const boost::uint32_t s =
+                    std::max(runStart(c, i), runStart(other, j));
+                const boost::uint32_t e =
+                    std::min(runLast(c, i), runLast(other, j));
+                if (s <= e) {
+                    pushRun(runs, s, e);
+                    card += e - s + 1;
+                }
+
+                if (runLast(c, i) < runLast(other, j))
+                    ++i;
+                else
+                    ++j;
+            }
+
+            c.data.swap(runs);
+            c.card = card;
+            return;
+        }
+
+        Container mask(other);
+        makeBitset(mask);
+        makeBitset(c);
+        for (boost::uint32_t i = 0; i < WORDS; ++i)
+            c.bits[i] &= (negate) ? ~mask.bits[i] : mask.bits[i];
+
+        c.card = countBits(c.bits);
+        if (c.card && c.card <= ARRAY_MAX)
+            makeArray(c);
+    }
+
+    bool equalContainers(const Container &a, const Container &b) {
+        if (a.card != b.card)
+            return false;
+
+        if (a.kind == b.kind && K_BITSET != a.kind)
+            return a.data == b.data;
+
+        Container ba(a), bb(b);
+        makeBitset(ba);
+        makeBitset(bb);
+        return ba.bits == bb.bits;
+    }
+
+    Container runContainer(TWord key, boost::uint32_t first,
+                           boost::uint32_t last)
+    {
+        Container c;
+        c.key = key;
+        c.kind = K_RUN;
+        c.card = last - first + 1;
+        pushRun(c.data, first, last);
+        return c;
+    }
+
+    struct KeyLess {
+        bool operator()(const Container &c, TWord key) const {
+            return c.key < key;
+        }
+    };
+}
+
+RoaringBitmap::TContainers::iterator RoaringBitmap::lookup(TWord key) {
+    return std::lower_bound(containers_.begin(), containers_.end(), key,
+                            KeyLess());
+}
+
+RoaringBitmap::TContainers::const_iterator RoaringBitmap::lookup(TWord key)
+    const
+{
+    return std::lower_bound(containers_.begin(), containers_.end(), key,
+                            KeyLess());
+}
+
+void RoaringBitmap::resize(size_t size, bool value) {
+    if (size < size_) {
+        // drop bits above the new size
+        for (size_t pos = (size) ? this->find_next(size - 1)
+                                 : this->find_first();
+                pos != npos; pos = this->find_next(pos))
+            this->reset(pos);
+    }
+    else if (value && size_ < size) {
+        // add runs of the new bits
+        RoaringBitmap range;
+        range.size_ = size;
+        for (size_t first = size_; first < size;) {
+            const size_t key = first >> CHUNK_BITS;
+            const size_t last = std::min(size, (key + 1) << CHUNK_BITS) - 1;
+            range.containers_.push_back(runContainer(key, first & LOW_MASK,
+                                                     last & LOW_MASK));
+            first = last + 1;
+        }
+
+        size_ = size;
+        *this |= range;
+    }
+
+    size_ = size;
+}
+
+bool RoaringBitmap::test(size_t pos) const {
+    assert(pos < size_);
+    const TWord key = pos >> CHUNK_BITS;
+    const TContainers::const_iterator i = this->lookup(key);
+    return containers_.end() != i && key == i->key
+        && testContainer(*i, pos & LOW_MASK);
+}
+
+RoaringBitmap& RoaringBitmap::set(size_t pos) {
+    assert(pos < size_);
+    const TWord key = pos >> CHUNK_BITS;
+    const TWord low = pos & LOW_MASK;
+    TContainers::iterator i = this->lookup(key);
+    if (containers_.end() == i || key != i->key) {
+        Container c;
+        c.key = key;
+        c.kind = K_ARRAY;
+        c.card = 1;
+        c.data.push_back(low);
+        containers_.insert(i, c);
+        return *this;
+    }
+
+    Container &c = *i;
+    if (K_RUN == c.kind) {
+        if (testContainer(c, low))
+            return *this;
+
+        if (c.card < ARRAY_MAX)
+            makeArray(c);
+        else
+            makeBitset(c);
+
+        // drop the slack of arrays grown by set()
+        if (c.data.size() < c.data.capacity())
+            TData(c.data).swap(c.data);
+    }
+
+    if (K_ARRAY == c.kind) {
+        TData::iterator di = std::lower_bound(c.data.begin(), c.data.end(), low);
+        if (c.data.end() != di && low == *di)
+            return *this;
+
+        if (c.card < ARRAY_MAX) {
+            c.data.insert(di, low);
+            ++c.card;
+            return *this;
+        }
+
+        makeBitset(c);
+    }
+
+    boost::uint64_t &word = c.bits[low / 64];
+    const boost::uint64_t bit = 1ULL << (low % 64);
+    if (!(word & bit)) {
+        word |= bit;
+        ++c.card;
+    }
+
+    return *this;
+}
+
+RoaringBitmap& RoaringBitmap::reset(size_t pos) {
+    assert(pos < size_);
+    const TWord key = pos >> CHUNK_BITS;
+    const TWord low = pos & LOW_MASK;
+    TContainers::iterator i = this->lookup(key);
+    if (containers_.end() == i || key != i->key || !testContainer(*i, low))
+        return *this;
+
+    Container &c = *i;
+    if (1 == c.card) {
+        containers_.erase(i);
+        return *this;
+    }
+
+    if (K_RUN == c.kind) {
+        if (c.card <= ARRAY_MAX + 1)
+            makeArray(c);
+        else
+            makeBitset(c);
+
+        // drop the slack of arrays grown by set()
+        if (c.data.size() < c.data.capacity())
+            TData(c.data).swap(c.data);
+    }
+
+    if (K_ARRAY == c.kind)
+        c.data.erase(std::lower_bound(c.data.begin(), c.data.end(), low));
+    else
+        c.bits[low / 64] &= ~(1ULL << (low % 64));
+
+    --c.card;
+    return *this;
+}
+
+size_t RoaringBitmap::count() const {
+    size_t cnt = 0;
+    for (TContainers::const_iterator i = containers_.begin();
+            i != containers_.end(); ++i)
+        cnt += i->card;
+
+    return cnt;
+}
+
+size_t RoaringBitmap::find_first() const {
+    if (containers_.empty())
+        return npos;
+
+    const Container &c = containers_.front();
+    return (static_cast<size_t>(c.key) << CHUNK_BITS) + nextInContainer(c, 0);
+}
+
+size_t RoaringBitmap::find_next(size_t pos) const {
+    const size_t start = pos + 1;
+    if (size_ <= start)
+        return npos;
+
+    const TWord key = start >> CHUNK_BITS;
+    TContainers::const_iterator i = this->lookup(key);
+    for (; containers_.end() != i; ++i) {
+        const boost::uint32_t low = (key == i->key) ? (start & LOW_MASK) : 0;
+        const boost::uint32_t next = nextInContainer(*i, low);
+        if (next < CHUNK_SIZE)
+            return (static_cast<size_t>(i->key) << CHUNK_BITS) + next;
+    }
+
+    return npos;
+}
+
+RoaringBitmap& RoaringBitmap::operator|=(const RoaringBitmap &other) {
+    assert(size_ == other.size_);
+    TContainers::iterator i = containers_.begin();
+    TContainers::const_iterator j;
+    for (j = other.containers_.begin(); j != other.containers_.end(); ++j) {
+        i = std::lower_bound(i, containers_.end(), j->key, KeyLess());
+        if (containers_.end() != i && j->key == i->key)
+            orContainer(*i, *j);
+        else
+            i = containers_.insert(i, *j);
+    }
+
+    return *this;
+}
+
+RoaringBitmap& RoaringBitmap::operator&=(const RoaringBitmap &other) {
+    assert(size_ == other.size_);
+    TContainers result;
+    TContainers::const_iterator j = other.containers_.begin();
+    for (TContainers::iterator i = containers_.begin(); i != containers_.end();
+            ++i)
+    {
+        j = std::lower_bound(j, other.containers_.end(), i->key, KeyLess());
+        if (other.containers_.end() == j || j->key != i->key)
+            continue;
+
+        andContainer(*i, *j, false);
+        if (i->card) {
+            result.push_back(Container());
+            std::swap(result.back(), *i);
+        }
+    }
+
+    containers_.swap(result);
+    return *this;
+}
+
+RoaringBitmap& RoaringBitmap::operator-=(const RoaringBitmap &other) {
+    assert(size_ == other.size_);
+    TContainers result;
+    TContainers::const_iterator j = other.containers_.begin();
+    for (TContainers::iterator i = containers_.begin(); i != containers_.end();
+            ++i)
+    {
+        j = std::lower_bound(j, other.containers_.end(), i->key, KeyLess());
+        if (other.containers_.end() != j && j->key == i->key)
+            andContainer(*i, *j, true);
+
+        if (i->card) {
+            result.push_back(Container());
+            std::swap(result.back(), *i);
+        }
+    }
+
+    containers_.swap(result);
+    return *this;
+}
+
+void RoaringBitmap::optimize() {
+    for (TContainers::iterator i = containers_.begin(); i != containers_.end();
+            ++i)
+        optimizeContainer(*i);
+}
+
+size_t RoaringBitmap::memoryUsage() const {
+    size_t size = sizeof(*this) + containers_.capacity() * sizeof(Container);
+    for (TContainers::const_iterator i = containers_.begin();
+            i != containers_.end(); ++i)
+        size += i->data.capacity() * sizeof(TWord)
+            + i->bits.capacity() * sizeof(boost::uint64_t);
+
+    return size;
+}
+
+void RoaringBitmap::serialize(std::vector<TWord> &dst) const {
+    // count of containers, then a header and data of each container
+    const boost::uint32_t cnt = containers_.size();
+    dst.push_back(cnt & 0xFFFF);
+    dst.push_back(cnt >> 16);
+    for (TContainers::const_iterator i = containers_.begin();
+            i != containers_.end(); ++i)
+    {
+        const Container &c = *i;
+        dst.push_back(c.key);
+        dst.push_back(c.kind);
+        dst.push_back(c.card - 1);
+        dst.push_back((K_RUN == c.kind) ? runCount(c) - 1 : 0);
+        if (K_BITSET == c.kind) {
+            const size_t pos = dst.size();
+            dst.resize(pos + WORDS * 4);
+            std::memcpy(&dst[pos], &c.bits[0], WORDS * sizeof c.bits[0]);
+        }
+        else
+            dst.insert(dst.end(), c.data.begin(), c.data.end());
+    }
+}
+
+size_t RoaringBitmap::serializedSize() const {
+    size_t size = 2;
+    for (TContainers::const_iterator i = containers_.begin();
+            i != containers_.end(); ++i)
+        size += 4 + ((K_BITSET == i->kind) ? WORDS * 4 : i->data.size());
+
+    return size;
+}
+
+bool RoaringBitmap::deserialize(const TWord *first, const TWord *last) {
+    containers_.clear();
+    if (last - first < 2)
+        return false;
+
+    const boost::uint32_t cnt = first[0] | (first[1] << 16);
+    first += 2;
+    containers_.reserve(cnt);
+    bool ok = true;
+    for (boost::uint32_t n = 0; ok && n < cnt; ++n) {
+        if (last - first < 4)
+            break;
+
+        Container c;
+        c.key = first[0];
+        c.kind = static_cast<EKind>(first[1]);
+        c.card = first[2] + 1U;
+        const size_t nRuns = first[3] + 1U;
+        first += 4;
+
+        size_t len;
+        switch (c.kind) {
+            case K_ARRAY:   len = c.card;           break;
+            case K_BITSET:  len = WORDS * 4;        break;
+            case K_RUN:     len = 2 * nRuns;        break;
+            default:        len = 0;                ok = false;
+        }
+        if (!ok || static_cast<size_t>(last - first) < len)
+            break;
+
+        if (K_BITSET == c.kind) {
+            c.bits.resize(WORDS);
+            std::memcpy(&c.bits[0], first, WORDS * sizeof c.bits[0]);
+            ok = countBits(c.bits) == c.card;
+        }
+        else {
+            c.data.assign(first, first + len);
+            if (K_ARRAY == c.kind) {
+                ok = c.card <= ARRAY_MAX;
+                for (size_t i = 1; ok && i < len; ++i)
+                    ok = c.data[i - 1] < c.data[i];
+            }
+            else {
+                boost::uint32_t card = 0;
+                for (size_t i = 0; ok && i < nRuns; ++i) {
+                    ok = runStart(c, i) + c.data[2 * i + 1] < CHUNK_SIZE
+                        && (!i || runLast(c, i - 1) + 1 < runStart(c, i));
+                    card += c.data[2 * i + 1] + 1;
+                }
+                ok = ok && card == c.card;
+            }
+        }
+        first += len;
+
+        ok = ok && (containers_.empty() || containers_.back().key < c.key)
+            && (static_cast<size_t>(c.key) << CHUNK_BITS) + lastInContainer(c)
+                < size_;
+        if (ok)
+            containers_.push_back(c);
+    }
+
+    if (ok && cnt == containers_.size() && first == last)
+        return true;
+
+    containers_.clear();
+    return false;
+}
+
+void RoaringBitmap::fillWords(std::vector<boost::uint64_t> &words) const {
+    words.assign((size_ + 63) / 64, 0);
+    for (TContainers::const_iterator i = containers_.begin();
+            i != containers_.end(); ++i)
+    {
+        const Container &c = *i;
+        const size_t base = static_cast<size_t>(c.key) * WORDS;
+        if (K_BITSET == c.kind) {
+            const size_t n = std::min<size_t>(WORDS, words.size() - base);
+            std::copy(c.bits.begin(), c.bits.begin() + n, words.begin() + base);
+            continue;
+        }
+
+        if (K_ARRAY == c.kind) {
+            for (TData::const_iterator j = c.data.begin(); j != c.data.end(); ++j)
+                words[base + *j / 64] |= 1ULL << (*j % 64);
+            continue;
+        }
+
+        for (boost::uint32_t j = 0; j < runCount(c); ++j)
+            setRange(&words[base], runStart(c, j), runLast(c, j));
+    }
+}
+
+bool operator==(const RoaringBitmap &a, const RoaringBitmap &b) {
+    if (a.size_ != b.size_ || a.containers_.size() != b.containers_.size())
+        return false;
+
+    for (size_t i = 0; i < a.containers_.size(); ++i) {
+        const Container &ca = a.containers_[i];
+        const Container &cb = b.containers_[i];
+        if (ca.key != cb.key || !equalContainers(ca, cb))
+            return false;
+    }
+
+    return true;
+}
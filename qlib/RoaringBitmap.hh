@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ROARING_BITMAP_H
+#define ROARING_BITMAP_H
+
+#include "config.hh"
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+namespace RoaringImpl {
+    typedef boost::uint16_t                             TWord;
+
+    enum EKind {
+        K_ARRAY,        ///< sorted positions
+        K_BITSET,       ///< 64K bits
+        K_RUN           ///< (start, length - 1) pairs of runs
+    };
+
+    /// bits of one chunk of 64K bits, it is never empty
+    struct Container {
+        TWord                           key;    ///< upper 16 bits of positions
+        EKind                           kind;
+        boost::uint32_t                 card;   ///< count of bits set
+        std::vector<TWord>              data;   ///< positions or runs
+        std::vector<boost::uint64_t>    bits;   ///< bitset (1024 words)
+    };
+}
+
+/**
+ * Compressed bitmap in the manner of Roaring bitmaps. Bit positions are split
+ * to chunks of 64K bits, and each chunk which has any bit set is kept in a
+ * container of one of three kinds, whichever is the smallest:
+ *  - array of sorted 16-bit positions (up to 4096 bits set),
+ *  - plain bitset of 64K bits,
+ *  - list of runs of set bits (start and length).
+ * So sparse bitmaps cost about two bytes per bit set, and bitmaps which are
+ * nearly full cost a few bytes per run, while dense random bitmaps are as big
+ * as plain ones.
+ *
+ * The interface follows boost::dynamic_bitset (size(), resize(), test(),
+ * set(), count(), operator|=, ...), so that it can be used as bitmap index of
+ * BitmapIndexer. Bits are only read through operator[], they are set by set().
+ * Containers get their kind when they are combined, optimize() picks the
+ * smallest kind (including runs) for all of them.
+ */
+class RoaringBitmap {
+    public:
+        typedef RoaringImpl::TWord                      TWord;
+
+        /// returned by find_first() and find_next() if there is no bit set
+        static const size_t npos = static_cast<size_t>(-1);
+
+    public:
+        RoaringBitmap():
+            size_(0)
+        {
+        }
+
+        /**
+         * @param size Count of bits, all of them are cleared.
+         */
+        explicit RoaringBitmap(size_t size):
+            size_(size)
+        {
+        }
+
+        /**
+         * @return Return count of bits (set or not) of the bitmap.
+         */
+        size_t size() const {
+            return size_;
+        }
+
+        /**
+         * Change count of bits of the bitmap, bits which are added get the
+         * given value.
+         */
+        void resize(size_t size, bool value = false);
+
+        /**
+         * Clear all bits and set size of the bitmap to zero.
+         */
+        void clear() {
+            containers_.clear();
+            size_ = 0;
+        }
+
+        bool test(size_t pos) const;
+
+        bool operator[](size_t pos) const {
+            return this->test(pos);
+        }
+
+        RoaringBitmap& set(size_t pos);
+        RoaringBitmap& reset(size_t pos);
+
+        /**
+         * @return Return count of bits set.
+         */
+        size_t count() const;
+
+        bool any() const {
+            return !containers_.empty();
+        }
+
+        bool none() const {
+            return containers_.empty();
+        }
+
+        /**
+         * @return Return position of the lowest bit set, or npos.
+         */
+        size_t find_first() const;
+
+        /**
+         * @return Return position of the lowest bit set above pos, or npos.
+         */
+        size_t find_next(size_t pos) const;
+
+        RoaringBitmap& operator|=(const RoaringBitmap &other);
+        RoaringBitmap& operator&=(const RoaringBitmap &other);
+        RoaringBitmap& operator-=(const RoaringBitmap &other);
+
+        /**
+         * Convert each container to the smallest kind, it does not change the
+         * bits.
+         */
+        void optimize();
+
+        /**
+         * @return Return count of bytes occupied by the bitmap.
+         */
+        size_t memoryUsage() const;
+
+        /**
+         * Append the bits (not the size) to the given array of words.
+         */
+        void serialize(std::vector<TWord> &dst) const;
+
+        /**
+         * @return Return count of words appended by serialize().
+         */
+        size_t serializedSize() const;
+
+        /**
+         * Read bits written by serialize(), the size is kept.
+         * @return Return false if the words are not a serialized bitmap.
+         */
+        bool deserialize(const TWord *first, const TWord *last);
+
+        /**
+         * Copy the bits to a boost::dynamic_bitset like bitset, which is
+         * resized to the size of the bitmap.
+         */
+        template <typename TBitset>
+        void copyTo(TBitset &dst) const;
+
+        friend bool operator==(const RoaringBitmap &, const RoaringBitmap &);
+
+    private:
+        typedef RoaringImpl::Container                  TContainer;
+        typedef std::vector<TContainer>                 TContainers;
+
+        size_t              size_;
+        TContainers         containers_;    ///< sorted by key
+
+    private:
+        TContainers::iterator lookup(TWord key);
+        TContainers::const_iterator lookup(TWord key) const;
+        void fillWords(std::vector<boost::uint64_t> &words) const;
+};
+
+inline bool operator!=(const RoaringBitmap &a, const RoaringBitmap &b) {
+    return !operator==(a, b);
+}
+
+template <typename TBitset>
+void RoaringBitmap::copyTo(TBitset &dst) const {
+    typedef typename TBitset::block_type                TBlock;
+    const size_t bitsPerBlock = TBitset::bits_per_block;
+    const size_t blocksPerWord = 64 / bitsPerBlock;
+
+    std::vector<boost::uint64_t> words;
+    this->fillWords(words);
+
+    std::vector<TBlock> blocks((size_ + bitsPerBlock - 1) / bitsPerBlock, 0);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const size_t shift = (i % blocksPerWord) * bitsPerBlock;
+        blocks[i] = static_cast<TBlock>(words[i / blocksPerWord] >> shift);
+    }
+
+    dst = TBitset(blocks.begin(), blocks.end());
+    dst.resize(size_);
+}
+
+#endif // ROARING_BITMAP_H
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "ScopeTree.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstring>
+
+namespace {
+    const char ANONYMOUS[] = "(anonymous namespace)";
+    const char OPERATOR[] = "operator";
+
+    bool isIdChar(char c) {
+        return isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    bool startsWith(const std::string &str, size_t pos, const char *what) {
+        return !str.compare(pos, strlen(what), what);
+    }
+
+    /// order children of a node by their names
+    class NameLess {
+        public:
+            NameLess(const StringTable &names,
+                     const std::vector<StringTable::TId> &nameId):
+                names_(&names),
+                nameId_(&nameId)
+            {
+            }
+
+            bool operator()(boost::uint32_t a, boost::uint32_t b) const {
+                return strcmp((*names_)[(*nameId_)[a]],
+                              (*names_)[(*nameId_)[b]]) < 0;
+            }
+
+        private:
+            const StringTable                       *names_;
+            const std::vector<StringTable::TId>     *nameId_;
+    };
+}
+
+const ScopeTree::TNode ScopeTree::ROOT;
+const ScopeTree::TNode ScopeTree::NOT_FOUND;
+
+ScopeTree::ScopeTree() {
+    TNameList none;
+    this->build(none);
+}
+
+void ScopeTree::split(const std::string &name, TNameList &dst) {
+    dst.clear();
+
+    const size_t len = name.size();
+    size_t start = 0;           // start of the current component
+    int depth = 0;              // nesting of brackets within the component
+    size_t i = 0;
+    while (i < len) {
+        const char c = name[i];
+        if (depth) {
+            if (c == '<' || c == '(' || c == '[' || c == '{')
+                ++depth;
+            else if (c == '>' || c == ')' || c == ']' || c == '}')
+                --depth;
+            ++i;
+            continue;
+        }
+
+        if (i == start && startsWith(name, i, OPERATOR)
+                && (i + sizeof OPERATOR - 1 == len
+                    || !isIdChar(name[i + sizeof OPERATOR - 1])))
+        {
+            // operator name ends where its parameters begin
+            i += sizeof OPERATOR - 1;
+            if (startsWith(name, i, "()"))
+                i += 2;
+            while (i < len && name[i] != '(')
+                ++i;
+            break;
+        }
+
+        if (c == '(') {
+            if (i == start && startsWith(name, i, ANONYMOUS)) {
+                i += sizeof ANONYMOUS - 1;
+                continue;
+            }
+
+            // parameters, the qualified name ends here
+            break;
+        }
+
+        if (c == '<' || c == '[' || c == '{')
+            ++depth;
+
+        else if (c == ' ') {
+            // return type of a template function, the name comes after it
+            dst.clear();
+            start = i + 1;
+        }
+
+        else if (c == ':' && i + 1 < len && name[i + 1] == ':') {
+            dst.push_back(name.substr(start, i - start));
+            i += 2;
+            start = i;
+            continue;
+        }
+
+        ++i;
+    }
+
+    dst.push_back(name.substr(start, i - start));
+}
+
+void ScopeTree::build(const TNameList &vertexNames) {
+    const size_t nVert = vertexNames.size();
+
+    // number nodes in order of first appearance first, keyed by their paths
+    StringTable tmpPaths;
+    names_ = StringTable();
+    tmpPaths.intern(std::string());
+    TNodeColumn tmpParent(1, NOT_FOUND);
+    TStrColumn tmpNameId(1, names_.intern(std::string()));
+    TNodeColumn tmpNodeOf(nVert);
+
+    TNameList comps;
+    std::string path;
+    for (size_t v = 0; v < nVert; ++v) {
+        split(vertexNames[v], comps);
+        TNode node = ROOT;
+        path.clear();
+        for (TNameList::const_iterator i = comps.begin(); i != comps.end();
+                ++i)
+        {
+            if (i != comps.begin())
+                path += "::";
+            path += *i;
+
+            const TNode child = tmpPaths.intern(path);
+            if (tmpParent.size() == child) {
+                tmpParent.push_back(node);
+                tmpNameId.push_back(names_.intern(*i));
+            }
+            node = child;
+        }
+        tmpNodeOf[v] = node;
+    }
+
+    // children of each node, ordered by name
+    const size_t nNodes = tmpParent.size();
+    TOffsets childStart(nNodes + 1, 0);
+    for (TNode n = 1; n < nNodes; ++n)
+        ++childStart[tmpParent[n] + 1];
+    for (TNode n = 0; n < nNodes; ++n)
+        childStart[n + 1] += childStart[n];
+
+    TNodeColumn children(nNodes - 1);
+    TOffsets fill(childStart.begin(), childStart.end() - 1);
+    for (TNode n = 1; n < nNodes; ++n)
+        children[fill[tmpParent[n]]++] = n;
+
+    const NameLess less(names_, tmpNameId);
+    for (TNode n = 0; n < nNodes; ++n)
+        std::sort(children.begin() + childStart[n],
+                  children.begin() + childStart[n + 1], less);
+
+    // number nodes in preorder
+    TNodeColumn preorder;
+    preorder.reserve(nNodes);
+    TNodeColumn stack(1, ROOT);
+    while (!stack.empty()) {
+        const TNode n = stack.back();
+        stack.pop_back();
+        preorder.push_back(n);
+        for (size_t i = childStart[n + 1]; childStart[n] < i; --i)
+            stack.push_back(children[i - 1]);
+    }
+    assert(preorder.size() == nNodes);
+
+    TNodeColumn newId(nNodes);
+    for (TNode i = 0; i < nNodes; ++i)
+        newId[preorder[i]] = i;
+
+    // subtree sizes, children come after their parents in preorder
+    TNodeColumn subtree(nNodes, 1);
+    for (TNode i = nNodes - 1; ROOT < i; --i)
+        subtree[newId[tmpParent[preorder[i]]]] += subtree[i];
+
+    paths_ = StringTable();
+    nameId_.resize(nNodes);
+    parent_.resize(nNodes);
+    end_.resize(nNodes);
+    for (TNode i = 0; i < nNodes; ++i) {
+        const TNode tmp = preorder[i];
+        const TNode id = paths_.intern(tmpPaths[tmp], tmpPaths.length(tmp));
+        assert(id == i);
+        (void) id;
+
+        nameId_[i] = tmpNameId[tmp];
+        parent_[i] = (ROOT == tmp) ? NOT_FOUND : newId[tmpParent[tmp]];
+        end_[i] = i + subtree[i];
+    }
+
+    // vertices sorted by node, stable for vertices of one node
+    nodeOf_.resize(nVert);
+    vertexStart_.assign(nNodes + 1, 0);
+    for (size_t v = 0; v < nVert; ++v) {
+        nodeOf_[v] = newId[tmpNodeOf[v]];
+        ++vertexStart_[nodeOf_[v] + 1];
+    }
+    for (TNode n = 0; n < nNodes; ++n)
+        vertexStart_[n + 1] += vertexStart_[n];
+
+    vertices_.resize(nVert);
+    fill.assign(vertexStart_.begin(), vertexStart_.end() - 1);
+    for (size_t v = 0; v < nVert; ++v)
+        vertices_[fill[nodeOf_[v]]++] = v;
+
+    // nodes sorted by own name
+    const size_t nNames = names_.size();
+    namedStart_.assign(nNames + 1, 0);
+    for (TNode n = 0; n < nNodes; ++n)
+        ++namedStart_[nameId_[n] + 1];
+    for (TStrId id = 0; id < nNames; ++id)
+        namedStart_[id + 1] += namedStart_[id];
+
+    named_.resize(nNodes);
+    fill.assign(namedStart_.begin(), namedStart_.end() - 1);
+    for (TNode n = 0; n < nNodes; ++n)
+        named_[fill[nameId_[n]]++] = n;
+}
+
+ScopeTree::TNode ScopeTree::find(const std::string &path) const {
+    const TNode node = paths_.find(path);
+    if (NOT_FOUND != node)
+        return node;
+
+    // the path may come with parameters or a return type, normalize it
+    TNameList comps;
+    split(path, comps);
+    std::string normalized;
+    for (TNameList::const_iterator i = comps.begin(); i != comps.end(); ++i) {
+        if (i != comps.begin())
+            normalized += "::";
+        normalized += *i;
+    }
+
+    return paths_.find(normalized);
+}
+
+void ScopeTree::findNamed(const std::string &name, TNodeList &dst) const {
+    const TStrId id = names_.find(name);
+    if (StringTable::NOT_FOUND == id)
+        return;
+
+    dst.insert(dst.end(), named_.begin() + namedStart_[id],
+               named_.begin() + namedStart_[id + 1]);
+}
+
+size_t ScopeTree::memoryUsage() const {
+    return sizeof(*this)
+        + paths_.memoryUsage() - sizeof(paths_)
+        + names_.memoryUsage() - sizeof(names_)
+        + (nameId_.capacity() + parent_.capacity() + end_.capacity()
+                + vertexStart_.capacity() + vertices_.capacity()
+                + nodeOf_.capacity() + namedStart_.capacity()
+                + named_.capacity()) * sizeof(boost::uint32_t);
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCOPE_TREE_H
+#define SCOPE_TREE_H
+
+#include "config.hh"
+#include "CallGraph.hh"
+#include "StringTable.hh"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+/**
+ * Hierarchy of scopes (namespaces, classes) and functions parsed out of
+ * demangled C++ names. Each function name (all its overloads) is a leaf of
+ * the scope it is declared in, e.g. "ns::C::run(int)" gives the nodes "ns",
+ * "ns::C" and "ns::C::run". Plain C names are leaves of the root.
+ *
+ * Nodes are numbered in preorder and vertices are sorted by their nodes, so
+ * that all vertices within a scope (recursively) form a continuous range.
+ * Scope queries are thus one hash lookup plus a walk over the result.
+ */
+class ScopeTree {
+    public:
+        typedef boost::uint32_t                         TNode;
+        typedef boost::uint32_t                         TVertex;
+        typedef std::vector<TNode>                      TNodeList;
+        typedef std::vector<std::string>                TNameList;
+        typedef const TVertex                           *TVertexIterator;
+        typedef std::pair<TVertexIterator, TVertexIterator> TVertexRange;
+
+        /// the global scope, its path is the empty string
+        static const TNode ROOT = 0;
+
+        /// returned by find() if there is no such scope
+        static const TNode NOT_FOUND = static_cast<TNode>(-1);
+
+    public:
+        ScopeTree();
+
+        /**
+         * (Re)build the tree from the (demangled) name of each vertex, the
+         * vertex number is the position in the list.
+         */
+        void build(const TNameList &names);
+
+        /**
+         * Split a demangled name into names of nested scopes, the last one
+         * being the function name without parameters. Template arguments,
+         * operator names and "(anonymous namespace)" are kept in one piece,
+         * return types of template functions are dropped. Entities local to
+         * a function are attributed to the function.
+         */
+        static void split(const std::string &name, TNameList &dst);
+
+        /**
+         * @return Return count of nodes, including the root.
+         */
+        size_t size() const {
+            return parent_.size();
+        }
+
+        /**
+         * @return Return node of the given qualified name (e.g. "ns::C"), or
+         * NOT_FOUND. The empty string stands for the root.
+         */
+        TNode find(const std::string &path) const;
+
+        /**
+         * Append all nodes whose own (last) name is the given one, e.g. all
+         * classes named C in whatever namespace.
+         */
+        void findNamed(const std::string &name, TNodeList &dst) const;
+
+        /**
+         * @return Return qualified name of the given node.
+         */
+        std::string path(TNode node) const {
+            return std::string(paths_[node], paths_.length(node));
+        }
+
+        /**
+         * @return Return own (last) name of the given node.
+         */
+        std::string name(TNode node) const {
+            const TStrId id = nameId_[node];
+            return std::string(names_[id], names_.length(id));
+        }
+
+        /**
+         * @return Return parent of the given node, ROOT has no parent.
+         */
+        TNode parent(TNode node) const {
+            return parent_[node];
+        }
+
+        /**
+         * @return Return the first child of the given node, or NOT_FOUND. The
+         * children are ordered by their names.
+         */
+        TNode firstChild(TNode node) const {
+            return (node + 1 < end_[node])
+                ? node + 1
+                : NOT_FOUND;
+        }
+
+        /**
+         * @return Return the next child of the same parent, or NOT_FOUND.
+         */
+        TNode nextSibling(TNode node) const {
+            const TNode next = end_[node];
+            return (ROOT != node && next < end_[parent_[node]])
+                ? next
+                : NOT_FOUND;
+        }
+
+        /**
+         * @return Return all vertices within the given scope (recursively),
+         * in order of nodes and vertex numbers within one node.
+         */
+        TVertexRange vertices(TNode node) const {
+            return this->range(vertexStart_[node], vertexStart_[end_[node]]);
+        }
+
+        /**
+         * @return Return vertices of the given node itself (overloads of one
+         * function), not those of nested scopes.
+         */
+        TVertexRange ownVertices(TNode node) const {
+            return this->range(vertexStart_[node], vertexStart_[node + 1]);
+        }
+
+        /**
+         * @return Return node of the given vertex.
+         */
+        TNode nodeOf(TVertex v) const {
+            return nodeOf_[v];
+        }
+
+        /**
+         * @return Return count of bytes occupied by the tree.
+         */
+        size_t memoryUsage() const;
+
+    private:
+        typedef StringTable::TId                        TStrId;
+        typedef std::vector<TNode>                      TNodeColumn;
+        typedef std::vector<TStrId>                     TStrColumn;
+        typedef std::vector<TVertex>                    TVertexList;
+        typedef std::vector<boost::uint32_t>            TOffsets;
+
+        StringTable         paths_;         ///< qualified name of each node
+        StringTable         names_;         ///< own names of nodes
+        TStrColumn          nameId_;        ///< own name of each node
+        TNodeColumn         parent_;        ///< parent of each node
+        TNodeColumn         end_;           ///< end of subtree of each node
+        TOffsets            vertexStart_;   ///< first vertex of each node
+        TVertexList         vertices_;      ///< vertices sorted by node
+        TNodeColumn         nodeOf_;        ///< node of each vertex
+        TOffsets            namedStart_;    ///< first node of each own name
+        TNodeList           named_;         ///< nodes sorted by own name
+
+    private:
+        TVertexRange range(size_t first, size_t last) const {
+            const TVertexIterator base = vertices_.empty() ? 0 : &vertices_[0];
+            return TVertexRange(base + first, base + last);
+        }
+};
+
+/**
+ * Build scope tree of the given call graph from demangled names of functions,
+ * which are all demangled ahead by FncTable::demangleAll(). The graph has to
+ * have continuous vertex numbers (CsrCallGraph or CompressedCallGraph).
+ */
+template <typename TGraph>
+void buildScopeTree(ScopeTree &tree, const TGraph &graph) {
+    using namespace boost;
+
+    typedef graph_traits<TGraph>                        Traits;
+    typedef property_map<TGraph, FncProp>               TPropMapping;
+    typedef typename TPropMapping::const_type           TProp;
+    TProp prop = get(FncProp(), graph);
+
+    ScopeTree::TNameList names(num_vertices(graph));
+    typename Traits::vertex_iterator vi, vi_end;
+    tie(vi, vi_end) = vertices(graph);
+    if (vi != vi_end)
+        get(prop, *vi)->table().demangleAll();
+
+    for (; vi != vi_end; ++vi)
+        names[*vi] = get(prop, *vi)->prettyName();
+
+    tree.build(names);
+}
+
+#endif // SCOPE_TREE_H
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "StringTable.hh"
+#include "Image.hh"
+
+#include <cstring>
+
+namespace {
+    // FNV-1a
+    size_t hashString(const char *str, size_t len) {
+        boost::uint32_t hash = 2166136261U;
+        for (size_t i = 0; i < len; ++i) {
+            hash ^= static_cast<unsigned char>(str[i]);
+            hash *= 16777619U;
+        }
+        return hash;
+    }
+}
+
+const StringTable::TId StringTable::NOT_FOUND;
+
+StringTable::StringTable():
+    offsets_(1, 0),
+    slots_(16, NOT_FOUND)
+{
+}
+
+size_t StringTable::lookup(const char *str, size_t len, size_t hash) const {
+    // linear probing, the table is never more than half full
+    const size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        TId id = slots_[i];
+        if (NOT_FOUND == id)
+            return i;
+
+        if (length(id) == len && 0 == std::memcmp((*this)[id], str, len))
+            return i;
+    }
+}
+
+void StringTable::rehash(size_t nSlots) {
+    slots_.assign(nSlots, NOT_FOUND);
+    for (TId id = 0; id < size(); ++id) {
+        const char *str = (*this)[id];
+        const size_t len = length(id);
+        slots_[lookup(str, len, hashString(str, len))] = id;
+    }
+}
+
+StringTable::TId StringTable::find(const char *str, size_t len) const {
+    return slots_[lookup(str, len, hashString(str, len))];
+}
+
+StringTable::TId StringTable::intern(const char *str, size_t len) {
+    const size_t hash = hashString(str, len);
+    size_t slot = lookup(str, len, hash);
+    if (NOT_FOUND != slots_[slot])
+        return slots_[slot];
+
+    TId id = size();
+    data_.insert(data_.end(), str, str + len);
+    data_.push_back('\0');
+    offsets_.push_back(data_.size());
+
+    if (slots_.size() < 2 * offsets_.size())
+        rehash(2 * slots_.size());
+    else
+        slots_[slot] = id;
+
+    return id;
+}
+
+size_t StringTable::memoryUsage() const {
+    return sizeof(*this)
+        + data_.capacity() * sizeof(TData::value_type)
+        + offsets_.capacity() * sizeof(TOffsets::value_type)
+        + slots_.capacity() * sizeof(TSlots::value_type);
+}
+
+void StringTable::save(ImageWriter &img) const {
+    img.putVector(data_);
+    img.putVector(offsets_);
+    img.putVector(slots_);
+}
+
+bool StringTable::load(ImageReader &img) {
+    if (!img.getVector(data_) || !img.getVector(offsets_)
+            || !img.getVector(slots_) || !this->isConsistent())
+    {
+        *this = StringTable();
+        return false;
+    }
+
+    return true;
+}
+
+bool StringTable::isConsistent() const {
+    if (offsets_.empty() || offsets_.front() || offsets_.back() != data_.size()
+            || slots_.size() < 2 * offsets_.size()
+            || (slots_.size() & (slots_.size() - 1)))
+        return false;
+
+    // each string is zero-terminated, so offsets grow
+    for (size_t id = 0; id + 1 < offsets_.size(); ++id)
+        if (offsets_[id + 1] <= offsets_[id] || data_[offsets_[id + 1] - 1])
+            return false;
+
+    // probes of lookup() stop at a free slot
+    const size_t nStrings = this->size();
+    bool hasFree = false;
+    for (TSlots::const_iterator i = slots_.begin(); i != slots_.end(); ++i) {
+        if (NOT_FOUND == *i)
+            hasFree = true;
+        else if (nStrings <= *i)
+            return false;
+    }
+
+    return hasFree;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STRING_TABLE_H
+#define STRING_TABLE_H
+
+#include "config.hh"
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+class ImageReader;
+class ImageWriter;
+
+/**
+ * Table of interned strings. Each distinct string is stored only once and
+ * referred to by a small integer id. Ids are assigned in order of first
+ * appearance, starting with zero.
+ *
+ * All strings are kept in one contiguous buffer, separated by zero bytes, so
+ * there is no per-string heap allocation. Strings are hashed into an
+ * open-addressed table of ids, which makes the whole table trivially copyable.
+ * Pointers returned by operator[] are valid until the next intern() call.
+ */
+class StringTable {
+    public:
+        typedef boost::uint32_t                         TId;
+
+        /// returned by find() if there is no such string
+        static const TId NOT_FOUND = static_cast<TId>(-1);
+
+    public:
+        StringTable();
+
+        /**
+         * @return Return id of the given string, the string is added to the
+         * table if not already there.
+         */
+        TId intern(const char *str, size_t len);
+
+        TId intern(const std::string &str) {
+            return intern(str.data(), str.size());
+        }
+
+        /**
+         * @return Return id of the given string or NOT_FOUND. The table is not
+         * modified.
+         */
+        TId find(const char *str, size_t len) const;
+
+        TId find(const std::string &str) const {
+            return find(str.data(), str.size());
+        }
+
+        /**
+         * @return Return zero-terminated string of the given id.
+         */
+        const char* operator[] (TId id) const {
+            return &data_[offsets_[id]];
+        }
+
+        /**
+         * @return Return length of the string of the given id.
+         */
+        size_t length(TId id) const {
+            return offsets_[id + 1] - offsets_[id] - 1;
+        }
+
+        /**
+         * @return Return count of strings in the table.
+         */
+        size_t size() const {
+            return offsets_.size() - 1;
+        }
+
+        /**
+         * @return Return count of bytes occupied by the table.
+         */
+        size_t memoryUsage() const;
+
+        /**
+         * Write the table to a session image, see Image.hh.
+         */
+        void save(ImageWriter &) const;
+
+        /**
+         * Read the table previously written by save(). Offsets and the hash
+         * table are checked, so that a damaged image can't make lookups read
+         * out of the table or probe forever.
+         * @return Return false if the image does not contain a valid table.
+         */
+        bool load(ImageReader &);
+
+    private:
+        typedef std::vector<char>                       TData;
+        typedef std::vector<boost::uint32_t>            TOffsets;
+        typedef std::vector<TId>                        TSlots;
+
+        TData           data_;      ///< zero-terminated strings
+        TOffsets        offsets_;   ///< offset of each string, plus the end
+        TSlots          slots_;     ///< hash table, NOT_FOUND is empty slot
+
+    private:
+        size_t lookup(const char *str, size_t len, size_t hash) const;
+        void rehash(size_t nSlots);
+        bool isConsistent() const;
+};
+
+#endif // STRING_TABLE_H
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "SymbolIndex.hh"
+
+#include <cstring>
+
+void SymbolIndex::build(const StringTable &names, TEntryList &entries) {
+    const size_t nKeys = names.size();
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+    // hash the names as they are in the table
+    std::vector<char> data;
+    std::vector<boost::uint32_t> offsets(1, 0);
+    offsets.reserve(nKeys + 1);
+    for (StringTable::TId id = 0; id < nKeys; ++id) {
+        data.insert(data.end(), names[id], names[id] + names.length(id) + 1);
+        offsets.push_back(data.size());
+    }
+    hash_.build((data.empty()) ? 0 : &data[0], &offsets[0], nKeys);
+
+    // lay out names and vertex lists by their hash positions
+    std::vector<StringTable::TId> idAt(nKeys);
+    for (StringTable::TId id = 0; id < nKeys; ++id)
+        idAt[hash_(names[id], names.length(id))] = id;
+
+    std::vector<boost::uint32_t> entryStart(nKeys + 1, 0);
+    for (TEntryList::const_iterator i = entries.begin(); i != entries.end(); ++i)
+        ++entryStart[i->first + 1];
+    for (size_t id = 0; id < nKeys; ++id)
+        entryStart[id + 1] += entryStart[id];
+
+    std::vector<char> keyData;
+    keyData.reserve(data.size());
+    std::vector<boost::uint32_t> keyOffsets(1, 0);
+    keyOffsets.reserve(nKeys + 1);
+    std::vector<boost::uint32_t> vertexStart(1, 0);
+    vertexStart.reserve(nKeys + 1);
+    std::vector<TVertex> vertices;
+    vertices.reserve(entries.size());
+    for (size_t pos = 0; pos < nKeys; ++pos) {
+        const StringTable::TId id = idAt[pos];
+        keyData.insert(keyData.end(), &data[offsets[id]],
+                       &data[0] + offsets[id + 1]);
+        keyOffsets.push_back(keyData.size());
+
+        for (size_t i = entryStart[id]; i < entryStart[id + 1]; ++i)
+            vertices.push_back(entries[i].second);
+        vertexStart.push_back(vertices.size());
+    }
+
+    keyData_.assign(keyData);
+    keyOffsets_.assign(keyOffsets);
+    vertexStart_.assign(vertexStart);
+    vertices_.assign(vertices);
+}
+
+SymbolIndex::TVertexRange SymbolIndex::find(const char *name, size_t len)
+    const
+{
+    const TVertex *none = 0;
+    if (!hash_.size())
+        return TVertexRange(none, none);
+
+    const size_t pos = hash_(name, len);
+    const boost::uint32_t begin = keyOffsets_[pos];
+    if (keyOffsets_[pos + 1] - begin - 1 != len
+            || std::memcmp(keyData_.data() + begin, name, len))
+        return TVertexRange(none, none);
+
+    const TVertex *first = vertices_.data();
+    return TVertexRange(first + vertexStart_[pos],
+                        first + vertexStart_[pos + 1]);
+}
+
+size_t SymbolIndex::memoryUsage() const {
+    return sizeof(*this)
+        + hash_.memoryUsage() - sizeof hash_
+        + keyData_.memoryUsage()
+        + keyOffsets_.memoryUsage()
+        + vertexStart_.memoryUsage()
+        + vertices_.memoryUsage();
+}
+
+void SymbolIndex::save(ImageWriter &img) const {
+    hash_.save(img);
+    keyData_.save(img);
+    keyOffsets_.save(img);
+    vertexStart_.save(img);
+    vertices_.save(img);
+}
+
+bool SymbolIndex::load(ImageReader &img, size_t nVertices) {
+    const bool ok = hash_.load(img)
+        && keyData_.load(img)
+        && keyOffsets_.load(img)
+        && vertexStart_.load(img)
+        && vertices_.load(img)
+        && this->isConsistent(nVertices);
+    if (!ok)
+        *this = SymbolIndex();
+
+    return ok;
+}
+
+bool SymbolIndex::isConsistent(size_t nVertices) const {
+    const size_t n = hash_.size();
+    if (keyOffsets_.size() != n + 1 || vertexStart_.size() != n + 1
+            || keyOffsets_[0] || keyOffsets_[n] != keyData_.size()
+            || vertexStart_[0] || vertexStart_[n] != vertices_.size())
+        return false;
+
+    // each key is zero-terminated, so key offsets grow
+    for (size_t pos = 0; pos < n; ++pos)
+        if (keyOffsets_[pos + 1] <= keyOffsets_[pos]
+                || vertexStart_[pos + 1] < vertexStart_[pos])
+            return false;
+
+    for (size_t i = 0; i < vertices_.size(); ++i)
+        if (nVertices <= vertices_[i])
+            return false;
+
+    return true;
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYMBOL_INDEX_H
+#define SYMBOL_INDEX_H
+
+#include "config.hh"
+#include "CallGraph.hh"
+#include "Image.hh"
+#include "PerfectHash.hh"
+#include "StringTable.hh"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/graph/graph_traits.hpp>
+
+/**
+ * Read-only map of symbol names to vertices, made to be stored in a session
+ * image (see Image.hh) and used in place once the image is mapped. Names are
+ * found by a minimal perfect hash, names and vertex lists are stored in the
+ * order of hash positions, so a lookup touches one seed, one name and one
+ * vertex list. Unlike SymbolMap, it has to be built up front, including
+ * demangled names.
+ */
+class SymbolIndex {
+    public:
+        typedef boost::uint32_t                             TVertex;
+        typedef std::pair<const TVertex *, const TVertex *> TVertexRange;
+
+        /// (name id, vertex) pair given to build()
+        typedef std::pair<StringTable::TId, TVertex>        TEntry;
+        typedef std::vector<TEntry>                         TEntryList;
+
+    public:
+        /**
+         * Build the index of the given names, each entry adds a vertex to the
+         * list of a name. Duplicate entries are allowed, the list is left
+         * sorted. Entries are sorted in place.
+         */
+        void build(const StringTable &names, TEntryList &entries);
+
+        /**
+         * @return Return vertices of the given name, the range is empty if
+         * there is no such name.
+         */
+        TVertexRange find(const char *name, size_t len) const;
+
+        TVertexRange find(const std::string &name) const {
+            return this->find(name.data(), name.size());
+        }
+
+        /**
+         * @return Return count of names.
+         */
+        size_t size() const {
+            return hash_.size();
+        }
+
+        /**
+         * @return Return count of bytes occupied by the index (without the
+         * image it may be using in place).
+         */
+        size_t memoryUsage() const;
+
+        /**
+         * Write the index to a session image.
+         */
+        void save(ImageWriter &) const;
+
+        /**
+         * Read the index previously written by save(). Arrays are used in
+         * place, so the image has to stay mapped as long as the index is used.
+         * Offsets and vertices are checked, so that a damaged image can't
+         * make lookups read out of the arrays.
+         * @param nVertices Count of vertices of the graph the index is for.
+         * @return Return false if the image does not contain a valid index.
+         */
+        bool load(ImageReader &, size_t nVertices);
+
+    private:
+        PerfectHash                         hash_;
+        ImageArray<char>                    keyData_;
+        ImageArray<boost::uint32_t>         keyOffsets_;    ///< N + 1 offsets
+        ImageArray<boost::uint32_t>         vertexStart_;   ///< N + 1 starts
+        ImageArray<TVertex>                 vertices_;
+
+    private:
+        bool isConsistent(size_t nVertices) const;
+};
+
+/**
+ * Build the symbol index of the given graph. Each function is found by its
+ * name as read and, if it is a mangled C++ name, also by the demangled one.
+ */
+template <typename TGraph>
+void buildSymbolIndex(SymbolIndex &index, const TGraph &graph) {
+    using namespace boost;
+    typedef graph_traits<TGraph>                        Traits;
+    typedef typename property_map<TGraph, FncProp>::const_type TProp;
+
+    TProp prop = get(FncProp(), graph);
+    typename Traits::vertex_iterator vi, vi_end;
+    tie(vi, vi_end) = vertices(graph);
+    if (vi != vi_end)
+        // demangle on all threads, prettyName() then only hits the cache
+        get(prop, *vi)->table().demangleAll();
+
+    StringTable names;
+    SymbolIndex::TEntryList entries;
+    entries.reserve(2 * num_vertices(graph));
+    for (; vi != vi_end; ++vi) {
+        const PFnc fnc = get(prop, *vi);
+        const std::string name = fnc->name();
+        entries.push_back(SymbolIndex::TEntry(names.intern(name), *vi));
+
+        const std::string pretty = fnc->prettyName();
+        if (pretty != name)
+            entries.push_back(SymbolIndex::TEntry(names.intern(pretty), *vi));
+    }
+
+    index.build(names, entries);
+}
+
+/**
+ * Adapts SymbolIndex to the interface of SymbolMap used by queries (find() and
+ * resolve()), so that queries can run on a graph loaded from an image.
+ */
+template <typename TGraph>
+class IndexedSymbolMap {
+    public:
+        typedef typename boost::graph_traits<TGraph>        Traits;
+        typedef typename Traits::vertex_descriptor          TVertex;
+        typedef typename std::vector<TVertex>               TVertexList;
+        typedef std::vector<std::string>                    TNameList;
+
+    public:
+        /**
+         * The index has to stay valid as long as the map is used.
+         */
+        IndexedSymbolMap(const SymbolIndex &index):
+            index_(index)
+        {
+        }
+
+        /// see SymbolMap::find()
+        TVertexList find(const std::string &symbol) const {
+            const SymbolIndex::TVertexRange range = index_.find(symbol);
+            return TVertexList(range.first, range.second);
+        }
+
+        TVertexList operator[] (const std::string &symbol) const {
+            return this->find(symbol);
+        }
+
+        /// see SymbolMap::resolve()
+        template <typename TIterator>
+        size_t resolve(TIterator first, TIterator last, TVertexList &dst,
+                       TNameList *missing = 0) const
+        {
+            const size_t dstStart = dst.size();
+            size_t nFound = 0;
+            for (; first != last; ++first) {
+                const std::string &name = *first;
+                const SymbolIndex::TVertexRange range = index_.find(name);
+                if (range.first == range.second) {
+                    if (missing)
+                        missing->push_back(name);
+                    continue;
+                }
+
+                ++nFound;
+                dst.insert(dst.end(), range.first, range.second);
+            }
+
+            const typename TVertexList::iterator begin = dst.begin() + dstStart;
+            std::sort(begin, dst.end());
+            dst.erase(std::unique(begin, dst.end()), dst.end());
+            return nFound;
+        }
+
+        /**
+         * @return Return count of names in the index.
+         */
+        size_t size() const {
+            return index_.size();
+        }
+
+    private:
+        const SymbolIndex           &index_;
+};
+
+#endif // SYMBOL_INDEX_H
@@ -22,41 +22,240 @@
 
 #include "config.hh"
 #include "CallGraph.hh"
+#include "NameDict.hh"
+#include "StringTable.hh"
 
 #include <boost/graph/adjacency_list.hpp>
 
-#include <map>
+#include <algorithm>
 #include <string>
 #include <vector>
 
+/**
+ * Maps symbol names to vertices of the call graph. Exact names are interned in
+ * a StringTable, whose open-addressed hash gives each name a key and the map
+ * keeps a list of vertices for each key. A function with a mangled C++ name is
+ * reachable by both its mangled and demangled name. Lookups never change what
+ * the map answers, names which are not there are answered by an empty list.
+ *
+ * Demangled names are added by addDemangled(), all at once by
+ * FncTable::demangleAll(), so that graphs which are only queried by the names
+ * as read never get demangled. Prefix lookups go through a NameDict, which is
+ * built on the first prefix lookup from all names in the map (unless it is
+ * given by the caller). The dictionary is a copy of the names, so prefix
+ * lookups cost memory on top of the map rather than save any. The map refers
+ * to the dictionary it owns, so it can't be copied.
+ */
 template <typename TGraph>
 class SymbolMap {
     public:
         typedef typename boost::graph_traits<TGraph>        Traits;
         typedef typename Traits::vertex_descriptor          TVertex;
         typedef typename std::vector<TVertex>               TVertexList;
-        typedef typename std::map<std::string, TVertexList> TSymbolMap;
+        typedef NameDict::TId                               TId;
+        typedef std::vector<std::string>                    TNameList;
 
     public:
-        SymbolMap(const TGraph &graph) {
+        /**
+         * Build the symbol map, the name dictionary is built when needed.
+         */
+        SymbolMap(const TGraph &graph):
+            graph_(graph),
+            dict_(0)
+        {
+            init();
+        }
+
+        /**
+         * Use an already built name dictionary (e.g. one built by buildNameDict()).
+         * The dictionary has to stay valid as long as the SymbolMap is used.
+         */
+        SymbolMap(const TGraph &graph, const NameDict &dict):
+            graph_(graph),
+            dict_(&dict)
+        {
+            init();
+        }
+
+        /**
+         * Add the demangled names of all functions with a mangled name. Until
+         * it is called, lookups find the functions by mangled names only.
+         * Calling it again does nothing.
+         */
+        void addDemangled() {
             using namespace boost;
 
+            if (!hasMangled_)
+                return;
+            hasMangled_ = false;
+
             typedef property_map<TGraph, FncProp>           TPropMapping;
             typedef typename TPropMapping::const_type       TProp;
-            TProp prop = get(FncProp(), graph);
+            TProp prop = get(FncProp(), graph_);
 
             typename Traits::vertex_iterator vi, vi_end;
-            for(tie(vi, vi_end) = vertices(graph); vi != vi_end; ++vi) {
-                PFnc fnc = get(prop, *vi);
-                map_[fnc->name].push_back(*vi);
+            tie(vi, vi_end) = vertices(graph_);
+            if (vi == vi_end)
+                return;
+
+            // demangle on all threads, prettyName() then only hits the cache
+            get(prop, *vi)->table().demangleAll();
+
+            for (; vi != vi_end; ++vi) {
+                const PFnc fnc = get(prop, *vi);
+                if (isMangled(fnc->name()))
+                    this->add(fnc->prettyName(), *vi);
+            }
+        }
+
+        /**
+         * @return Return the list of vertices of the given (mangled or
+         * demangled) name. The list is empty if there is no such symbol.
+         */
+        TVertexList find(const std::string &symbol) const {
+            const StringTable::TId key = keys_.find(symbol);
+            return (StringTable::NOT_FOUND == key)
+                ? TVertexList()
+                : map_[key];
+        }
+
+        /**
+         * Same as find().
+         */
+        TVertexList operator[] (const std::string &symbol) const {
+            return this->find(symbol);
+        }
+
+        /**
+         * Resolve a batch of names in one pass. Vertices of all names found are
+         * appended to dst, each of them once and in the order of vertices.
+         * Names which are not found are appended to missing if given.
+         * @return Return count of names found.
+         */
+        template <typename TIterator>
+        size_t resolve(TIterator first, TIterator last, TVertexList &dst,
+                       TNameList *missing = 0) const
+        {
+            const size_t dstStart = dst.size();
+            size_t nFound = 0;
+            for (; first != last; ++first) {
+                const std::string &name = *first;
+                const StringTable::TId key = keys_.find(name);
+                if (StringTable::NOT_FOUND == key) {
+                    if (missing)
+                        missing->push_back(name);
+                    continue;
+                }
+
+                ++nFound;
+                const TVertexList &list = map_[key];
+                dst.insert(dst.end(), list.begin(), list.end());
             }
+
+            // a vertex may be requested by more names (or by both of its names)
+            const typename TVertexList::iterator begin = dst.begin() + dstStart;
+            std::sort(begin, dst.end());
+            dst.erase(std::unique(begin, dst.end()), dst.end());
+            return nFound;
         }
 
-        const TVertexList& operator[] (const std::string &symbol) {
-            return map_[symbol];
+        /**
+         * Append all vertices whose name begins with the given prefix. The
+         * first call builds the name dictionary if it was not given.
+         */
+        void findPrefix(const std::string &prefix, TVertexList &dst) {
+            const NameDict &dict = this->names();
+            NameDict::TRange range = dict.prefixRange(prefix);
+            for (TId id = range.first; id < range.second; ++id) {
+                const StringTable::TId key = dictKeys_[id];
+                if (StringTable::NOT_FOUND == key)
+                    continue;
+
+                const TVertexList &list = map_[key];
+                dst.insert(dst.end(), list.begin(), list.end());
+            }
         }
+
+        /**
+         * @return Return the name dictionary used for prefix lookups, it is
+         * built now from all names in the map (including the demangled ones
+         * added so far) if there is none yet.
+         */
+        const NameDict& names() {
+            if (!dict_) {
+                TNameList all;
+                all.reserve(keys_.size());
+                for (StringTable::TId key = 0; key < keys_.size(); ++key)
+                    all.push_back(std::string(keys_[key], keys_.length(key)));
+
+                ownDict_.build(all);
+                dict_ = &ownDict_;
+            }
+
+            if (dictKeys_.size() != dict_->size()) {
+                dictKeys_.resize(dict_->size());
+                for (TId id = 0; id < dict_->size(); ++id)
+                    dictKeys_[id] = keys_.find((*dict_)[id]);
+            }
+
+            return *dict_;
+        }
+
+        /**
+         * @return Return count of names (including demangled ones, once they
+         * are added) in the map.
+         */
+        size_t size() const {
+            return keys_.size();
+        }
+
     private:
-        TSymbolMap map_;
+        typedef typename std::vector<TVertexList>           TSymbolMap;
+        typedef std::vector<StringTable::TId>               TKeyList;
+
+        const TGraph                &graph_;
+        NameDict                    ownDict_;
+        const NameDict              *dict_;
+        StringTable                 keys_;
+        TSymbolMap                  map_;
+        TKeyList                    dictKeys_;  ///< key of each name in dict_
+        bool                        hasMangled_;
+
+    private:
+        SymbolMap(const SymbolMap &);
+        SymbolMap& operator=(const SymbolMap &);
+
+        void add(const std::string &name, TVertex v) {
+            const StringTable::TId key = keys_.intern(name);
+            if (map_.size() <= key)
+                map_.resize(key + 1);
+
+            TVertexList &list = map_[key];
+            if (list.empty() || list.back() != v)
+                list.push_back(v);
+        }
+
+        static bool isMangled(const std::string &name) {
+            // only names of the C++ ABI are worth trying to demangle
+            return !name.compare(0, 2, "_Z");
+        }
+
+        void init() {
+            using namespace boost;
+
+            typedef property_map<TGraph, FncProp>           TPropMapping;
+            typedef typename TPropMapping::const_type       TProp;
+            TProp prop = get(FncProp(), graph_);
+
+            hasMangled_ = false;
+            map_.reserve(num_vertices(graph_));
+            typename Traits::vertex_iterator vi, vi_end;
+            for(tie(vi, vi_end) = vertices(graph_); vi != vi_end; ++vi) {
+                const std::string name = get(prop, *vi)->name();
+                this->add(name, *vi);
+                hasMangled_ |= isMangled(name);
+            }
+        }
 };
 
 #endif // SYMBOL_MAP_H
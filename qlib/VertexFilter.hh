@@ -61,4 +61,13 @@ class VertexFilter:
         }
 };
 
+namespace boost {
+    /// property maps of VertexFilter are those of the original graph
+    template <typename TGraph, template <typename> class TPred, typename TTag>
+    struct property_map<VertexFilter<TGraph, TPred>, TTag>:
+        public property_map<TGraph, TTag>
+    {
+    };
+}
+
 #endif // VERTEX_FILTER_H
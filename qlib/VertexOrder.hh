@@ -0,0 +1,358 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VERTEX_ORDER_H
+#define VERTEX_ORDER_H
+
+#include "config.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/graph/graph_traits.hpp>
+
+/**
+ * New number of each vertex, indexed by the old number. Vertex orders are
+ * computed for graphs with continuous vertex numbers (CallGraph or
+ * CsrCallGraph) and applied by CsrCallGraph::renumber().
+ */
+typedef std::vector<boost::uint32_t> TVertexOrder;
+
+/**
+ * Vertex orderings which improve locality of graph traversals. Vertices
+ * which are visited together get close numbers, so that their adjacency
+ * lists and bits in bitmap indexes share cache lines.
+ */
+enum EVertexOrder {
+    VO_INPUT,       ///< keep the order of input (no renumbering)
+    VO_BFS,         ///< breadth-first search from roots (uncalled functions)
+    VO_RCM,         ///< reverse Cuthill-McKee of the undirected graph
+    VO_TOPO         ///< topological order of strongly connected components
+};
+
+/**
+ * @return Return the vertex order of the given name (input, bfs, rcm, topo).
+ * If the name is not known, VO_INPUT is returned and ok is set to false.
+ */
+inline EVertexOrder vertexOrderByName(const std::string &name, bool &ok) {
+    ok = true;
+    if (name == "bfs")
+        return VO_BFS;
+    if (name == "rcm")
+        return VO_RCM;
+    if (name == "topo")
+        return VO_TOPO;
+
+    ok = (name == "input");
+    return VO_INPUT;
+}
+
+namespace VertexOrderImpl {
+    const boost::uint32_t NONE = static_cast<boost::uint32_t>(-1);
+
+    /// compare vertices by their (undirected) degree
+    class DegreeLess {
+        public:
+            DegreeLess(const std::vector<boost::uint32_t> &degree):
+                degree_(&degree)
+            {
+            }
+
+            bool operator()(boost::uint32_t a, boost::uint32_t b) const {
+                return (*degree_)[a] < (*degree_)[b];
+            }
+
+        private:
+            const std::vector<boost::uint32_t> *degree_;
+    };
+}
+
+/**
+ * Number vertices in order of breadth-first search along call edges. The
+ * search is started from all vertices without callers (in order of their
+ * numbers), vertices not reachable from them (cycles only) are appended by
+ * another search started from the first unvisited vertex. O(V+E).
+ */
+template <typename TGraph>
+TVertexOrder bfsVertexOrder(const TGraph &graph) {
+    using namespace boost;
+    using VertexOrderImpl::NONE;
+    typedef graph_traits<TGraph>                        Traits;
+
+    const size_t nVert = num_vertices(graph);
+    TVertexOrder order(nVert, NONE);
+    std::vector<uint32_t> queue;
+    queue.reserve(nVert);
+
+    // start from roots first, then from whatever is left
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t root = 0; root < nVert; ++root) {
+            if (NONE != order[root])
+                continue;
+            if (!pass && in_degree(root, graph))
+                continue;
+
+            size_t head = queue.size();
+            order[root] = queue.size();
+            queue.push_back(root);
+            for (; head < queue.size(); ++head) {
+                typename Traits::out_edge_iterator oi, oi_end;
+                for (tie(oi, oi_end) = out_edges(queue[head], graph);
+                        oi != oi_end; ++oi)
+                {
+                    const size_t v = target(*oi, graph);
+                    if (NONE != order[v])
+                        continue;
+
+                    order[v] = queue.size();
+                    queue.push_back(v);
+                }
+            }
+        }
+    }
+
+    assert(queue.size() == nVert);
+    return order;
+}
+
+/**
+ * Number vertices in reverse Cuthill-McKee order of the graph taken as
+ * undirected (callers and callees are both neighbors). Each component is
+ * started from its vertex of the lowest degree, neighbors are visited in
+ * order of increasing degree. It keeps the bandwidth of the adjacency matrix
+ * low. O(V+E log D) where D is the maximal degree.
+ */
+template <typename TGraph>
+TVertexOrder rcmVertexOrder(const TGraph &graph) {
+    using namespace boost;
+    using VertexOrderImpl::NONE;
+    typedef graph_traits<TGraph>                        Traits;
+    typedef std::vector<uint32_t>                       TList;
+
+    const size_t nVert = num_vertices(graph);
+    TList degree(nVert);
+    TList byDegree(nVert);
+    for (size_t v = 0; v < nVert; ++v) {
+        degree[v] = in_degree(v, graph) + out_degree(v, graph);
+        byDegree[v] = v;
+    }
+    const VertexOrderImpl::DegreeLess less(degree);
+    std::stable_sort(byDegree.begin(), byDegree.end(), less);
+
+    TVertexOrder order(nVert, NONE);
+    TList queue;
+    queue.reserve(nVert);
+    TList next;
+    for (size_t i = 0; i < nVert; ++i) {
+        const uint32_t root = byDegree[i];
+        if (NONE != order[root])
+            continue;
+
+        size_t head = queue.size();
+        order[root] = queue.size();
+        queue.push_back(root);
+        for (; head < queue.size(); ++head) {
+            const uint32_t current = queue[head];
+
+            // collect unvisited neighbors in both directions
+            next.clear();
+            typename Traits::out_edge_iterator oi, oi_end;
+            for (tie(oi, oi_end) = out_edges(current, graph); oi != oi_end;
+                    ++oi)
+            {
+                const uint32_t v = target(*oi, graph);
+                if (NONE == order[v]) {
+                    order[v] = 0;
+                    next.push_back(v);
+                }
+            }
+            typename Traits::in_edge_iterator ii, ii_end;
+            for (tie(ii, ii_end) = in_edges(current, graph); ii != ii_end;
+                    ++ii)
+            {
+                const uint32_t v = source(*ii, graph);
+                if (NONE == order[v]) {
+                    order[v] = 0;
+                    next.push_back(v);
+                }
+            }
+
+            // enqueue them in order of increasing degree
+            std::stable_sort(next.begin(), next.end(), less);
+            for (TList::const_iterator i = next.begin(); i != next.end(); ++i) {
+                order[*i] = queue.size();
+                queue.push_back(*i);
+            }
+        }
+    }
+
+    // reverse the Cuthill-McKee order
+    assert(queue.size() == nVert);
+    for (size_t v = 0; v < nVert; ++v)
+        order[v] = nVert - 1 - order[v];
+
+    return order;
+}
+
+/**
+ * Find strongly connected components of the graph by iterative Tarjan's
+ * algorithm. Components are numbered in reverse topological order of the
+ * condensation, i.e. a component gets a lower number than components calling
+ * it. O(V+E).
+ * @param comp Component of each vertex is stored there.
+ * @return Return count of components.
+ */
+template <typename TGraph>
+size_t strongComponents(const TGraph &graph, std::vector<boost::uint32_t> &comp)
+{
+    using namespace boost;
+    using VertexOrderImpl::NONE;
+    typedef graph_traits<TGraph>                        Traits;
+    typedef typename Traits::out_edge_iterator          TOutEdgeIterator;
+    typedef std::vector<uint32_t>                       TList;
+
+    struct Frame {
+        uint32_t            v;
+        TOutEdgeIterator    oi;
+        TOutEdgeIterator    oi_end;
+    };
+
+    const size_t nVert = num_vertices(graph);
+    TList disc(nVert, NONE);
+    TList low(nVert);
+    TList stack;
+    std::vector<Frame> frames;
+    uint32_t nDisc = 0;
+    uint32_t nComp = 0;
+    comp.assign(nVert, NONE);
+
+    for (size_t root = 0; root < nVert; ++root) {
+        if (NONE != disc[root])
+            continue;
+
+        Frame f;
+        f.v = root;
+        tie(f.oi, f.oi_end) = out_edges(root, graph);
+        disc[root] = low[root] = nDisc++;
+        stack.push_back(root);
+        frames.push_back(f);
+
+        while (!frames.empty()) {
+            Frame &top = frames.back();
+            const uint32_t v = top.v;
+            if (top.oi != top.oi_end) {
+                const uint32_t w = target(*top.oi, graph);
+                ++top.oi;
+                if (NONE == disc[w]) {
+                    // descend
+                    Frame f;
+                    f.v = w;
+                    tie(f.oi, f.oi_end) = out_edges(w, graph);
+                    disc[w] = low[w] = nDisc++;
+                    stack.push_back(w);
+                    frames.push_back(f);
+                }
+                else if (NONE == comp[w])
+                    // w is still on the stack
+                    low[v] = std::min(low[v], disc[w]);
+                continue;
+            }
+
+            // all successors done, v is the root of a component if low == disc
+            if (low[v] == disc[v]) {
+                uint32_t w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    comp[w] = nComp;
+                } while (w != v);
+                ++nComp;
+            }
+
+            frames.pop_back();
+            if (!frames.empty()) {
+                const uint32_t parent = frames.back().v;
+                low[parent] = std::min(low[parent], low[v]);
+            }
+        }
+    }
+
+    return nComp;
+}
+
+/**
+ * Number vertices in topological order of the condensation of the graph,
+ * i.e. a function gets a lower number than its callees unless they are in
+ * the same strongly connected component (recursion). Vertices of one
+ * component keep their relative order. Everything reachable from a vertex
+ * thus lies above it, which is where its OUT bitmap index has its bits.
+ * Components are found by strongComponents(). O(V+E).
+ */
+template <typename TGraph>
+TVertexOrder topoVertexOrder(const TGraph &graph) {
+    using namespace boost;
+    typedef std::vector<uint32_t>                       TList;
+
+    const size_t nVert = num_vertices(graph);
+    TList comp;
+    const uint32_t nComp = strongComponents(graph, comp);
+
+    // components are numbered in reverse topological order, count them back
+    TList start(nComp + 1, 0);
+    for (size_t v = 0; v < nVert; ++v)
+        ++start[nComp - comp[v]];
+    for (uint32_t c = 0; c < nComp; ++c)
+        start[c + 1] += start[c];
+
+    TVertexOrder order(nVert);
+    for (size_t v = 0; v < nVert; ++v)
+        order[v] = start[nComp - 1 - comp[v]]++;
+
+    return order;
+}
+
+/**
+ * @return Return new numbers of vertices in the given order.
+ */
+template <typename TGraph>
+TVertexOrder vertexOrder(const TGraph &graph, EVertexOrder type) {
+    switch (type) {
+        case VO_BFS:
+            return bfsVertexOrder(graph);
+
+        case VO_RCM:
+            return rcmVertexOrder(graph);
+
+        case VO_TOPO:
+            return topoVertexOrder(graph);
+
+        case VO_INPUT:
+            break;
+    }
+
+    TVertexOrder order(num_vertices(graph));
+    for (size_t v = 0; v < order.size(); ++v)
+        order[v] = v;
+    return order;
+}
+
+#endif // VERTEX_ORDER_H
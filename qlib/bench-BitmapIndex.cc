@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Compare two ways of building all IN bitmap indexes (of the default, dense
+ * storage) of a graph, the traversal of BitmapIndexer::build() and the
+ * transposition of all OUT indexes by BitmapIndexer::transpose(). The graph is
+ * read from the given .cg file (renumbered in topological order unless another
+ * vertex order is given). Without a file, random graphs of layers of
+ * functions calling the layer below are used, with more and more calls. Both
+ * results are checked to be the same.
+ *
+ * usage: bench-BitmapIndex [FILE [input|bfs|rcm|topo]]
+ */
+
+#include "config.hh"
+#include "BitmapIndex.hh"
+#include "CallGraph.hh"
+#include "Cgt.hh"
+#include "CsrCallGraph.hh"
+#include "VertexOrder.hh"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <sys/time.h>
+
+#include <boost/graph/adjacency_list.hpp>
+
+/// wall clock time in milliseconds, the builds may run in parallel
+double now() {
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return 1e3 * tv.tv_sec + 1e-3 * tv.tv_usec;
+}
+
+/// layers of 1000 functions, each calling a few functions of the layer below
+void buildLayered(CsrCallGraph &graph, unsigned nCalls) {
+    using namespace boost;
+    typedef adjacency_list<vecS, vecS, bidirectionalS>  TShape;
+
+    const size_t nLayer = 1000;
+    const size_t nVert = 40 * nLayer;
+    TShape shape(nVert);
+    boost::uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (size_t v = 0; v < nVert - nLayer; ++v) {
+        for (unsigned i = 0; i < nCalls; ++i) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            add_edge(v, nLayer * (v / nLayer + 1) + seed % nLayer, shape);
+        }
+    }
+
+    CallGraph loaded;
+    for (size_t v = 0; v < nVert; ++v) {
+        Fnc fnc;
+        fnc.name = "f";
+        add_vertex(fnc, loaded);
+    }
+    graph_traits<TShape>::edge_iterator ei, ei_end;
+    for (tie(ei, ei_end) = edges(shape); ei != ei_end; ++ei)
+        add_edge(source(*ei, shape), target(*ei, shape), loaded);
+
+    graph.assign(loaded);
+}
+
+/// @return Return true if all indexes of both indexers are the same
+template <typename TIndexer>
+bool same(TIndexer &a, TIndexer &b, typename TIndexer::EDirection dir) {
+    const size_t nVert = num_vertices(a.graph());
+    for (size_t v = 0; v < nVert; ++v)
+        if (a.index(v, dir) != b.index(v, dir))
+            return false;
+
+    return true;
+}
+
+/// best time of a few runs of both ways
+bool bench(const CsrCallGraph &graph) {
+    typedef BitmapIndexer<CsrCallGraph>                 TIndexer;
+
+    std::cout << std::setw(7) << num_vertices(graph) << " vertices, "
+        << std::setw(7) << num_edges(graph) << " edges: " << std::flush;
+
+    const int nRuns = 5;
+    double bestOut = 0, bestIn = 0, bestTransposed = 0;
+    size_t memory = 0;
+    bool ok = true;
+    for (int run = 0; run < nRuns; ++run) {
+        TIndexer built(graph);
+        double start = now();
+        built.build(TIndexer::OUT);
+        const double out = now() - start;
+        start = now();
+        built.build(TIndexer::IN);
+        const double in = now() - start;
+        memory = built.memoryUsage();
+
+        TIndexer transposed(graph);
+        transposed.build(TIndexer::OUT);
+        start = now();
+        transposed.transpose(TIndexer::IN);
+        const double t = now() - start;
+        ok = ok && same(built, transposed, TIndexer::IN);
+
+        if (!run || out < bestOut)
+            bestOut = out;
+        if (!run || in < bestIn)
+            bestIn = in;
+        if (!run || t < bestTransposed)
+            bestTransposed = t;
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "OUT built " << std::setw(7) << bestOut << " ms"
+        << ", IN built " << std::setw(7) << bestIn << " ms"
+        << ", IN transposed " << std::setw(7) << bestTransposed << " ms"
+        << " (" << memory << " bytes)"
+        << ((ok) ? "" : " MISMATCH") << std::endl;
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    CsrCallGraph graph;
+    if (argc < 2) {
+        bool ok = true;
+        for (unsigned nCalls = 2; nCalls <= 16; nCalls *= 2) {
+            buildLayered(graph, nCalls);
+            ok &= bench(graph);
+        }
+
+        return (ok) ? 0 : 1;
+    }
+
+    std::fstream str(argv[1], std::ios::in);
+    if (!str) {
+        std::cerr << "can't open " << argv[1] << std::endl;
+        return 1;
+    }
+
+    CallGraph loaded;
+    CgtGraphBuilder<CallGraph> builder(loaded);
+    CgtReader(&builder).read(str, false);
+    graph.assign(loaded);
+
+    bool ok;
+    const std::string orderName((argc < 3) ? "topo" : argv[2]);
+    const EVertexOrder order = vertexOrderByName(orderName, ok);
+    if (!ok) {
+        std::cerr << "unknown vertex order " << orderName << std::endl;
+        return 1;
+    }
+    if (VO_INPUT != order)
+        graph.renumber(vertexOrder(graph, order));
+
+    return (bench(graph)) ? 0 : 1;
+}
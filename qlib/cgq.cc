@@ -26,15 +26,29 @@
 #include "BitmapIndex.hh"
 #include "CallGraph.hh"
 #include "Cgt.hh"
+#include "CompressedCallGraph.hh"
+#include "CsrCallGraph.hh"
+#include "Image.hh"
 #include "PathFinder.hh"
+#include "ReachIndex.hh"
+#include "ScopeTree.hh"
+#include "SymbolIndex.hh"
 #include "SymbolMap.hh"
+#include "VertexOrder.hh"
 
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include <errno.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -42,6 +56,7 @@
 #include <readline/history.h>
 
 #include <boost/regex.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #define REGEX_ID "[A-Za-z_][A-Za-z0-9_]*"
 
@@ -82,6 +97,27 @@ inline void writePaths(
     }
 }
 
+/// compare vertices by their number in the input, see CsrCallGraph::renumber()
+template <typename TGraph>
+class OrigIndexLess {
+    public:
+        OrigIndexLess(const TGraph &graph): graph_(&graph) { }
+
+        bool operator()(size_t a, size_t b) const {
+            return graph_->origIndex(a) < graph_->origIndex(b);
+        }
+
+    private:
+        const TGraph *graph_;
+};
+
+/// sort vertices to the order of input, so that the output does not depend
+/// on renumbering of the graph
+template <typename TGraph, typename TVertexList>
+inline void sortByInput(const TGraph &graph, TVertexList &list) {
+    std::sort(list.begin(), list.end(), OrigIndexLess<TGraph>(graph));
+}
+
 template <typename TGraph, typename TIndexer, typename TSymbolMap>
 class PathLookup {
     public:
@@ -145,7 +181,7 @@ class PathLookup {
         {
             using namespace boost;
 
-            typedef BitmapFilter<TGraph>                        TFilter;
+            typedef typename TIndexer::TFilter                  TFilter;
             typedef PathFinder<TFilter, UniqEdgePath>           TFinder;
             typedef typename TFinder::TPathList                 TPathList;
             typedef typename TPathList::value_type              TPath;
@@ -235,8 +271,8 @@ class VertexLookup {
         }
 
         bool lookup(const std::string &symbol, int level = 0) {
-            const TVertexList &vertexList =
-                (symbol == "*") ? all_ : sMap_[symbol];
+            TVertexList vertexList = (symbol == "*") ? all_ : sMap_[symbol];
+            sortByInput(graph_, vertexList);
 
             if (!vertexList.size()) {
                 std::cerr << Color(C_LIGHT_RED) << "symbol not found: "
@@ -244,7 +280,6 @@ class VertexLookup {
                 return false;
             }
 
-            size_t nVert = all_.size();
             typename TVertexList::const_iterator vi;
             for(vi = vertexList.begin(); vi != vertexList.end(); ++vi) {
                 std::cout << get(fncProp_, *vi) << std::endl;
@@ -252,26 +287,22 @@ class VertexLookup {
                     continue;
 
                 if (1 < level) {
-                    typedef typename TIndexer::TIndex TIndex;
-                    const TIndex &idxIn = indexer_.index(*vi, TIndexer::IN);
-                    for(TVertex v = 0; v < nVert; ++v)
-                        if (idxIn[v])
-                            std::cout << "  <---- " << get(fncProp_, v) << std::endl;
-
-                    const TIndex &idxOut = indexer_.index(*vi, TIndexer::OUT);
-                    for(TVertex v = 0; v < nVert; ++v)
-                        if (idxOut[v])
-                            std::cout << "  ----> " << get(fncProp_, v) << std::endl;
-
+                    writeIndex(indexer_.index(*vi, TIndexer::IN), "  <---- ");
+                    writeIndex(indexer_.index(*vi, TIndexer::OUT), "  ----> ");
                     continue;
                 }
 
+                // in edges are ordered by caller, keep the order of input
+                TVertexList callers;
                 typename Traits::in_edge_iterator ii, ii_end;
-                for(tie(ii, ii_end) = in_edges(*vi, graph_); ii != ii_end; ++ii) {
-                    TVertex v = source(*ii, graph_);
-                    std::cout << "  <-- " << get(fncProp_, v) << std::endl;
-                }
-
+                for(tie(ii, ii_end) = in_edges(*vi, graph_); ii != ii_end; ++ii)
+                    callers.push_back(source(*ii, graph_));
+                sortByInput(graph_, callers);
+                typename TVertexList::const_iterator ci;
+                for (ci = callers.begin(); ci != callers.end(); ++ci)
+                    std::cout << "  <-- " << get(fncProp_, *ci) << std::endl;
+
+                // out edges follow the calls as read (sorted by callee if -z)
                 typename Traits::out_edge_iterator oi, oi_end;
                 for(tie(oi, oi_end) = out_edges(*vi, graph_); oi != oi_end; ++oi) {
                     TVertex v = target(*oi, graph_);
@@ -281,6 +312,48 @@ class VertexLookup {
             return true;
         }
 
+        /// look up all names listed in the given file, one name per line
+        bool lookupBatch(const std::string &fileName) {
+            using std::string;
+
+            std::fstream str(fileName.c_str(), std::ios::in);
+            if (!str) {
+                std::cerr << Color(C_LIGHT_RED) << "can't open "
+                    << Color(C_NO_COLOR) << fileName << std::endl;
+                return false;
+            }
+
+            std::vector<string> names;
+            string line;
+            while (getline(str, line)) {
+                const size_t first = line.find_first_not_of(" \t\r");
+                if (string::npos == first)
+                    continue;
+
+                const size_t last = line.find_last_not_of(" \t\r");
+                names.push_back(line.substr(first, last - first + 1));
+            }
+
+            // resolve all the names at once
+            TVertexList vertexList;
+            std::vector<string> missing;
+            sMap_.resolve(names.begin(), names.end(), vertexList, &missing);
+            sortByInput(graph_, vertexList);
+
+            std::vector<string>::const_iterator mi;
+            for (mi = missing.begin(); mi != missing.end(); ++mi)
+                std::cerr << Color(C_LIGHT_RED) << "symbol not found: "
+                    << Color(C_NO_COLOR) << *mi << std::endl;
+
+            typename TVertexList::const_iterator vi;
+            for (vi = vertexList.begin(); vi != vertexList.end(); ++vi)
+                std::cout << get(fncProp_, *vi) << std::endl;
+
+            std::cerr << "--- " << (names.size() - missing.size()) << " of "
+                << names.size() << " symbols found" << std::endl;
+            return !vertexList.empty();
+        }
+
     private:
         typedef boost::property_map<TGraph, FncProp>    TPropMapping;
         typedef typename TPropMapping::const_type       TProp;
@@ -290,6 +363,87 @@ class VertexLookup {
         TSymbolMap          &sMap_;
         TProp               fncProp_;
         TVertexList         all_;
+
+    private:
+        template <typename TIndex>
+        void writeIndex(const TIndex &index, const char *prefix) {
+            TVertexList list;
+            for (size_t v = index.find_first(); v != TIndex::npos;
+                    v = index.find_next(v))
+                list.push_back(v);
+
+            sortByInput(graph_, list);
+            typename TVertexList::const_iterator i;
+            for (i = list.begin(); i != list.end(); ++i)
+                std::cout << prefix << get(fncProp_, *i) << std::endl;
+        }
+};
+
+template <typename TGraph>
+class ScopeLookup {
+    public:
+        typedef boost::graph_traits<TGraph>             Traits;
+        typedef typename Traits::vertex_descriptor      TVertex;
+        typedef std::vector<TVertex>                    TVertexList;
+
+    public:
+        ScopeLookup(const TGraph &graph):
+            graph_(graph),
+            fncProp_(get(FncProp(), graph))
+        {
+        }
+
+        /// list functions within the given scope, or all scopes of that name
+        bool lookup(const std::string &scope) {
+            if (!tree_) {
+                // build the tree on the first scope query
+                std::cerr << "--- building scope tree ... " << std::flush;
+                tree_.reset(new ScopeTree);
+                buildScopeTree(*tree_, graph_);
+                std::cerr << "done (" << tree_->size() << " scopes)"
+                    << std::endl;
+            }
+
+            ScopeTree::TNodeList nodes;
+            const ScopeTree::TNode node = tree_->find(scope);
+            if (ScopeTree::NOT_FOUND != node)
+                nodes.push_back(node);
+            else
+                tree_->findNamed(scope, nodes);
+
+            TVertexList vertexList;
+            ScopeTree::TNodeList::const_iterator ni;
+            for (ni = nodes.begin(); ni != nodes.end(); ++ni) {
+                const ScopeTree::TVertexRange range = tree_->vertices(*ni);
+                vertexList.insert(vertexList.end(), range.first, range.second);
+            }
+
+            if (vertexList.empty()) {
+                std::cerr << Color(C_LIGHT_RED) << "scope not found: "
+                    << Color(C_NO_COLOR) << scope << std::endl;
+                return false;
+            }
+
+            // scopes of the same name may be nested in each other
+            std::sort(vertexList.begin(), vertexList.end());
+            vertexList.erase(std::unique(vertexList.begin(), vertexList.end()),
+                             vertexList.end());
+            sortByInput(graph_, vertexList);
+
+            typename TVertexList::const_iterator vi;
+            for (vi = vertexList.begin(); vi != vertexList.end(); ++vi)
+                std::cout << get(fncProp_, *vi) << std::endl;
+
+            return true;
+        }
+
+    private:
+        typedef boost::property_map<TGraph, FncProp>    TPropMapping;
+        typedef typename TPropMapping::const_type       TProp;
+
+        const TGraph                    &graph_;
+        TProp                           fncProp_;
+        boost::scoped_ptr<ScopeTree>    tree_;
 };
 
 class StopWatch {
@@ -319,17 +473,22 @@ std::ostream& operator<<(std::ostream &str, const StopWatch &watch) {
 template <typename TGraph, typename TIndexer, typename TSymbolMap>
 class CmdHandler {
     public:
-        CmdHandler(const TGraph &graph, TIndexer &indexer, TSymbolMap &sMap):
+        CmdHandler(const TGraph &graph, TIndexer &indexer, TSymbolMap &sMap,
+                   bool transpose):
             graph_(graph),
             indexer_(indexer),
             sMap_(sMap),
+            transpose_(transpose),
             lVertex_(graph, indexer, sMap),
             lPath_(graph, indexer, sMap),
+            lScope_(graph),
             rePath_( "^ *(?:\\*|(?:" REGEX_ID ":?):?) *(?:\\*|(?:" REGEX_ID
                     ":?):?) *$"),
             reVertex_( "^\\? *((?:\\*|(?:" REGEX_ID ":?):?)) *$"),
             reVertexAdj_("^\\?\\? *((?:\\*|(?:" REGEX_ID ":?):?)) *$"),
-            reDeepVertex_( "^\\?\\?\\? *((?:\\*|(?:" REGEX_ID ":?):?)) *$")
+            reDeepVertex_( "^\\?\\?\\? *((?:\\*|(?:" REGEX_ID ":?):?)) *$"),
+            reBatch_("^< *(.*[^ ]) *$"),
+            reScope_("^: *(.*[^ ]|) *$")
         {
         }
 
@@ -357,17 +516,25 @@ class CmdHandler {
             if (regex_match(line, result, reDeepVertex_))
                 return lVertex_.lookup(result[1], 2);
 
+            if (regex_match(line, result, reBatch_))
+                return lVertex_.lookupBatch(result[1]);
+
+            if (regex_match(line, result, reScope_))
+                return lScope_.lookup(result[1]);
+
             if (line == std::string("!index")) {
                 std::cerr << "--- building OUT indexes" << std::flush;
-                indexer_.build(TIndexer::OUT);
-                std::cerr << std::endl;
+                this->buildIndexes(TIndexer::OUT, TIndexer::IN);
+                std::cerr << " (" << indexer_.memoryUsage() << " bytes)"
+                    << std::endl;
                 return true;
             }
 
             if (line == std::string("!rindex")) {
                 std::cerr << "--- building IN indexes" << std::flush;
-                indexer_.build(TIndexer::IN);
-                std::cerr << std::endl;
+                this->buildIndexes(TIndexer::IN, TIndexer::OUT);
+                std::cerr << " (" << indexer_.memoryUsage() << " bytes)"
+                    << std::endl;
                 return true;
             }
 
@@ -376,67 +543,49 @@ class CmdHandler {
             return false;
         }
     private:
+        typedef typename TIndexer::EDirection           EDirection;
         typedef VertexLookup<TGraph, TIndexer, TSymbolMap>  TVertexLookup;
         typedef PathLookup<TGraph, TIndexer, TSymbolMap>  TPathLookup;
+        typedef ScopeLookup<TGraph>                     TScopeLookup;
 
         const TGraph        &graph_;
         TIndexer            &indexer_;
         TSymbolMap          &sMap_;
+        const bool          transpose_;
 
         TVertexLookup lVertex_;
         TPathLookup lPath_;
+        TScopeLookup lScope_;
         StopWatch watch_;
 
         const boost::regex rePath_;
         const boost::regex reVertex_;
         const boost::regex reVertexAdj_;
         const boost::regex reDeepVertex_;
+        const boost::regex reBatch_;
+        const boost::regex reScope_;
+
+        /// build all indexes, or transpose all those of the other type
+        void buildIndexes(EDirection dir, EDirection other) {
+            if (transpose_ && indexer_.isComplete(other)) {
+                std::cerr << " by transposition" << std::flush;
+                indexer_.transpose(dir);
+            }
+            else
+                indexer_.build(dir);
+        }
 };
 
-int main(int argc, char *argv[]) {
+/// run queries from terminal or stdin on the given graph
+template <typename TGraph, typename TIndexer, typename TSymbolMap>
+int runQueries(const TGraph &graph, TIndexer &indexer, TSymbolMap &sMap,
+               bool transpose)
+{
     using std::string;
 
-    Color::enable(ttyname(STDERR_FILENO));
-
-    // TODO: use getopt_long to read cmd-line args
-    if (argc < 2)
-        return 1;
-
-    // open cg file
-    const char *cgFile = argv[1];
-    std::fstream str(cgFile, std::ios::in);
-    if (!str) {
-        std::cerr << Color(C_LIGHT_RED) << "can't open " << Color(C_NO_COLOR)
-            << cgFile << std::endl;
-        return 1;
-    }
-
-    // create call graph
-    typedef CallGraph TGraph;
-    TGraph graph;
-
-    // parse input
-    {
-        std::cerr << "--- parsing " << cgFile << " ... " << std::flush;
-        CgtGraphBuilder<TGraph> builder(graph);
-        CgtReader reader(&builder);
-        reader.read(str, true);
-        std::cerr << "done" << std::endl;
-    }
-
-    // build symbol table
-    std::cerr << "--- building symbol table ... " << std::flush;
-    typedef SymbolMap<TGraph> TSymbolMap;
-    TSymbolMap sMap(graph);
-    std::cerr << "done" << std::endl;
-
-    // bitmap indexer
-    typedef BitmapIndexer<TGraph> TBitmapIndexer;
-    TBitmapIndexer indexer(graph);
-
     // universal command handler
-    typedef CmdHandler<TGraph, TBitmapIndexer, TSymbolMap> TCmdHandler;
-    TCmdHandler cmd(graph, indexer, sMap);
+    typedef CmdHandler<TGraph, TIndexer, TSymbolMap> TCmdHandler;
+    TCmdHandler cmd(graph, indexer, sMap, transpose);
 
     // determine terminal mode
     bool interactiveMode = ttyname(STDIN_FILENO) && ttyname(STDOUT_FILENO);
@@ -464,6 +613,12 @@ int main(int argc, char *argv[]) {
             << Color(C_LIGHT_GREEN) << "      ???" << Color(C_NO_COLOR)
             << Color(C_YELLOW) << "symbol" << Color(C_NO_COLOR)
             << " - deep symbol lookup (requires bitmap index)" << std::endl
+            << Color(C_LIGHT_GREEN) << "       <" << Color(C_NO_COLOR)
+            << Color(C_YELLOW) << "file" << Color(C_NO_COLOR)
+            << " - look up all symbols listed in file" << std::endl
+            << Color(C_LIGHT_GREEN) << "       :" << Color(C_NO_COLOR)
+            << Color(C_YELLOW) << "scope" << Color(C_NO_COLOR)
+            << " - all functions in namespace/class (C++)" << std::endl
             << Color(C_YELLOW) << "symbol1 symbol2" << Color(C_NO_COLOR)
             << " - search all paths between symbols" << std::endl
             << Color(C_LIGHT_BLUE) << "              *" << Color(C_NO_COLOR)
@@ -498,3 +653,351 @@ int main(int argc, char *argv[]) {
 
     return 0;
 }
+
+/**
+ * Data of a cgq session. The graph is either parsed from a .cg file, or it is
+ * loaded from a session image (written by --snapshot) together with the symbol
+ * index and bitmap indexes, which are then used in place of the mapped image.
+ * Bitmap indexes of a .cg file are kept in an index file next to it, which is
+ * used in place as well as long as the graph hash matches (see graphHash()).
+ */
+struct Session {
+    CsrCallGraph                    graph;
+    MappedFile                      image;
+    boost::scoped_ptr<ImageReader>  reader;     ///< set if loaded from image
+    SymbolIndex                     symbols;    ///< valid if loaded from image
+    const char                      *snapshot;  ///< image to write, or 0
+    EIndexStorage                   storage;    ///< type of bitmap indexes
+    std::string                     indexFile;  ///< index file of .cg, or ""
+    MappedFile                      indexImage;
+    boost::scoped_ptr<ImageReader>  indexReader;///< set if index file is used
+    bool                            transpose;  ///< transpose complete indexes
+
+    Session():
+        snapshot(0),
+        storage(IS_DENSE),
+        transpose(false)
+    {
+    }
+};
+
+/**
+ * Output file which is written under a temporary name and replaces the file
+ * only once written, as the file may be the one which is mapped. The
+ * temporary file is created by mkstemp() next to the file, so that sessions
+ * writing the same file at once do not write into each other's data.
+ */
+class ReplacedFile {
+    public:
+        ReplacedFile(const std::string &fileName):
+            fileName_(fileName),
+            done_(false)
+        {
+            std::cerr << "--- writing " << fileName_ << " ... " << std::flush;
+
+            std::string tmpl = fileName + ".XXXXXX";
+            std::vector<char> name(tmpl.begin(), tmpl.end());
+            name.push_back('\0');
+            const int fd = mkstemp(&name[0]);
+            if (-1 == fd)
+                // str_ stays closed, so that commit() fails
+                return;
+
+            // mkstemp() creates the file for the owner only
+            const mode_t mask = umask(0);
+            umask(mask);
+            fchmod(fd, 0666 & ~mask);
+            close(fd);
+
+            tmpName_ = &name[0];
+            str_.open(tmpName_.c_str(), std::ios::out | std::ios::binary
+                                      | std::ios::trunc);
+        }
+
+        ~ReplacedFile() {
+            if (!done_ && !tmpName_.empty())
+                unlink(tmpName_.c_str());
+        }
+
+        std::ostream& str() {
+            return str_;
+        }
+
+        /// @return Return false if the file could not be written
+        bool commit() {
+            str_.close();
+            done_ = str_ && !std::rename(tmpName_.c_str(), fileName_.c_str());
+            if (!done_) {
+                std::cerr << Color(C_LIGHT_RED) << "can't write "
+                    << Color(C_NO_COLOR) << fileName_ << std::endl;
+                return false;
+            }
+
+            std::cerr << "done" << std::endl;
+            return true;
+        }
+
+    private:
+        const std::string   fileName_;
+        std::string         tmpName_;   ///< empty if not created
+        std::ofstream       str_;
+        bool                done_;
+};
+
+/// write the graph, symbol index and all bitmap indexes built so far
+template <typename TIndexer>
+bool writeSnapshot(Session &session, const TIndexer &indexer) {
+    if (!session.reader) {
+        std::cerr << "--- building symbol index ... " << std::flush;
+        buildSymbolIndex(session.symbols, session.graph);
+        std::cerr << "done" << std::endl;
+    }
+
+    ReplacedFile file(session.snapshot);
+    {
+        ImageWriter img(file.str());
+        session.graph.save(img);
+        session.symbols.save(img);
+        indexer.save(img);
+    }
+
+    return file.commit();
+}
+
+/**
+ * Use bitmap indexes of the index file, if it was written for the same graph
+ * and the same storage. They stay in the mapped file until they are needed.
+ */
+template <typename TIndexer>
+bool loadIndexFile(Session &session, TIndexer &indexer) {
+    const std::string &fileName = session.indexFile;
+    if (fileName.empty() || !session.indexImage.open(fileName))
+        return false;
+
+    session.indexReader.reset(new ImageReader(session.indexImage.data(),
+                                              session.indexImage.size()));
+    if (!session.indexReader->good() || !indexer.load(*session.indexReader)) {
+        // stale index file, it is replaced once indexes are built again
+        session.indexReader.reset();
+        session.indexImage.close();
+        return false;
+    }
+
+    std::cerr << "--- using bitmap indexes of " << fileName << std::endl;
+    return true;
+}
+
+/// write all bitmap indexes built so far to the index file
+template <typename TIndexer>
+bool writeIndexFile(Session &session, const TIndexer &indexer) {
+    ReplacedFile file(session.indexFile);
+    {
+        ImageWriter img(file.str());
+        indexer.save(img);
+    }
+
+    return file.commit();
+}
+
+/// run queries on the given graph with indexes of the given type
+template <typename TIndexer, typename TGraph>
+int runIndexed(const TGraph &graph, Session &session) {
+    TIndexer indexer(graph);
+    bool complete[] = { false, false };
+
+    int rc;
+    if (session.reader) {
+        // indexes follow the symbol index in the image, they are built again
+        // if they are kept in another storage
+        if (!indexer.load(*session.reader))
+            std::cerr << Color(C_LIGHT_RED) << "bitmap indexes not loaded "
+                << Color(C_NO_COLOR) << "(damaged image or another storage)"
+                << std::endl;
+
+        IndexedSymbolMap<TGraph> sMap(session.symbols);
+        rc = runQueries(graph, indexer, sMap, session.transpose);
+    }
+    else {
+        if (loadIndexFile(session, indexer)) {
+            complete[TIndexer::IN] = indexer.isComplete(TIndexer::IN);
+            complete[TIndexer::OUT] = indexer.isComplete(TIndexer::OUT);
+        }
+
+        // build symbol table
+        std::cerr << "--- building symbol table ... " << std::flush;
+        SymbolMap<TGraph> sMap(graph);
+        sMap.addDemangled();
+        std::cerr << "done" << std::endl;
+        rc = runQueries(graph, indexer, sMap, session.transpose);
+    }
+
+    // keep the indexes for next time once all of some type are built, the
+    // session does not fail if they can't be written
+    const bool newIn = !complete[TIndexer::IN]
+        && indexer.isComplete(TIndexer::IN);
+    const bool newOut = !complete[TIndexer::OUT]
+        && indexer.isComplete(TIndexer::OUT);
+    if (!rc && !session.indexFile.empty() && (newIn || newOut))
+        writeIndexFile(session, indexer);
+
+    if (rc || !session.snapshot)
+        return rc;
+
+    return (writeSnapshot(session, indexer)) ? 0 : 1;
+}
+
+/// run queries on the given graph (or on its compressed copy)
+template <typename TGraph>
+int runSession(const TGraph &graph, Session &session) {
+    switch (session.storage) {
+        case IS_ROARING:
+            return runIndexed<BitmapIndexer<TGraph, RoaringBitmap> >(graph,
+                                                                    session);
+
+        case IS_LABELS:
+            return runIndexed<ReachIndexer<TGraph> >(graph, session);
+
+        case IS_DENSE:
+            break;
+    }
+
+    return runIndexed<BitmapIndexer<TGraph> >(graph, session);
+}
+
+/// parse the given .cg file
+bool parseGraph(CsrCallGraph &graph, const char *cgFile) {
+    std::fstream str(cgFile, std::ios::in);
+    if (!str) {
+        std::cerr << Color(C_LIGHT_RED) << "can't open " << Color(C_NO_COLOR)
+            << cgFile << std::endl;
+        return false;
+    }
+
+    std::cerr << "--- parsing " << cgFile << " ... " << std::flush;
+    CallGraph loaded;
+    CgtGraphBuilder<CallGraph> builder(loaded);
+    CgtReader reader(&builder);
+    reader.read(str, false);
+
+    // the graph is never changed once loaded
+    graph.assign(loaded);
+    std::cerr << "done" << std::endl;
+    return true;
+}
+
+/// load the graph and symbol index of an already mapped session image
+bool loadImage(Session &session, const char *imgFile) {
+    std::cerr << "--- loading " << imgFile << " ... " << std::flush;
+    session.reader.reset(new ImageReader(session.image.data(),
+                                         session.image.size()));
+    if (!session.graph.load(*session.reader)
+            || !session.symbols.load(*session.reader,
+                                     num_vertices(session.graph)))
+    {
+        std::cerr << Color(C_LIGHT_RED) << "invalid image" << Color(C_NO_COLOR)
+            << std::endl;
+        return false;
+    }
+
+    std::cerr << "done" << std::endl;
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    using std::string;
+
+    Color::enable(ttyname(STDERR_FILENO));
+
+    static const struct option longOptions[] = {
+        { "order",          required_argument,  0, 'o' },
+        { "compress",       no_argument,        0, 'z' },
+        { "snapshot",       required_argument,  0, 's' },
+        { "index-storage",  required_argument,  0, 'i' },
+        { "transpose",      no_argument,        0, 't' },
+        { 0,                0,                  0,  0  }
+    };
+
+    Session session;
+    EVertexOrder order = VO_INPUT;
+    bool compress = false;
+    int opt;
+    while (-1 != (opt = getopt_long(argc, argv, "o:z", longOptions, 0))) {
+        bool ok = true;
+        switch (opt) {
+            case 'z':
+                compress = true;
+                break;
+
+            case 's':
+                session.snapshot = optarg;
+                break;
+
+            case 'o':
+                order = vertexOrderByName(optarg, ok);
+                break;
+
+            case 'i':
+                session.storage = indexStorageByName(optarg, ok);
+                break;
+
+            case 't':
+                session.transpose = true;
+                break;
+
+            default:
+                ok = false;
+        }
+
+        if (!ok) {
+            std::cerr << "usage: " << argv[0]
+                << " [-o input|bfs|rcm|topo] [-z] [--snapshot IMAGE]"
+                << " [--index-storage dense|roaring|labels] [--transpose]"
+                << " FILE|IMAGE"
+                << std::endl;
+            return 1;
+        }
+    }
+    if (argc <= optind)
+        return 1;
+
+    // session images are recognized by their header, anything else is .cg
+    const char *inFile = argv[optind];
+    if (session.image.open(inFile) && session.image.isImage()) {
+        if (!loadImage(session, inFile))
+            return 1;
+
+        // vertices of the image are numbered already
+        if (VO_INPUT != order)
+            std::cerr << "--- vertex order of the image is kept" << std::endl;
+    }
+    else {
+        session.image.close();
+        if (!parseGraph(session.graph, inFile))
+            return 1;
+
+        // bitmap indexes of the graph are kept next to it
+        session.indexFile = string(inFile) + ".idx";
+
+        // renumber vertices for locality of index builds and path lookups
+        if (VO_INPUT != order) {
+            std::cerr << "--- renumbering vertices ... " << std::flush;
+            session.graph.renumber(vertexOrder(session.graph, order));
+            std::cerr << "done" << std::endl;
+        }
+    }
+
+    // compress adjacency lists, the CSR graph is not needed any more then
+    // (unless it is to be written to a snapshot)
+    if (compress) {
+        std::cerr << "--- compressing graph ... " << std::flush;
+        const size_t csrSize = session.graph.memoryUsage();
+        const CompressedCallGraph packed(session.graph);
+        if (!session.snapshot)
+            session.graph = CsrCallGraph();
+        std::cerr << "done (" << csrSize << " -> " << packed.memoryUsage()
+            << " bytes)" << std::endl;
+        return runSession(packed, session);
+    }
+
+    return runSession(session.graph, session);
+}
@@ -1,9 +1,12 @@
 #include "BitmapIndex.hh"
 #include "CallGraph.hh"
 #include "Cgt.hh"
+#include "CsrCallGraph.hh"
 #include "Color.hh"
 #include "Linker.hh"
 #include "PathFinder.hh"
+#include "ScopeTree.hh"
+#include "SymbolMap.hh"
 #include "VertexFilter.hh"
 
 #include <algorithm>
@@ -17,10 +20,11 @@
 #include <boost/foreach.hpp>
 #include <boost/graph/graphviz.hpp>
 #include <boost/python.hpp>
+#include <boost/shared_ptr.hpp>
 
 using namespace boost::python;
 
-typedef CallGraph TGraph;
+typedef CsrCallGraph TGraph;
 
 struct ProgramSymbol;
 typedef std::vector<ProgramSymbol *> psym_vect;
@@ -44,11 +48,11 @@ class ProgramSymbol {
         }
 
         bool is_static() const {
-            return !fnc_->isGlobal;
+            return !fnc_->isGlobal();
         }
 
         bool is_decl() const {
-            return !fnc_->isDefined;
+            return !fnc_->isDefined();
         }
 
         bool is_var() const {
@@ -56,7 +60,7 @@ class ProgramSymbol {
         }
 
         int get_line_number() const {
-            return fnc_->loc.lineno;
+            return fnc_->line();
         }
 
         psym_vect* get_callees() {
@@ -75,12 +79,12 @@ class ProgramSymbol {
             return pv;
         }
 
-        char const* psym_get_name() const {
-            return fnc_->name.c_str();
+        std::string psym_get_name() const {
+            return fnc_->prettyName();
         }
 
-        char const* get_file_name() const {
-            return fnc_->loc.file->c_str();
+        std::string get_file_name() const {
+            return fnc_->file();
         }
 
         int hash() const {
@@ -98,7 +102,7 @@ class ProgramSymbol {
                 return 0;
         }
 
-        char const* repr() const {
+        std::string repr() const {
             return psym_get_name();
         }
 
@@ -194,19 +198,23 @@ class vset;
 class cgfile {
     public:
         typedef BitmapIndexer<TGraph>                   TIndexer;
+        typedef SymbolMap<TGraph>                       TSymbolMap;
 
     public:
         cgfile():
             //graph_(linker_.output())
-            indexer_(graph_)
+            indexer_(graph_),
+            dirty_(false)
         {
         }
 
-        const TGraph& graph() const {
+        const TGraph& graph() {
+            this->freeze();
             return graph_;
         }
 
         TIndexer& indexer() {
+            this->freeze();
             return indexer_;
         }
 
@@ -224,29 +232,69 @@ class cgfile {
             // parse input
             /*TGraph graph;
             CgtGraphBuilder<TGraph> builder(graph);*/
-            CgtGraphBuilder<TGraph> builder(graph_);
+            CgtGraphBuilder<CallGraph> builder(loaded_);
             CgtReader reader(&builder);
-            reader.read(str, true);
+            reader.read(str, false);
             str.close();
 
+            // the graph used for queries is frozen on the next query, so
+            // that including many files does not freeze it after each one
+            dirty_ = true;
+
+            // symbol map and scope tree have to be rebuilt on next query
+            sMap_.reset();
+            scopeTree_.reset();
+
             // link
             /*VertexFilter<TGraph, DropUnusedDeclarations> filtered(graph);
             linker_.link(filtered);*/
         }
 
         void compute_callers() {
+            this->freeze();
             indexer_.build();
         }
 
         vset* all_program_symbols();
 
+        vset* find_prefix(const std::string &prefix);
+
+        vset* find_names(const boost::python::object &names);
+
+        vset* find_scope(const std::string &scope);
+
     private:
         /*typedef Linker<TGraph>                          TLinker;
 
         TLinker linker_;
         const TGraph &graph_;*/
+        CallGraph   loaded_;
         TGraph      graph_;
         TIndexer    indexer_;
+        bool        dirty_;     ///< graph_ is older than loaded_
+        boost::shared_ptr<TSymbolMap> sMap_;
+        boost::shared_ptr<ScopeTree> scopeTree_;
+
+    private:
+        /// build the graph used for queries of all files included so far
+        void freeze() {
+            if (!dirty_)
+                return;
+
+            graph_.assign(loaded_);
+            indexer_.clear();
+            dirty_ = false;
+        }
+
+        /// symbol map of the frozen graph, with demangled names added
+        TSymbolMap& symbolMap() {
+            this->freeze();
+            if (!sMap_) {
+                sMap_.reset(new TSymbolMap(graph_));
+                sMap_->addDemangled();
+            }
+            return *sMap_;
+        }
 };
 
 class vset {
@@ -254,6 +302,7 @@ class vset {
         typedef cgfile::TIndexer                        TIndexer;
         typedef TBitmapIndex                            TBitmap;
 
+        /// visits set bits only, a word of the bitmap at a time
         class iterator {
             public:
                 typedef boost::graph_traits<TGraph>     Traits;
@@ -268,42 +317,30 @@ class vset {
 
             public:
                 bool operator==(const vset::iterator &other) const {
-                    return i_ == other.i_;
+                    return pos_ == other.pos_;
                 }
 
                 iterator& operator++() {
-                    assert(i_ != end_);
-                    ++i_;
-
-                    while ((i_ != end_) && !bitmap_[*i_])
-                        ++i_;
-
+                    assert(pos_ != TBitmap::npos);
+                    pos_ = bitmap_.find_next(pos_);
                     return *this;
                 }
 
                 value_type operator*() {
-                    assert(i_ != end_);
-                    return *i_;
+                    assert(pos_ != TBitmap::npos);
+                    return pos_;
                 }
 
             private:
                 iterator(const vset &vs, bool end):
-                    bitmap_(vs.bitmap())
+                    bitmap_(vs.bitmap()),
+                    pos_((end) ? TBitmap::npos : bitmap_.find_first())
                 {
-                    tie(i_, end_) = vertices(vs.graph());
-
-                    if (end) {
-                        i_ = end_;
-                        return;
-                    }
-
-                    while ((i_ != end_) && !bitmap_[*i_])
-                        ++i_;
                 }
 
             private:
-                TVertIterator   i_, end_;
                 const TBitmap   &bitmap_;
+                size_t          pos_;
 
                 friend class vset;
         };
@@ -346,7 +383,7 @@ class vset {
         }
 
         void add(ProgramSymbol &ps) {
-            bitmap_[ps.get_id()] = true;
+            bitmap_.set(ps.get_id());
         }
 
         size_t size() const {
@@ -360,7 +397,7 @@ class vset {
         void update(const psym_vect &pv) {
             BOOST_FOREACH(ProgramSymbol *psym, pv) {
                 TVertex v = psym->get_id();
-                bitmap_[v] = true;
+                bitmap_.set(v);
             }
         }
 
@@ -369,9 +406,7 @@ class vset {
         }
 
         void sub(const vset &other) {
-            TBitmap mask(other.bitmap_);
-            mask.flip();
-            bitmap_ &= mask;
+            bitmap_ -= other.bitmap_;
         }
 
         template <template <typename> class TUniq>
@@ -419,7 +454,7 @@ inline vset sub(vset self, const vset &other) {
 
 struct vset_binder {
     static std::string repr(vset &ps) {
-        const TGraph g = ps.graph();
+        const TGraph &g = ps.graph();
         std::string s("(");
 
         vset::iterator i = ps.begin();
@@ -452,6 +487,63 @@ vset* cgfile::all_program_symbols() {
     return new vset(*this, true);
 }
 
+vset* cgfile::find_prefix(const std::string &prefix) {
+    TSymbolMap &sMap = this->symbolMap();
+
+    TSymbolMap::TVertexList list;
+    sMap.findPrefix(prefix, list);
+
+    vset *vs = new vset(*this);
+    BOOST_FOREACH(TSymbolMap::TVertex v, list) {
+        ProgramSymbol ps(graph_, v);
+        vs->add(ps);
+    }
+    return vs;
+}
+
+vset* cgfile::find_names(const boost::python::object &names) {
+    TSymbolMap &sMap = this->symbolMap();
+
+    // resolve the whole sequence of names at once
+    typedef boost::python::stl_input_iterator<std::string> TNameIterator;
+    TSymbolMap::TVertexList list;
+    sMap.resolve(TNameIterator(names), TNameIterator(), list);
+
+    vset *vs = new vset(*this);
+    BOOST_FOREACH(TSymbolMap::TVertex v, list) {
+        ProgramSymbol ps(graph_, v);
+        vs->add(ps);
+    }
+    return vs;
+}
+
+vset* cgfile::find_scope(const std::string &scope) {
+    this->freeze();
+    if (!scopeTree_) {
+        scopeTree_.reset(new ScopeTree);
+        buildScopeTree(*scopeTree_, graph_);
+    }
+
+    // the given scope, or all scopes of that name
+    ScopeTree::TNodeList nodes;
+    const ScopeTree::TNode node = scopeTree_->find(scope);
+    if (ScopeTree::NOT_FOUND != node)
+        nodes.push_back(node);
+    else
+        scopeTree_->findNamed(scope, nodes);
+
+    vset *vs = new vset(*this);
+    BOOST_FOREACH(ScopeTree::TNode n, nodes) {
+        const ScopeTree::TVertexRange range = scopeTree_->vertices(n);
+        for (ScopeTree::TVertexIterator i = range.first; i != range.second; ++i)
+        {
+            ProgramSymbol ps(graph_, *i);
+            vs->add(ps);
+        }
+    }
+    return vs;
+}
+
 template <template <typename> class TUniq>
 path_vect* vset::find_paths(const vset &dstSet) {
     typedef TBitmapIndex                        TBitmap;
@@ -459,24 +551,30 @@ path_vect* vset::find_paths(const vset &dstSet) {
 
     const size_t nVert = num_vertices(graph_);
 
+    // masks are ORed in rows of a bit matrix, like the indexes are stored
+    BitMatrix masks;
+    masks.assign(2, nVert);
+
     // compute mask for srcSet
-    TBitmap srcMask;
+    BitRow &srcMask = masks[0];
     srcMask.resize(nVert, false);
     BOOST_FOREACH(TVertex src, (*this)) {
-        srcMask[src] = true;
+        srcMask.set(src);
         srcMask |= indexer_.index(src, TIndexer::OUT);
     }
 
     // compute mask for dstSet
-    TBitmap dstMask;
+    BitRow &dstMask = masks[1];
     dstMask.resize(nVert, false);
     BOOST_FOREACH(TVertex dst, dstSet) {
-        dstMask[dst] = true;
+        dstMask.set(dst);
         dstMask |= indexer_.index(dst, TIndexer::IN);
     }
 
     // prune graph by the masks
-    TFilter prunedGraph(graph_, srcMask & dstMask);
+    TBitmap mask;
+    intersectIndexes(mask, srcMask, dstMask);
+    TFilter prunedGraph(graph_, mask);
 
     // search all paths
     TPathSet pset;
@@ -518,12 +616,16 @@ vset* vset::find_reachable(bool reverse) {
 
     const size_t nVert = num_vertices(graph_);
 
-    TBitmap mask;
-    mask.resize(nVert, false);
+    BitMatrix masks;
+    masks.assign(1, nVert);
+    BitRow &row = masks[0];
+    row.resize(nVert, false);
     BOOST_FOREACH(TVertex src, (*this)) {
-        mask |= indexer_.index(src, reverse ? TIndexer::IN : TIndexer::OUT);
+        row |= indexer_.index(src, reverse ? TIndexer::IN : TIndexer::OUT);
     }
 
+    TBitmap mask;
+    copyIndex(mask, row);
     return new vset(*this, mask);
 }
 
@@ -543,7 +645,7 @@ class SimpleFncWriter {
         void operator()(std::ostream &out, TVertex vertex) {
             PFnc fnc = get(fncProp_, vertex);
             out << "[label=\""
-                << boost::regex_replace(fnc->name, reTmpl_, "")
+                << boost::regex_replace(fnc->prettyName(), reTmpl_, "")
                 << "\"]";
         }
 
@@ -596,6 +698,15 @@ BOOST_PYTHON_MODULE(cgt)
         .def("all_program_symbols", &cgfile:: all_program_symbols,
                 return_value_policy<manage_new_object>())
 
+        .def("find_prefix",         &cgfile:: find_prefix,
+                return_value_policy<manage_new_object>())
+
+        .def("find_names",          &cgfile:: find_names,
+                return_value_policy<manage_new_object>())
+
+        .def("find_scope",          &cgfile:: find_scope,
+                return_value_policy<manage_new_object>())
+
         ;
 
     class_<vset>("vset",            init<cgfile &>())
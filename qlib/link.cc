@@ -23,50 +23,120 @@
 #include "Cgt.hh"
 #include "Color.hh"
 #include "Linker.hh"
+#include "OrderedQueue.hh"
 #include "VertexFilter.hh"
 
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <unistd.h>
+
+/// input file recorded by a parser thread
+struct ParsedFile {
+    bool            opened;
+    CgtRecordBatch  batch;
+};
+
+typedef OrderedQueue<ParsedFile> TQueue;
+
+/// parser thread, parses files in the order claimed from queue
+void parseFiles(TQueue *queue, char **files, size_t nFiles) {
+    size_t seq;
+    while ((seq = queue->claim()) < nFiles) {
+        ParsedFile *file = new ParsedFile;
+        std::fstream str(files[seq], std::ios::in);
+        file->opened = !!str;
+        if (file->opened) {
+            CgtReader reader(&file->batch);
+            reader.read(str, false);
+        }
+        queue->push(seq, file);
+    }
+}
+
+/// upper bound of -j, the threads only parse files ahead of the linker
+static const long MAX_THREADS = 256;
+
+/// @return Return true if str is a whole number in range 1..MAX_THREADS
+static bool parseThreads(const char *str, size_t &nThreads) {
+    char *end;
+    errno = 0;
+    const long n = strtol(str, &end, 10);
+    if (end == str || *end || errno || n < 1 || MAX_THREADS < n)
+        return false;
+
+    nThreads = n;
+    return true;
+}
 
 int main(int argc, char *argv[]) {
     Color::enable(true);
 
-    typedef CgtGraphBuilder<CallGraph> TBuilder;
-    Linker<CallGraph> linker;
+    // count of parser threads, -j THREADS, by default one per hardware
+    // thread (hardware_concurrency()), or one if that is not known
+    size_t nThreads = std::thread::hardware_concurrency();
+    if (!nThreads)
+        nThreads = 1;
+    else if (static_cast<size_t>(MAX_THREADS) < nThreads)
+        nThreads = MAX_THREADS;
 
-    char **args = argv + 1;
-    const char *inputFile;
-    while ((inputFile = *args++)) {
-        std::fstream str(inputFile, std::ios::in);
-        if (!str) {
-            std::cerr << Color(C_LIGHT_RED) << "can't open " << Color(C_NO_COLOR)
-                << inputFile << std::endl;
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "j:"))) {
+        if ('j' == opt && parseThreads(optarg, nThreads))
             continue;
-        }
-#if DEBUG_SHOW_CG_FILE
-        std::cerr << "--- "
-            << Color(C_YELLOW) << inputFile << Color(C_NO_COLOR)
+
+        std::cerr << "usage: " << argv[0]
+            << " [-j THREADS] FILE..." << std::endl
+            << "THREADS is 1 to " << MAX_THREADS
+            << ", it defaults to the count of hardware threads"
             << std::endl;
-#endif
+        return 1;
+    }
 
-        // parse input
-        typedef CallGraph TGraph;
-        TGraph graph;
+    typedef CallGraph TGraph;
+    Linker<TGraph> linker;
 
-        CgtGraphBuilder<TGraph> builder(graph);
-        CgtReader reader(&builder);
-        reader.read(str, false);
+    // functions are linked directly from recorded input
+    CgtLinkerBuilder<TGraph> builder(linker);
 
-        // link
-        VertexFilter<CallGraph, DropUnusedDeclarations> fg(graph);
-        linker.link(fg);
+    // parser threads are at most two files ahead of the linker each
+    char **files = argv + optind;
+    const size_t nFiles = argc - optind;
+    TQueue queue(nFiles, 2 * nThreads);
+    std::vector<std::thread> parsers;
+    for (size_t i = 0; i < nThreads; ++i)
+        parsers.push_back(std::thread(parseFiles, &queue, files, nFiles));
 
-        str.close();
+    // link files in the input order
+    for (size_t i = 0; i < nFiles; ++i) {
+        ParsedFile *file = queue.pop();
+        if (!file->opened) {
+            std::cerr << Color(C_LIGHT_RED) << "can't open " << Color(C_NO_COLOR)
+                << files[i] << std::endl;
+        } else {
+#if DEBUG_SHOW_CG_FILE
+            std::cerr << "--- "
+                << Color(C_YELLOW) << files[i] << Color(C_NO_COLOR)
+                << std::endl;
+#endif
+            file->batch.replay(builder);
+        }
+        delete file;
     }
 
+    for (size_t i = 0; i < nThreads; ++i)
+        parsers[i].join();
+
+    // drop unused declarations, the output graph is not copied
+    VertexFilter<TGraph, DropUnusedDeclarations> output(linker.output());
+
     // write output
     CgtWriter writer(std::cout);
-    write(linker.output(), writer);
+    write(output, writer);
 
     return 0;
 }
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "BitMatrix.hh"
+
+#undef NDEBUG
+#include <cassert>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <boost/dynamic_bitset.hpp>
+
+typedef boost::dynamic_bitset<>                         TBitset;
+
+void checkSame(const BitRow &row, const TBitset &expected) {
+    assert(row.size() == expected.size());
+    assert(row.count() == expected.count());
+    assert(row.any() == expected.any());
+
+    size_t pos = row.find_first();
+    size_t exp = expected.find_first();
+    for (; exp != TBitset::npos; exp = expected.find_next(exp)) {
+        assert(pos == exp);
+        assert(row[pos]);
+        pos = row.find_next(pos);
+    }
+    assert(pos == BitRow::npos);
+}
+
+void checkRows() {
+    const size_t nBits[] = { 1, 63, 64, 65, 511, 512, 513, 5000 };
+    for (unsigned k = 0; k < sizeof nBits / sizeof *nBits; ++k) {
+        const size_t n = nBits[k];
+        BitMatrix matrix;
+        matrix.assign(5, n);
+        assert(matrix.size() == 5);
+
+        // rows start on cache lines and are not used yet
+        for (size_t r = 0; r < matrix.size(); ++r) {
+            assert(!(reinterpret_cast<size_t>(matrix[r].data())
+                        % BitMatrixImpl::ALIGN));
+            assert(!matrix[r].size());
+            assert(!matrix[r].num_blocks());
+        }
+        assert(BitRow::paddedWords(n) % BitMatrixImpl::ROW_ALIGN_WORDS == 0);
+
+        BitRow &a = matrix[1];
+        BitRow &b = matrix[2];
+        a.resize(n);
+        b.resize(n, true);
+        TBitset ea(n), eb(n);
+        eb.set();
+        checkSame(a, ea);
+        checkSame(b, eb);
+        assert(a.none());
+
+        for (size_t i = 0; i < n; i += 3) {
+            a.set(i);
+            ea.set(i);
+        }
+        for (size_t i = 0; i < n; i += 7) {
+            b.reset(i);
+            eb.reset(i);
+        }
+        checkSame(a, ea);
+        checkSame(b, eb);
+
+        // neighbor rows are not touched
+        assert(!matrix[0].size() && !matrix[3].size());
+
+        BitRow &c = matrix[3];
+        c.resize(n);
+        c |= a;
+        checkSame(c, ea);
+        assert(c == a);
+        c &= b;
+        checkSame(c, ea & eb);
+        c.resize(0);
+        c.resize(n);
+        c |= a;
+        c -= b;
+        checkSame(c, ea - eb);
+        assert((c != a) == ((ea - eb) != ea));
+
+        // copies own their rows
+        BitMatrix copy(matrix);
+        assert(copy.size() == matrix.size());
+        assert(copy[1] == a && copy[2] == b && !copy[0].size());
+        assert(copy[1].data() != a.data());
+        copy[0].resize(n, true);
+        copy[1].reset(0);
+        checkSame(a, ea);
+
+        // rows are cleared once not used
+        a.clear();
+        a.resize(n);
+        assert(a.none());
+    }
+}
+
+void checkBigMatrix() {
+    // pages are only allocated as rows are used
+    const size_t nBits = 200000;
+    BitMatrix matrix;
+    matrix.assign(nBits, nBits);
+    matrix.adviseHugePages();
+    BitRow &row = matrix[nBits - 1];
+    row.resize(nBits);
+    row.set(nBits - 1);
+    assert(row.count() == 1);
+    assert(row.find_first() == nBits - 1);
+    assert(matrix.memoryUsage() < 2 * nBits * sizeof(BitRow));
+
+    matrix.clear();
+    assert(!matrix.size());
+}
+
+/// @return Return count of bytes mapped by the process, 0 if not known
+size_t mappedBytes() {
+    std::ifstream maps("/proc/self/maps");
+    size_t total = 0;
+    std::string line;
+    while (std::getline(maps, line)) {
+        unsigned long start, end;
+        if (2 == std::sscanf(line.c_str(), "%lx-%lx", &start, &end))
+            total += end - start;
+    }
+
+    return total;
+}
+
+void checkUnmapped() {
+    // the size is not a multiple of page size, big enough to be aligned
+    const size_t nRows = 4001;
+    const size_t nBits = 5000;
+    BitMatrix matrix;
+    matrix.assign(nRows, nBits);
+    matrix.clear();
+
+    const size_t before = mappedBytes();
+    for (int i = 0; i < 32; ++i) {
+        matrix.assign(nRows, nBits);
+        matrix[i].resize(nBits, true);
+        matrix.clear();
+    }
+
+    // nothing of the extra huge page stays mapped
+    assert(mappedBytes() < before + BitMatrixImpl::HUGE_PAGE);
+}
+
+void checkTranspose() {
+    using namespace BitMatrixImpl;
+
+    TWord block[WORD_BITS];
+    TWord orig[WORD_BITS];
+    TWord seed = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < WORD_BITS; ++i) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        orig[i] = block[i] = seed;
+    }
+
+    transpose64(block);
+    for (size_t i = 0; i < WORD_BITS; ++i)
+        for (size_t j = 0; j < WORD_BITS; ++j)
+            assert(((block[i] >> j) & 1) == ((orig[j] >> i) & 1));
+
+    // transposed twice is the original
+    transpose64(block);
+    for (size_t i = 0; i < WORD_BITS; ++i)
+        assert(block[i] == orig[i]);
+
+    // one bit goes across the diagonal
+    for (size_t i = 0; i < WORD_BITS; ++i)
+        block[i] = 0;
+    block[3] = TWord(1) << 60;
+    transpose64(block);
+    for (size_t i = 0; i < WORD_BITS; ++i)
+        assert(block[i] == ((60 == i) ? TWord(1) << 3 : 0));
+}
+
+int main(int, char *[]) {
+    checkRows();
+    checkBigMatrix();
+    checkUnmapped();
+    checkTranspose();
+
+    return 0;
+}
@@ -23,6 +23,8 @@
 
 #undef NDEBUG
 #include <cassert>
+#include <cstring>
+#include <sstream>
 #include <vector>
 
 #include <boost/graph/adjacency_list.hpp>
@@ -41,15 +43,18 @@ class IndexChecker {
             out_(nVert_)
         {
             for (TVertex vertex = 0; vertex < nVert_; ++vertex) {
-                in_[vertex] = indexer.index(vertex, TIndexer::IN);
-                out_[vertex] = indexer.index(vertex, TIndexer::OUT);
+                copyIndex(in_[vertex], indexer.index(vertex, TIndexer::IN));
+                copyIndex(out_[vertex], indexer.index(vertex, TIndexer::OUT));
             }
         }
 
         void check() {
+            TBitmapIndex index;
             for (TVertex vertex = 0; vertex < nVert_; ++vertex) {
-                assert (in_[vertex] == indexer_.index(vertex, TIndexer::IN));
-                assert (out_[vertex] == indexer_.index(vertex, TIndexer::OUT));
+                copyIndex(index, indexer_.index(vertex, TIndexer::IN));
+                assert (in_[vertex] == index);
+                copyIndex(index, indexer_.index(vertex, TIndexer::OUT));
+                assert (out_[vertex] == index);
             }
         }
     private:
@@ -150,9 +155,290 @@ void checkOnList() {
     }
 }
 
+void checkComponents() {
+    using namespace boost;
+
+    typedef adjacency_list<vecS, vecS, bidirectionalS>  TGraph;
+    typedef graph_traits<TGraph>::vertex_descriptor     TVertex;
+    typedef BitmapIndexer<TGraph>                       TIndexer;
+
+    // chain of cycles 0 -> {1, 2, 3} -> 4 -> {5, 6}, 7 calls itself,
+    // 8 calls 7 and the cycle {5, 6}
+    TGraph graph(10);
+    add_edge(0, 1, graph);
+    add_edge(1, 2, graph);
+    add_edge(2, 3, graph);
+    add_edge(3, 1, graph);
+    add_edge(3, 4, graph);
+    add_edge(4, 5, graph);
+    add_edge(5, 6, graph);
+    add_edge(6, 5, graph);
+    add_edge(7, 7, graph);
+    add_edge(8, 7, graph);
+    add_edge(8, 6, graph);
+
+    // vertices of a component share their index
+    TIndexer indexer(graph);
+    indexer.build();
+    assert(&indexer.index(1, TIndexer::OUT) == &indexer.index(3, TIndexer::OUT));
+    assert(&indexer.index(5, TIndexer::IN) == &indexer.index(6, TIndexer::IN));
+    assert(&indexer.index(0, TIndexer::OUT) != &indexer.index(4, TIndexer::OUT));
+
+    const TIndexer::TIndex &out0 = indexer.index(0, TIndexer::OUT);
+    assert(out0.count() == 6);
+    assert(!out0[0] && out0[1] && out0[4] && out0[6] && !out0[7]);
+    const TIndexer::TIndex &out2 = indexer.index(2, TIndexer::OUT);
+    assert(out2.count() == 6);
+    assert(out2[1] && out2[2] && out2[3]);
+    assert(indexer.index(4, TIndexer::OUT).count() == 2);
+    assert(indexer.index(7, TIndexer::OUT).count() == 1);
+    assert(indexer.index(7, TIndexer::IN).count() == 2);
+    assert(indexer.index(9, TIndexer::IN).none());
+
+    const TIndexer::TIndex &in5 = indexer.index(5, TIndexer::IN);
+    assert(in5.count() == 8);
+    assert(!in5[7] && !in5[9] && in5[8] && in5[5]);
+
+    // the same as indexes built one by one by search
+    for (unsigned seed = 1; seed < 8; ++seed) {
+        const size_t nVert = 97;
+        TGraph random(nVert);
+        for (TVertex v = 0; v < nVert; ++v)
+            for (unsigned i = 0; i < 2; ++i)
+                add_edge(v, (v * seed * 31 + i * 17 + seed) % nVert, random);
+
+        TIndexer all(random);
+        all.build();
+        TIndexer single(random);
+        for (TVertex v = 0; v < nVert; ++v) {
+            assert(all.index(v, TIndexer::IN)
+                    == single.index(v, TIndexer::IN));
+            assert(all.index(v, TIndexer::OUT)
+                    == single.index(v, TIndexer::OUT));
+        }
+    }
+}
+
+void checkWideLevels() {
+    using namespace boost;
+
+    typedef adjacency_list<vecS, vecS, bidirectionalS>  TGraph;
+    typedef graph_traits<TGraph>::vertex_descriptor     TVertex;
+    typedef BitmapIndexer<TGraph>                       TIndexer;
+    typedef BitmapIndexer<TGraph, RoaringBitmap>        TRoaringIndexer;
+
+    // layers of 500 functions calling the layer below, with a few cycles,
+    // so that components of a level are built in parallel (with OpenMP)
+    const size_t nLayer = 500;
+    const size_t nVert = 4 * nLayer;
+    TGraph graph(nVert);
+    for (TVertex v = 0; v < nVert - nLayer; ++v) {
+        for (unsigned i = 0; i < 3; ++i)
+            add_edge(v, nLayer * (v / nLayer + 1) + (v * 7 + i * 131) % nLayer,
+                     graph);
+        if (!(v % 50))
+            add_edge(v, v + 1, graph);
+        if (!(v % 100))
+            add_edge(v + 1, v, graph);
+    }
+
+    TIndexer all(graph);
+    all.build();
+    TRoaringIndexer roaring(graph);
+    roaring.build();
+    TIndexer single(graph);
+    for (TVertex v = 0; v < nVert; v += 3) {
+        const TIndexer::TIndex &in = single.index(v, TIndexer::IN);
+        const TIndexer::TIndex &out = single.index(v, TIndexer::OUT);
+        assert(all.index(v, TIndexer::IN) == in);
+        assert(all.index(v, TIndexer::OUT) == out);
+
+        TBitmapIndex index, expected;
+        copyIndex(index, roaring.index(v, TRoaringIndexer::OUT));
+        copyIndex(expected, out);
+        assert(index == expected);
+    }
+}
+
+void checkRoaringStorage() {
+    using namespace boost;
+
+    typedef adjacency_list<vecS, vecS, bidirectionalS>  TGraph;
+    typedef graph_traits<TGraph>::vertex_descriptor     TVertex;
+    typedef BitmapIndexer<TGraph>                       TDenseIndexer;
+    typedef BitmapIndexer<TGraph, RoaringBitmap>        TIndexer;
+    typedef BitmapVertexPredicate<TGraph>               TPred;
+
+    for (unsigned seed = 1; seed < 6; ++seed) {
+        // a few long chains joined by random calls
+        const size_t nVert = 400;
+        TGraph graph(nVert);
+        for (TVertex v = 0; v < nVert; ++v) {
+            if (v % 100)
+                add_edge(v - 1, v, graph);
+            if (!(v % 7))
+                add_edge(v, (v * seed * 31 + seed) % nVert, graph);
+        }
+
+        TDenseIndexer dense(graph);
+        dense.build();
+        TIndexer all(graph);
+        all.build();
+        TIndexer single(graph);
+        for (TVertex v = 0; v < nVert; ++v) {
+            TBitmapIndex index, denseIndex;
+            copyIndex(index, all.index(v, TIndexer::IN));
+            copyIndex(denseIndex, dense.index(v, TDenseIndexer::IN));
+            assert(index == denseIndex);
+            copyIndex(index, all.index(v, TIndexer::OUT));
+            copyIndex(denseIndex, dense.index(v, TDenseIndexer::OUT));
+            assert(index == denseIndex);
+            assert(single.index(v, TIndexer::OUT)
+                    == all.index(v, TIndexer::OUT));
+
+            // predicates keep plain bitsets
+            const TVertex dst = (v * 13) % nVert;
+            const TPred pred(all, v, dst);
+            const TPred expected(dense, v, dst);
+            for (TVertex u = 0; u < nVert; ++u)
+                assert(pred(u) == expected(u));
+        }
+
+        // session images keep the kind of storage
+        std::ostringstream str;
+        {
+            ImageWriter img(str);
+            all.save(img);
+            assert(img.good());
+        }
+        const std::string data(str.str());
+        std::vector<boost::uint64_t> buf(data.size() / 8 + 1);
+        std::memcpy(&buf[0], data.data(), data.size());
+        const char *image = reinterpret_cast<const char *>(&buf[0]);
+
+        ImageReader img(image, data.size());
+        TIndexer loaded(graph);
+        assert(loaded.load(img));
+        for (TVertex v = 0; v < nVert; ++v)
+            assert(loaded.index(v, TIndexer::IN)
+                    == all.index(v, TIndexer::IN));
+
+        ImageReader again(image, data.size());
+        TDenseIndexer denseLoaded(graph);
+        assert(!denseLoaded.load(again));
+    }
+}
+
+void checkGraphHash() {
+    using namespace boost;
+
+    typedef adjacency_list<vecS, vecS, bidirectionalS>  TGraph;
+    typedef graph_traits<TGraph>::vertex_descriptor     TVertex;
+    typedef BitmapIndexer<TGraph>                       TIndexer;
+
+    const size_t nVert = 50;
+    TGraph graph(nVert);
+    TGraph reversed(nVert);
+    TGraph other(nVert);
+    for (TVertex v = 1; v < nVert; ++v) {
+        add_edge(v - 1, v, graph);
+        add_edge(nVert - v - 1, nVert - v, reversed);
+        add_edge(v - 1, (v < 40) ? v : v - 2, other);
+    }
+    assert(graphHash(graph) == graphHash(reversed));
+    assert(graphHash(graph) != graphHash(other));
+
+    TIndexer indexer(graph);
+    indexer.index(7, TIndexer::OUT);
+    assert(!indexer.isComplete(TIndexer::OUT));
+    indexer.build(TIndexer::OUT);
+    assert(indexer.isComplete(TIndexer::OUT));
+    assert(!indexer.isComplete(TIndexer::IN));
+
+    std::ostringstream str;
+    {
+        ImageWriter img(str);
+        indexer.save(img);
+    }
+    const std::string data(str.str());
+    std::vector<boost::uint64_t> buf(data.size() / 8 + 1);
+    std::memcpy(&buf[0], data.data(), data.size());
+    const char *image = reinterpret_cast<const char *>(&buf[0]);
+
+    // indexes of the same edges (in another order) are used in place
+    ImageReader img(image, data.size());
+    TIndexer loaded(reversed);
+    assert(loaded.load(img));
+    assert(loaded.isComplete(TIndexer::OUT));
+    assert(!loaded.isComplete(TIndexer::IN));
+    for (TVertex v = 0; v < nVert; ++v)
+        assert(loaded.index(v, TIndexer::OUT)
+                == indexer.index(v, TIndexer::OUT));
+
+    // indexes of another graph of the same size are refused
+    ImageReader again(image, data.size());
+    TIndexer refused(other);
+    assert(!refused.load(again));
+    assert(!refused.isComplete(TIndexer::OUT));
+}
+
+template <typename TIndexer, typename TGraph>
+void checkTransposed(const TGraph &graph) {
+    typedef typename TIndexer::TVertex                  TVertex;
+
+    TIndexer built(graph);
+    built.build();
+    TIndexer transposed(graph);
+    transposed.transpose(TIndexer::IN);
+    assert(transposed.isComplete(TIndexer::IN));
+    transposed.transpose(TIndexer::OUT);
+    assert(transposed.isComplete(TIndexer::OUT));
+
+    const size_t nVert = num_vertices(graph);
+    for (TVertex v = 0; v < nVert; ++v) {
+        assert(transposed.index(v, TIndexer::IN)
+                == built.index(v, TIndexer::IN));
+        assert(transposed.index(v, TIndexer::OUT)
+                == built.index(v, TIndexer::OUT));
+    }
+}
+
+void checkTranspose() {
+    using namespace boost;
+
+    typedef adjacency_list<vecS, vecS, bidirectionalS>  TGraph;
+    typedef graph_traits<TGraph>::vertex_descriptor     TVertex;
+
+    // more than a tile of blocks, with cycles, self calls and vertices
+    // nobody calls
+    for (unsigned seed = 1; seed < 4; ++seed) {
+        const size_t nVert = 700 + 61 * seed;
+        TGraph graph(nVert);
+        for (TVertex v = 0; v < nVert; ++v) {
+            if (v % 5)
+                add_edge(v, (v * seed * 31 + 7) % nVert, graph);
+            if (!(v % 11))
+                add_edge(v, v, graph);
+            if (v % 300)
+                add_edge(v - 1, v, graph);
+        }
+
+        checkTransposed<BitmapIndexer<TGraph> >(graph);
+        checkTransposed<BitmapIndexer<TGraph, RoaringBitmap> >(graph);
+    }
+
+    TGraph empty(0);
+    checkTransposed<BitmapIndexer<TGraph> >(empty);
+}
+
 int main(int, char *[]) {
     checkStability();
     checkOnList();
+    checkComponents();
+    checkWideLevels();
+    checkRoaringStorage();
+    checkGraphHash();
+    checkTranspose();
 
     return 0;
 }
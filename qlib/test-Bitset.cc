@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "Bitset.hh"
+
+#undef NDEBUG
+#include <cassert>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/dynamic_bitset.hpp>
+
+typedef boost::dynamic_bitset<>                         TBitset;
+
+void checkSame(const Bitset &set, const TBitset &expected) {
+    assert(set.size() == expected.size());
+    assert(set.count() == expected.count());
+    assert(set.any() == expected.any());
+    assert(set.num_blocks() % BitsetImpl::BLOCK_WORDS == 0);
+    assert(!(reinterpret_cast<size_t>(set.data()) % BitsetImpl::ALIGN));
+
+    size_t pos = set.find_first();
+    size_t exp = expected.find_first();
+    for (; exp != TBitset::npos; exp = expected.find_next(exp)) {
+        assert(pos == exp);
+        assert(set[pos]);
+        pos = set.find_next(pos);
+    }
+    assert(pos == Bitset::npos);
+}
+
+void checkBitset() {
+    const size_t nBits[] = { 0, 1, 63, 64, 65, 511, 512, 513, 5000 };
+    for (unsigned k = 0; k < sizeof nBits / sizeof *nBits; ++k) {
+        const size_t n = nBits[k];
+        Bitset a(n), b(n, true);
+        TBitset ea(n), eb(n);
+        eb.set();
+        checkSame(a, ea);
+        checkSame(b, eb);
+
+        for (size_t i = 0; i < n; i += 3) {
+            a.set(i);
+            ea.set(i);
+        }
+        for (size_t i = 0; i < n; i += 7) {
+            b.reset(i);
+            eb.reset(i);
+        }
+        checkSame(a, ea);
+        checkSame(b, eb);
+
+        Bitset c(a);
+        assert(c == a);
+        c |= b;
+        checkSame(c, ea | eb);
+        c = a;
+        c &= b;
+        checkSame(c, ea & eb);
+        c = a;
+        c -= b;
+        checkSame(c, ea - eb);
+        assert((c != a) == ((ea - eb) != ea));
+
+        // words of another bitset of the same layout
+        c.assignAnd(a.data(), b.data(), n);
+        checkSame(c, ea & eb);
+        c.assign(b.data(), n);
+        assert(c == b);
+
+        // resizing keeps bits, new ones get the given value
+        TBitset ec(eb);
+        ec.resize(n + 70, true);
+        c.resize(n + 70, true);
+        checkSame(c, ec);
+        ec.resize(n / 2);
+        c.resize(n / 2);
+        checkSame(c, ec);
+
+        // constructed from words as RoaringBitmap::copyTo() does
+        std::vector<Bitset::block_type> words(a.data(),
+                                              a.data() + (n + 63) / 64);
+        Bitset d(words.begin(), words.end());
+        d.resize(n);
+        assert(d == a);
+
+        d.reset();
+        assert(d.none() && d.size() == n);
+        d.clear();
+        assert(!d.size());
+    }
+}
+
+/// all kernels give the same results as the portable ones
+void checkKernels() {
+    using namespace BitsetImpl;
+
+    const size_t n = 40 * BLOCK_WORDS;
+    Bitset a(n * WORD_BITS), b(n * WORD_BITS);
+    boost::uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < n; ++i) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        a.data()[i] = seed;
+        b.data()[i] = seed * 31 + (seed >> 5);
+    }
+
+    Bitset expected(a.size()), result(a.size());
+    const size_t cnt = countWordsPlain(a.data(), n);
+    assert(cnt == countWords(a.data(), n));
+
+#if BITSET_SIMD
+    const ESimd level = simd();
+    if (SIMD_AVX2 <= level) {
+        orWordsPlain(expected.data(), a.data(), b.data(), n);
+        orWordsAvx2(result.data(), a.data(), b.data(), n);
+        assert(result == expected);
+        andWordsPlain(expected.data(), a.data(), b.data(), n);
+        andWordsAvx2(result.data(), a.data(), b.data(), n);
+        assert(result == expected);
+        andNotWordsPlain(expected.data(), a.data(), b.data(), n);
+        andNotWordsAvx2(result.data(), a.data(), b.data(), n);
+        assert(result == expected);
+        assert(countWordsAvx2(a.data(), n) == cnt);
+    }
+    if (SIMD_AVX512 <= level) {
+        orWordsPlain(expected.data(), a.data(), b.data(), n);
+        orWordsAvx512(result.data(), a.data(), b.data(), n);
+        assert(result == expected);
+        andWordsPlain(expected.data(), a.data(), b.data(), n);
+        andWordsAvx512(result.data(), a.data(), b.data(), n);
+        assert(result == expected);
+        andNotWordsPlain(expected.data(), a.data(), b.data(), n);
+        andNotWordsAvx512(result.data(), a.data(), b.data(), n);
+        assert(result == expected);
+    }
+    if (SIMD_AVX512_POPCNT == level)
+        assert(countWordsAvx512(a.data(), n) == cnt);
+#endif
+
+    // in place, as the bitsets use them
+    orWordsPlain(expected.data(), a.data(), b.data(), n);
+    result = a;
+    orWords(result.data(), result.data(), b.data(), n);
+    assert(result == expected);
+}
+
+int main(int, char *[]) {
+    checkBitset();
+    checkKernels();
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "CallGraph.hh"
+
+#undef NDEBUG
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+/// count of allocations by operator new, see the replacement below
+static size_t nAllocs;
+
+void* operator new(size_t size) {
+    ++nAllocs;
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void checkReservedEdges() {
+    using namespace boost;
+    const size_t nVert = 1000;
+
+    CallGraph graph;
+    graph.resize(nVert);
+    for (size_t v = 0; v < nVert; ++v)
+        graph.reserveCalls(v, 1, 1);
+    graph.reserveEdges(nVert - 1);
+
+    // adding reserved edges allocates nothing
+    const size_t before = nAllocs;
+    for (size_t v = 0; v + 1 < nVert; ++v)
+        add_edge(v, v + 1, CallCount(1), graph);
+    assert(nAllocs == before);
+    assert(num_edges(graph) == nVert - 1);
+    assert(out_degree(0, graph) == 1);
+    assert(in_degree(nVert - 1, graph) == 1);
+}
+
+void checkMergerAllocs() {
+    using namespace boost;
+    const size_t nVert = 1000;
+    const size_t nCalls = 16;
+
+    // each vertex calls the next ones, nCalls times each
+    CallGraph graph;
+    graph.resize(nVert);
+    CallMerger<CallGraph> merger(graph);
+    for (size_t v = 0; v < nVert; ++v)
+        for (size_t i = 1; i <= nCalls; ++i)
+            merger.add(v, (v + i) % nVert);
+
+    // allocations per vertex (its edge lists), not per edge
+    const size_t before = nAllocs;
+    merger.flush(0);
+    assert(num_edges(graph) == nVert * nCalls);
+    assert(nAllocs - before <= 2 * nVert + 16);
+
+    // calls already in the graph are merged into their edges
+    merger.add(0, 1);
+    merger.flush(nVert);
+    assert(num_edges(graph) == nVert * nCalls);
+    assert(get(CallCountProp(), graph, *out_edges(0, graph).first).n == 2);
+}
+
+int main(int, char *[]) {
+    checkReservedEdges();
+    checkMergerAllocs();
+
+    return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "CallGraph.hh"
+#include "Cgt.hh"
+#include "Linker.hh"
+#include "VertexFilter.hh"
+
+#undef NDEBUG
+#include <cassert>
+#include <sstream>
+
+void checkIdTable() {
+    FncIdTable ids;
+    assert(ids.find(7) == FncIdTable::NOT_FOUND);
+    assert(ids.insert(7) == 0);
+    assert(ids.insert(3) == 1);
+    assert(ids.insert(7) == 0);
+
+    // sparse and negative IDs
+    assert(ids.insert(1L << 40) == 2);
+    assert(ids.insert(-5) == 3);
+    assert(ids.find(1L << 40) == 2);
+    assert(ids.find(-5) == 3);
+    assert(ids.find(4) == FncIdTable::NOT_FOUND);
+    assert(ids.size() == 4);
+
+    // IDs stored aside stay found once the vector grows over them
+    assert(ids.insert(3000) == 4);
+    for (TFncId id = 8; id <= 3001; ++id)
+        ids.insert(id);
+    assert(ids.find(3000) == 4);
+    assert(ids.size() == 4 + 2994);
+
+    ids.clear();
+    assert(ids.size() == 0);
+    assert(ids.find(7) == FncIdTable::NOT_FOUND);
+}
+
+void checkBuilder() {
+    using namespace boost;
+    typedef graph_traits<CallGraph>::vertex_descriptor  TVertex;
+
+    // callee 900 is referenced before (and without) its declaration
+    std::istringstream str(
+            "F a.c\n"
+            "1 (3) main 2 900\n"
+            "2 (10) foo 3\n"
+            "3 (20) @static bar\n"
+            "F b.c\n"
+            "4 (0) @decl baz\n");
+
+    CallGraph graph;
+    CgtGraphBuilder<CallGraph> builder(graph);
+    CgtReader reader(&builder);
+    assert(reader.read(str, false));
+    assert(num_vertices(graph) == 5);
+    assert(num_edges(graph) == 3);
+
+    FncMap prop = get(FncProp(), graph);
+    assert(get(prop, 0)->name() == "main");
+    assert(get(prop, 1)->name() == "foo");
+    assert(get(prop, 2)->name().empty());
+    assert(get(prop, 3)->name() == "bar");
+    assert(!get(prop, 3)->isGlobal());
+    assert(get(prop, 4)->name() == "baz");
+    assert(!get(prop, 4)->isDefined());
+    assert(out_degree(0, graph) == 2);
+    assert(in_degree(2, graph) == 1);
+    assert(target(*out_edges(1, graph).first, graph) == 3);
+
+    // IDs of another input are independent
+    std::istringstream other(
+            "F c.c\n"
+            "1 (1) qux 2\n"
+            "2 (2) @decl foo\n");
+    CgtReader(&builder).read(other, false);
+    assert(num_vertices(graph) == 7);
+    assert(num_edges(graph) == 4);
+    const TVertex qux = 5;
+    assert(get(prop, qux)->name() == "qux");
+    assert(target(*out_edges(qux, graph).first, graph) == 6);
+}
+
+void checkLinkerBuilder() {
+    using namespace boost;
+
+    std::istringstream a(
+            "F a.c\n"
+            "1 (3) main 2 3 900\n"
+            "2 (0) @decl foo\n"
+            "3 (20) @static bar\n"
+            "4 (0) @decl unused\n");
+    std::istringstream b(
+            "F b.c\n"
+            "1 (10) foo 2\n"
+            "2 (20) @static bar\n");
+
+    Linker<CallGraph> linker;
+    CgtLinkerBuilder<CallGraph> builder(linker);
+    CgtReader(&builder).read(a, false);
+    CgtReader(&builder).read(b, false);
+
+    // foo is linked with its definition, bar is static in both inputs,
+    // callee 900 is never declared
+    const CallGraph &graph = linker.output();
+    assert(num_vertices(graph) == 6);
+    assert(num_edges(graph) == 4);
+    FncMap prop = get(FncProp(), graph);
+    assert(get(prop, 1)->name() == "foo");
+    assert(get(prop, 1)->isDefined());
+    assert(get(prop, 1)->file() == "b.c");
+    assert(out_degree(0, graph) == 3);
+    assert(out_degree(1, graph) == 1);
+    assert(in_degree(1, graph) == 1);
+
+    // unused declarations are filtered afterwards
+    typedef VertexFilter<CallGraph, DropUnusedDeclarations> TFilter;
+    TFilter output(graph);
+    size_t cnt = 0;
+    graph_traits<TFilter>::vertex_iterator vi, vi_end;
+    for (tie(vi, vi_end) = vertices(output); vi != vi_end; ++vi, ++cnt)
+        assert(get(prop, *vi)->name() != "unused");
+    assert(cnt == 5);
+}
+
+void checkMergedCalls() {
+    using namespace boost;
+
+    // main calls foo three times, in two inputs
+    std::istringstream a(
+            "F a.c\n"
+            "1 (3) main 2 3 2 2\n"
+            "2 (0) @decl foo\n"
+            "3 (20) @static bar 3 3\n");
+    std::istringstream b(
+            "F a.c\n"
+            "1 (3) main 2\n"
+            "2 (10) foo\n");
+
+    CallGraph graph;
+    CgtGraphBuilder<CallGraph> builder(graph);
+    CgtReader(&builder).read(a, false);
+    assert(num_edges(graph) == 3);
+    graph_traits<CallGraph>::out_edge_iterator oi = out_edges(0, graph).first;
+    assert(target(*oi, graph) == 1);
+    assert(call_count(*oi, graph) == 3);
+    assert(target(*++oi, graph) == 2);
+    assert(call_count(*oi, graph) == 1);
+    oi = out_edges(2, graph).first;
+    assert(call_count(*oi, graph) == 2);
+
+    // counts are summed by the linker, also for calls of redefined symbols
+    Linker<CallGraph> linker;
+    CgtLinkerBuilder<CallGraph> linkerBuilder(linker);
+    std::istringstream a2(a.str());
+    CgtReader(&linkerBuilder).read(a2, false);
+    CgtReader(&linkerBuilder).read(b, false);
+    const CallGraph &out = linker.output();
+    assert(num_edges(out) == 3);
+    assert(out_degree(0, out) == 2);
+    assert(call_count(*out_edges(0, out).first, out) == 4);
+    assert(in_degree(1, out) == 1);
+
+    // graphs keeping call sites are not merged
+    CallSiteGraph sites;
+    CgtGraphBuilder<CallSiteGraph> siteBuilder(sites);
+    std::istringstream a3(a.str());
+    CgtReader(&siteBuilder).read(a3, false);
+    assert(num_edges(sites) == 6);
+}
+
+void checkWriter() {
+    // files are written sorted by name, functions in order of vertices
+    std::istringstream input(
+            "F b.c\n"
+            "5 (1) main 7 9 7\n"
+            "F a.c\n"
+            "7 (2) @static foo 9\n"
+            "F b.c\n"
+            "8 (3) bar\n"
+            "F c.h\n"
+            "9 (0) @decl baz\n");
+
+    CallGraph graph;
+    CgtGraphBuilder<CallGraph> builder(graph);
+    CgtReader(&builder).read(input, false);
+
+    std::ostringstream output;
+    {
+        CgtWriter writer(output);
+        write(graph, writer);
+    }
+    assert(output.str() ==
+            "F a.c\n"
+            "1 (2) @static foo 2\n"
+            "F b.c\n"
+            "3 (1) main 1 1 2\n"
+            "4 (3) bar\n"
+            "F c.h\n"
+            "2 (0) @decl baz\n");
+}
+
+int main(int, char *[]) {
+    checkIdTable();
+    checkMergedCalls();
+    checkWriter();
+    checkBuilder();
+    checkLinkerBuilder();
+
+    return 0;
+}
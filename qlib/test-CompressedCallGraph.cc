@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "config.hh"
+#include "BitmapIndex.hh"
+#include "CallGraph.hh"
+#include "CompressedCallGraph.hh"
+#include "CsrCallGraph.hh"
+#include "PathFinder.hh"
+#include "VertexOrder.hh"
+#include "test-lib.hh"
+
+#undef NDEBUG
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+#include <boost/graph/adjacency_list.hpp>
+
+typedef std::vector<size_t> TList;
+
+void buildCallGraph(CallGraph &graph, size_t nVert) {
+    using namespace boost;
+    for (size_t i = 0; i < nVert; ++i) {
+        Fnc fnc;
+        std::ostringstream name;
+        name << "f" << i;
+        fnc.name = name.str();
+        fnc.loc.file = (i % 3) ? "a.c" : "b.c";
+        fnc.loc.lineno = i;
+        fnc.isDefined = true;
+        add_vertex(fnc, graph);
+    }
+}
+
+/// tree with back edges, shared callees and one hub called by everything
+void buildTestGraph(CallGraph &graph) {
+    using namespace boost;
+    typedef graph_traits<SimpleTestGraph>               Traits;
+
+    SimpleTestGraph shape(600, 280);
+    buildCallGraph(graph, num_vertices(shape));
+    Traits::edge_iterator ei, ei_end;
+    for (tie(ei, ei_end) = edges(shape); ei != ei_end; ++ei)
+        add_edge(source(*ei, shape), target(*ei, shape), graph);
+
+    // neighbors of similar lists, good candidates for reference lists
+    srand(7);
+    const size_t nVert = num_vertices(graph);
+    for (size_t v = 0; v < nVert; ++v) {
+        const size_t base = rand() % nVert;
+        for (size_t i = 0; i < 8; ++i)
+            if (rand() % 4)
+                add_edge(v, (base + 3 * i + (v & 1)) % nVert, graph);
+        add_edge(v, 5, graph);
+    }
+
+    // long lists and far neighbors
+    for (size_t v = 0; v < nVert; v += 3)
+        add_edge(nVert - 1, v, graph);
+}
+
+template <typename TGraph>
+TList outList(const TGraph &graph, size_t v) {
+    TList list;
+    typename boost::graph_traits<TGraph>::out_edge_iterator ei, ei_end;
+    for (tie(ei, ei_end) = out_edges(v, graph); ei != ei_end; ++ei) {
+        assert(source(*ei, graph) == v);
+        list.push_back(target(*ei, graph));
+    }
+    return list;
+}
+
+template <typename TGraph>
+TList inList(const TGraph &graph, size_t v) {
+    TList list;
+    typename boost::graph_traits<TGraph>::in_edge_iterator ei, ei_end;
+    for (tie(ei, ei_end) = in_edges(v, graph); ei != ei_end; ++ei) {
+        assert(target(*ei, graph) == v);
+        list.push_back(source(*ei, graph));
+    }
+    return list;
+}
+
+void checkVarint() {
+    using namespace CompressedImpl;
+    const TWord values[] = { 0, 1, 127, 128, 300, 16383, 16384, 1ULL << 35 };
+    TBytes data;
+    for (size_t i = 0; i < sizeof(values)/sizeof(values[0]); ++i)
+        putVarint(data, values[i]);
+
+    const unsigned char *p = &data[0];
+    for (size_t i = 0; i < sizeof(values)/sizeof(values[0]); ++i)
+        assert(getVarint(p) == values[i]);
+    assert(p == &data[0] + data.size());
+
+    assert(unzigzag(zigzag(3, 10), 10) == 3);
+    assert(unzigzag(zigzag(10, 3), 3) == 10);
+    assert(unzigzag(zigzag(0, 0xFFFFFFFF), 0xFFFFFFFF) == 0);
+    assert(zigzag(9, 10) == 1);
+}
+
+void checkGraph(const CsrCallGraph &csr, unsigned refWindow) {
+    using namespace boost;
+    typedef graph_traits<CompressedCallGraph>           Traits;
+    typedef Traits::vertex_descriptor                   TVertex;
+
+    CompressedCallGraph graph(csr, refWindow);
+    const size_t nVert = num_vertices(graph);
+    assert(nVert == num_vertices(csr));
+    assert(num_edges(graph) == num_edges(csr));
+    if (refWindow)
+        assert(graph.outLists().numReferences());
+    else
+        assert(!graph.outLists().numReferences());
+
+    // the same adjacency, out edges are sorted by target
+    for (TVertex v = 0; v < nVert; ++v) {
+        assert(out_degree(v, graph) == out_degree(v, csr));
+        assert(in_degree(v, graph) == in_degree(v, csr));
+
+        TList expected = outList(csr, v);
+        std::sort(expected.begin(), expected.end());
+        assert(outList(graph, v) == expected);
+
+        expected = inList(csr, v);
+        std::sort(expected.begin(), expected.end());
+        assert(inList(graph, v) == expected);
+
+        assert(get(get(FncProp(), graph), v)->name()
+                == get(get(FncProp(), csr), v)->name());
+        assert(graph.origIndex(v) == csr.origIndex(v));
+    }
+
+    // edge list visits each edge once
+    size_t cnt = 0;
+    Traits::edge_iterator ei, ei_end;
+    for (tie(ei, ei_end) = edges(graph); ei != ei_end; ++ei, ++cnt)
+        assert(source(*ei, graph) < nVert && target(*ei, graph) < nVert);
+    assert(cnt == num_edges(graph));
+
+    // reachability is kept
+    BitmapIndexer<CsrCallGraph> csrIndexer(csr);
+    BitmapIndexer<CompressedCallGraph> indexer(graph);
+    for (TVertex v = 0; v < nVert; v += 7) {
+        assert(indexer.index(v, indexer.IN)
+                == csrIndexer.index(v, csrIndexer.IN));
+        assert(indexer.index(v, indexer.OUT)
+                == csrIndexer.index(v, csrIndexer.OUT));
+    }
+}
+
+void checkPaths(unsigned refWindow) {
+    using namespace boost;
+    typedef graph_traits<SimpleTestGraph>               Traits;
+    typedef PathFinder<CsrCallGraph, UniqEdgePath>      TCsrFinder;
+    typedef PathFinder<CompressedCallGraph, UniqEdgePath> TFinder;
+
+    SimpleTestGraph shape(15, 7);
+    CallGraph orig;
+    buildCallGraph(orig, num_vertices(shape));
+    Traits::edge_iterator ei, ei_end;
+    for (tie(ei, ei_end) = edges(shape); ei != ei_end; ++ei)
+        add_edge(source(*ei, shape), target(*ei, shape), orig);
+
+    CsrCallGraph csr(orig);
+    CompressedCallGraph graph(csr, refWindow);
+    const size_t nVert = num_vertices(graph);
+    for (size_t src = 0; src < nVert; ++src) {
+        TCsrFinder csrFinder(csr);
+        TFinder finder(graph);
+        csrFinder.compute(src);
+        finder.compute(src);
+        for (size_t dst = 0; dst < nVert; ++dst) {
+            TCsrFinder::TPathList csrList;
+            TFinder::TPathList list;
+            csrFinder.paths(dst, csrList);
+            finder.paths(dst, list);
+            assert(list.size() == csrList.size());
+        }
+    }
+}
+
+int main(int, char *[]) {
+    checkVarint();
+
+    CallGraph orig;
+    buildTestGraph(orig);
+    CsrCallGraph csr(orig);
+
+    // plain lists and lists with references
+    checkGraph(csr, 0);
+    checkGraph(csr, 3);
+    checkGraph(csr, 7);
+    checkPaths(0);
+    checkPaths(7);
+
+    // renumbered graph keeps the input numbering
+    csr.renumber(vertexOrder(csr, VO_BFS));
+    checkGraph(csr, 7);
+
+    // empty graph
+    CompressedCallGraph empty((CallGraph()));
+    assert(!num_vertices(empty) && !num_edges(empty));
+    assert(edges(empty).first == edges(empty).second);
+
+    return 0;
+}
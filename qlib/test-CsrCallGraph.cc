@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "BitmapIndex.hh"
+#include "CallGraph.hh"
+#include "CsrCallGraph.hh"
+#include "PathFinder.hh"
+#include "VertexFilter.hh"
+#include "VertexOrder.hh"
+#include "test-lib.hh"
+
+#undef NDEBUG
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/graph/adjacency_list.hpp>
+
+/// writer recording everything as text, for comparison of write() output
+class TextWriter {
+    public:
+        void writeFile(std::string file)    { str_ << "F " << file << "\n"; }
+        void writeFnc(size_t, PFnc fnc)     { str_ << fnc << " ->"; }
+        void writeCall(size_t, PFnc fnc)    { str_ << " " << fnc->name(); }
+        void writeFncEnd()                  { str_ << "\n"; }
+        std::string text() const            { return str_.str(); }
+    private:
+        std::ostringstream str_;
+};
+
+/// predicate keeping vertices of odd index only
+template <typename TGraph>
+class OddVertices {
+    public:
+        OddVertices() { }
+        OddVertices(const TGraph &) { }
+        bool operator()(size_t v) const { return v & 1; }
+};
+
+void buildCallGraph(CallGraph &graph) {
+    using namespace boost;
+    typedef graph_traits<SimpleTestGraph>               Traits;
+
+    SimpleTestGraph shape(15, 7);
+    for (size_t i = 0; i < num_vertices(shape); ++i) {
+        Fnc fnc;
+        std::ostringstream name;
+        name << "f" << i;
+        fnc.name = name.str();
+        fnc.loc.file = (i % 3) ? "a.c" : "b.c";
+        fnc.loc.lineno = i;
+        fnc.isGlobal = i & 1;
+        fnc.isDefined = true;
+        add_vertex(fnc, graph);
+    }
+
+    Traits::edge_iterator ei, ei_end;
+    for (tie(ei, ei_end) = edges(shape); ei != ei_end; ++ei)
+        add_edge(source(*ei, shape), target(*ei, shape), graph);
+}
+
+typedef CsrCallGraph::TIdxList                           TIdxList;
+
+/// arrays of CsrCallGraph in the order they are saved to an image
+enum EArray {
+    OUT_OFFSETS, TARGETS, IN_OFFSETS, SOURCES, IN_EDGES, ORIG_INDEX, N_ARRAYS
+};
+
+void graphArrays(const CsrCallGraph &graph, TIdxList arrays[N_ARRAYS]) {
+    const size_t nVert = graph.numVertices();
+    for (size_t v = 0; v <= nVert; ++v) {
+        arrays[OUT_OFFSETS].push_back((v < nVert)
+                ? graph.outRange(v).first : graph.numEdges());
+        arrays[IN_OFFSETS].push_back((v < nVert)
+                ? graph.inRange(v).first : graph.numEdges());
+    }
+    for (CsrCallGraph::TIdx i = 0; i < graph.numEdges(); ++i) {
+        const CsrEdge in = graph.inEdgeAt(i);
+        arrays[TARGETS].push_back(graph.targetAt(i));
+        arrays[SOURCES].push_back(in.src);
+        arrays[IN_EDGES].push_back(in.idx);
+    }
+}
+
+/// @return Return true if an image of the arrays and functions of the graph
+/// is loaded
+bool loadArrays(const CsrCallGraph &graph, const TIdxList arrays[N_ARRAYS]) {
+    std::ostringstream str;
+    {
+        ImageWriter img(str);
+        for (int i = 0; i < N_ARRAYS; ++i)
+            img.putVector(arrays[i]);
+        graph.fncTable().save(img);
+        assert(img.good());
+    }
+    const ImageBuffer image(str);
+    ImageReader img(image.reader());
+    CsrCallGraph loaded;
+    return loaded.load(img);
+}
+
+void checkDamagedImages(const CsrCallGraph &graph) {
+    TIdxList valid[N_ARRAYS];
+    graphArrays(graph, valid);
+    assert(loadArrays(graph, valid));
+
+    const size_t nVert = graph.numVertices();
+    const size_t nEdges = graph.numEdges();
+    assert(2 < nVert && 2 < nEdges);
+    for (int i = 0; i < 8; ++i) {
+        TIdxList damaged[N_ARRAYS];
+        std::copy(valid, valid + N_ARRAYS, damaged);
+        switch (i) {
+            case 0: damaged[TARGETS][nEdges / 2] = nVert;               break;
+            case 1: damaged[SOURCES][nEdges / 2] = nVert + 7;           break;
+            case 2: std::swap(damaged[OUT_OFFSETS][1],
+                              damaged[OUT_OFFSETS][nVert - 1]);         break;
+            case 3: ++damaged[IN_OFFSETS][nVert];                       break;
+            case 4: damaged[IN_EDGES].pop_back();                       break;
+            case 5: damaged[IN_EDGES][0] = nEdges;                      break;
+            case 6: damaged[IN_OFFSETS][nVert / 2] = nEdges + 1;        break;
+            case 7: damaged[ORIG_INDEX].push_back(0);                   break;
+        }
+        assert(!loadArrays(graph, damaged));
+    }
+}
+
+template <typename TGraph>
+std::string dump(const TGraph &graph) {
+    TextWriter writer;
+    write(graph, writer);
+    return writer.text();
+}
+
+int main(int, char *[]) {
+    using namespace boost;
+    typedef graph_traits<CsrCallGraph>                  Traits;
+    typedef Traits::vertex_descriptor                   TVertex;
+
+    CallGraph orig;
+    buildCallGraph(orig);
+    CsrCallGraph graph(orig);
+    const size_t nVert = num_vertices(graph);
+    assert(nVert == num_vertices(orig));
+    assert(num_edges(graph) == num_edges(orig));
+
+    // the same adjacency in both directions
+    for (TVertex v = 0; v < nVert; ++v) {
+        assert(out_degree(v, graph) == out_degree(v, orig));
+        assert(in_degree(v, graph) == in_degree(v, orig));
+
+        CallGraph::out_edge_iterator oi = out_edges(v, orig).first;
+        Traits::out_edge_iterator ei, ei_end;
+        for (tie(ei, ei_end) = out_edges(v, graph); ei != ei_end; ++ei, ++oi) {
+            assert(source(*ei, graph) == v);
+            assert(target(*ei, graph) == target(*oi, orig));
+        }
+
+        Traits::in_edge_iterator ii, ii_end;
+        for (tie(ii, ii_end) = in_edges(v, graph); ii != ii_end; ++ii) {
+            // in edge is the same edge as the corresponding out edge
+            assert(target(*ii, graph) == v);
+            const TVertex src = source(*ii, graph);
+            bool found = false;
+            for (tie(ei, ei_end) = out_edges(src, graph); ei != ei_end; ++ei)
+                found |= (*ei == *ii);
+            assert(found);
+        }
+    }
+
+    // edge list visits each edge once
+    size_t cnt = 0;
+    Traits::edge_iterator ei, ei_end;
+    for (tie(ei, ei_end) = edges(graph); ei != ei_end; ++ei, ++cnt)
+        assert(source(*ei, graph) < target(*ei, graph) || 7 < source(*ei, graph));
+    assert(cnt == num_edges(graph));
+
+    // function data and write() output are kept
+    assert(dump(graph) == dump(orig));
+
+    // damaged session images are refused
+    checkDamagedImages(graph);
+
+    // reachability is kept
+    BitmapIndexer<CallGraph> origIndexer(orig);
+    BitmapIndexer<CsrCallGraph> indexer(graph);
+    origIndexer.build();
+    indexer.build();
+    for (TVertex v = 0; v < nVert; ++v) {
+        assert(indexer.index(v, indexer.IN)
+                == origIndexer.index(v, origIndexer.IN));
+        assert(indexer.index(v, indexer.OUT)
+                == origIndexer.index(v, origIndexer.OUT));
+    }
+
+    // paths are kept
+    for (TVertex src = 0; src < nVert; ++src) {
+        PathFinder<CallGraph, UniqEdgePath> origFinder(orig);
+        PathFinder<CsrCallGraph, UniqEdgePath> finder(graph);
+        origFinder.compute(src);
+        finder.compute(src);
+        for (TVertex dst = 0; dst < nVert; ++dst) {
+            PathFinder<CallGraph, UniqEdgePath>::TPathList origList;
+            PathFinder<CsrCallGraph, UniqEdgePath>::TPathList list;
+            origFinder.paths(dst, origList);
+            finder.paths(dst, list);
+            assert(list.size() == origList.size());
+        }
+
+        BitmapFilter<CsrCallGraph> filter(indexer, src, nVert - 1);
+        PathFinder<BitmapFilter<CsrCallGraph>, UniqVertexPath> fFinder(filter);
+        fFinder.compute(src);
+    }
+
+    // build from filtered graph, vertices are renumbered
+    VertexFilter<CallGraph, OddVertices> odd(orig);
+    CsrCallGraph packed(odd);
+    assert(num_vertices(packed) == nVert / 2);
+    for (TVertex v = 0; v < num_vertices(packed); ++v) {
+        PFnc fnc = get(get(FncProp(), packed), v);
+        assert(fnc->line() == long(2 * v + 1));
+    }
+    assert(dump(packed) == dump(odd));
+
+    // filters work on top of the frozen graph
+    VertexFilter<CsrCallGraph, OddVertices> oddCsr(graph);
+    assert(dump(oddCsr) == dump(odd));
+
+    // renumbering keeps the graph, reachability and the input order
+    const EVertexOrder orders[] = { VO_INPUT, VO_BFS, VO_RCM, VO_TOPO };
+    for (size_t i = 0; i < sizeof(orders)/sizeof(orders[0]); ++i) {
+        CsrCallGraph renumbered(orig);
+        const TVertexOrder order = vertexOrder(renumbered, orders[i]);
+        renumbered.renumber(order);
+
+        BitmapIndexer<CsrCallGraph> rIndexer(renumbered);
+        for (TVertex v = 0; v < nVert; ++v) {
+            const TVertex rv = order[v];
+            assert(renumbered.origIndex(rv) == v);
+            assert(get(get(FncProp(), renumbered), rv)->line() == long(v));
+            assert(out_degree(rv, renumbered) == out_degree(v, graph));
+            assert(in_degree(rv, renumbered) == in_degree(v, graph));
+
+            Traits::out_edge_iterator oi, oi_end;
+            Traits::out_edge_iterator ri = out_edges(rv, renumbered).first;
+            for (tie(oi, oi_end) = out_edges(v, graph); oi != oi_end; ++oi, ++ri) {
+                const TVertex dst = target(*oi, graph);
+                assert(target(*ri, renumbered) == order[dst]);
+
+                // callees come later unless they are in the same recursion
+                if (VO_TOPO == orders[i])
+                    assert(rv < order[dst]
+                            || origIndexer.index(dst, origIndexer.OUT)[v]);
+            }
+
+            for (TVertex w = 0; w < nVert; ++w)
+                assert(rIndexer.index(rv, rIndexer.OUT)[order[w]]
+                        == origIndexer.index(v, origIndexer.OUT)[w]);
+        }
+
+        // renumbering again still refers to the input
+        renumbered.renumber(vertexOrder(renumbered, VO_BFS));
+        for (TVertex v = 0; v < nVert; ++v) {
+            PFnc fnc = get(get(FncProp(), renumbered), v);
+            assert(fnc->line() == long(renumbered.origIndex(v)));
+        }
+        assert(dump(renumbered) != std::string());
+    }
+
+    return 0;
+}
@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "CallGraph.hh"
+#include "FncTable.hh"
+#include "StringTable.hh"
+#include "test-lib.hh"
+
+#undef NDEBUG
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+void checkStringTable() {
+    StringTable table;
+    assert(table.size() == 0);
+    assert(table.find("main") == StringTable::NOT_FOUND);
+
+    // enough strings to trigger several rehashes
+    const unsigned N = 1000;
+    for (unsigned i = 0; i < N; ++i) {
+        std::ostringstream str;
+        str << "fnc_" << i;
+        assert(table.intern(str.str()) == i);
+    }
+    assert(table.intern(std::string()) == N);
+    assert(table.size() == N + 1);
+
+    for (unsigned i = 0; i < N; ++i) {
+        std::ostringstream str;
+        str << "fnc_" << i;
+        const std::string name(str.str());
+        assert(table.intern(name) == i);
+        assert(table.find(name) == i);
+        assert(name == table[i]);
+        assert(table.length(i) == name.size());
+    }
+    assert(table.size() == N + 1);
+    assert(0 == std::strcmp(table[N], ""));
+
+    // copies are independent
+    StringTable copy(table);
+    assert(copy.intern("new one") == N + 1);
+    assert(table.find("new one") == StringTable::NOT_FOUND);
+    assert(copy.find("fnc_7") == 7);
+}
+
+void checkCallGraph() {
+    using namespace boost;
+
+    CallGraph graph;
+    Fnc fnc;
+    fnc.name = "main";
+    fnc.loc.file = "main.c";
+    fnc.loc.lineno = 7;
+    fnc.isGlobal = true;
+    fnc.isDefined = true;
+    CallGraph::vertex_descriptor a = add_vertex(fnc, graph);
+
+    fnc.name = "helper";
+    fnc.loc.lineno = 42;
+    fnc.isGlobal = false;
+    fnc.isDefined = false;
+    CallGraph::vertex_descriptor b = add_vertex(fnc, graph);
+    add_edge(a, b, graph);
+
+    FncMap prop = get(FncProp(), graph);
+    PFnc pa = get(prop, a);
+    PFnc pb = get(prop, b);
+    assert(pa->name() == "main");
+    assert(pa->file() == "main.c");
+    assert(pa->line() == 7);
+    assert(pa->isGlobal() && pa->isDefined());
+    assert(pb->name() == "helper");
+    assert(!pb->isGlobal() && !pb->isDefined());
+    assert(!pa->sameLocation(*pb));
+
+    // file names are interned
+    assert(graph.fncTable().fileId(a) == graph.fncTable().fileId(b));
+
+    // copy data between graphs
+    CallGraph other;
+    CallGraph::vertex_descriptor c = add_vertex(pb, other);
+    PFnc pc = get(get(FncProp(), other), c);
+    assert(pc->name() == "helper");
+    assert(pc->line() == 42);
+    assert(pc->sameLocation(*pb));
+
+    // rewrite properties in place
+    put(prop, b, pa);
+    assert(get(prop, b)->name() == "main");
+    assert(get(prop, b)->isDefined());
+    assert(graph.fncTable().nameId(a) == graph.fncTable().nameId(b));
+
+    std::ostringstream str;
+    str << get(prop, b);
+    assert(str.str() == "main (main.c:7)");
+}
+
+void checkCallSites() {
+    using namespace boost;
+
+    CallSiteGraph graph;
+    Fnc fnc;
+    fnc.name = "main";
+    fnc.loc.file = "main.c";
+    CallSiteGraph::vertex_descriptor a = add_vertex(fnc, graph);
+    fnc.name = "helper";
+    CallSiteGraph::vertex_descriptor b = add_vertex(fnc, graph);
+
+    const size_t files = graph.fncTable().files().size();
+    Location site;
+    site.file = "main.c";
+    site.lineno = 12;
+    CallSiteGraph::edge_descriptor e1 = add_call(a, b, site, graph);
+    CallSiteGraph::edge_descriptor e2 = add_call(a, b, site, graph);
+    site.lineno = 13;
+    CallSiteGraph::edge_descriptor e3 = add_call(a, b, site, graph);
+    CallSiteGraph::edge_descriptor e4 = add_edge(b, a, graph).first;
+
+    // call sites are interned
+    assert(get(CallProp(), graph, e1) == get(CallProp(), graph, e2));
+    assert(get(CallProp(), graph, e1) != get(CallProp(), graph, e3));
+    assert(call_site(e3, graph) == site);
+    assert(get(CallProp(), graph, e4) == NO_CALL_SITE);
+    assert(call_site(e4, graph).lineno == -1);
+
+    // file names are shared with functions
+    assert(graph.fncTable().files().size() == files);
+
+    // intern call site taken from another graph
+    CallSiteGraph other;
+    TCallSite s = other.fncTable().internCallSite(graph.fncTable(),
+                                                  get(CallProp(), graph, e3));
+    assert(other.fncTable().callSite(s) == site);
+}
+
+void checkDemangle() {
+    FncTable table;
+    Fnc fnc;
+    fnc.name = "_ZN2ns3runEv";
+    table.set(0, fnc);
+    fnc.name = "main";
+    table.set(1, fnc);
+    fnc.name = "_ZN2ns4stopEi";
+    table.set(2, fnc);
+
+    // names are kept as read, demangled on demand
+    assert(table.name(0) == "_ZN2ns3runEv");
+    assert(table.prettyName(0) == "ns::run()");
+    assert(table.prettyName(0) == "ns::run()");
+    assert(table.prettyName(1) == "main");
+    assert(demangledName("main").empty());
+
+    // copies do not share the cache, names are demangled again there
+    const FncTable copy(table);
+    assert(copy.prettyName(2) == "ns::stop(int)");
+
+    // bulk mode on more threads than names
+    Demangler demangler;
+    demangler.demangleAll(table.names(), 8);
+    assert(demangler.size() == table.names().size());
+    for (size_t i = 0; i < table.size(); ++i)
+        assert(demangler.name(table.names(), table.nameId(i))
+                == table.prettyName(i));
+
+    demangler.clear();
+    assert(demangler.size() == 0);
+}
+
+typedef std::vector<boost::uint32_t>                    TWords;
+
+/// @return Return true if an image of the arrays of a StringTable is loaded
+bool loadStringTable(const std::string &data, const TWords &offsets,
+                     const TWords &slots)
+{
+    std::ostringstream str;
+    {
+        ImageWriter img(str);
+        img.putArray(data.data(), data.size());
+        img.putVector(offsets);
+        img.putVector(slots);
+        assert(img.good());
+    }
+
+    const ImageBuffer image(str);
+    ImageReader img(image.reader());
+    StringTable table;
+    return table.load(img);
+}
+
+void checkDamagedStringTables() {
+    StringTable table;
+    table.intern("a");
+    table.intern("bc");
+    std::ostringstream str;
+    {
+        ImageWriter img(str);
+        table.save(img);
+    }
+    const ImageBuffer image(str);
+    ImageReader img(image.reader());
+    StringTable loaded;
+    assert(loaded.load(img));
+    assert(loaded.find("bc") == 1);
+
+    // strings "a" and "bc" with a free slot
+    const StringTable::TId F = StringTable::NOT_FOUND;
+    const std::string data("a\0bc\0", 5);
+    const boost::uint32_t offsets[] = { 0, 2, 5 };
+    const boost::uint32_t slots[] = { F, 0, F, 1, F, F, F, F };
+    const TWords validOffsets(offsets, offsets + 3);
+    const TWords validSlots(slots, slots + 8);
+    assert(loadStringTable(data, validOffsets, validSlots));
+
+    for (int i = 0; i < 6; ++i) {
+        std::string d(data);
+        TWords o(validOffsets);
+        TWords s(validSlots);
+        switch (i) {
+            case 0: o[0] = 1;                                           break;
+            case 1: o[1] = 5;                                           break;
+            case 2: o[2] = 4;                                           break;
+            case 3: d[4] = 'x';                                         break;
+            case 4: s[1] = 2;                                           break;
+            case 5: std::replace(s.begin(), s.end(), F, 0U);            break;
+        }
+        assert(!loadStringTable(d, o, s));
+    }
+}
+
+void checkDamagedFncTables() {
+    typedef std::pair<boost::uint32_t, boost::int32_t> TSite;
+    StringTable names;
+    names.intern("main");
+    StringTable files;
+    files.intern("main.c");
+
+    for (int i = 0; i < 4; ++i) {
+        TWords name(1, 0);
+        TWords file(1, 0);
+        std::vector<boost::int32_t> line(1, 7);
+        std::vector<unsigned char> flags(1, FncTable::F_DEFINED);
+        std::vector<TSite> sites(1, TSite(0, 3));
+        switch (i) {
+            case 1: name[0] = names.size();                             break;
+            case 2: file[0] = files.size();                             break;
+            case 3: sites[0].first = files.size();                      break;
+        }
+
+        std::ostringstream str;
+        {
+            ImageWriter img(str);
+            names.save(img);
+            files.save(img);
+            img.putVector(name);
+            img.putVector(file);
+            img.putVector(line);
+            img.putVector(flags);
+            img.putVector(sites);
+        }
+
+        // only the intact table (case 0) is loaded
+        const ImageBuffer image(str);
+        ImageReader img(image.reader());
+        FncTable table;
+        assert(table.load(img) == !i);
+        if (!i)
+            assert(table.name(0) == "main" && table.callSite(1).lineno == 3);
+        else
+            assert(!table.size());
+    }
+}
+
+int main(int, char *[]) {
+    checkStringTable();
+    checkCallGraph();
+    checkCallSites();
+    checkDemangle();
+    checkDamagedStringTables();
+    checkDamagedFncTables();
+
+    return 0;
+}
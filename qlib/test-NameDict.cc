@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "NameDict.hh"
+
+#undef NDEBUG
+#include <cassert>
+#include <cstdlib>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef std::vector<std::string> TNameList;
+
+void generateNames(TNameList &names) {
+    static const char *scopes[] = { "_ZN3foo", "_ZN3bar", "_ZN3foo3baz", "" };
+    static const char *ids[] = { "init", "run", "run2", "stop", "x", "" };
+
+    srand(42);
+    for (unsigned i = 0; i < 2000; ++i) {
+        std::ostringstream str;
+        str << scopes[rand() % 4] << ids[rand() % 6] << (rand() % 300);
+        names.push_back(str.str());
+    }
+    names.push_back("");
+    names.push_back("\xff");
+    names.push_back("\xff\xff" "a");
+}
+
+void checkDict(const NameDict &dict, const TNameList &sorted) {
+    assert(dict.size() == sorted.size());
+
+    // every name is found at its position
+    for (NameDict::TId id = 0; id < sorted.size(); ++id) {
+        assert(dict[id] == sorted[id]);
+        assert(dict.find(sorted[id]) == id);
+    }
+
+    // names which are not there
+    assert(dict.find("_ZN3foo") == NameDict::NOT_FOUND);
+    assert(dict.find("zzz") == NameDict::NOT_FOUND);
+    assert(dict.lowerBound("\xff\xff\xff") == sorted.size());
+
+    // prefix ranges
+    static const char *prefixes[] = {
+        "", "_ZN3foo", "_ZN3foo3baz", "run2", "x1", "nothing", "\xff"
+    };
+    for (unsigned i = 0; i < sizeof prefixes/sizeof *prefixes; ++i) {
+        const std::string prefix(prefixes[i]);
+        NameDict::TRange range = dict.prefixRange(prefix);
+        assert(range.first <= range.second);
+        for (NameDict::TId id = 0; id < sorted.size(); ++id) {
+            bool match = 0 == sorted[id].compare(0, prefix.size(), prefix);
+            assert(match == (range.first <= id && id < range.second));
+        }
+    }
+}
+
+int main(int, char *[]) {
+    TNameList names;
+    generateNames(names);
+
+    NameDict dict;
+    assert(dict.size() == 0);
+    assert(dict.find("main") == NameDict::NOT_FOUND);
+
+    TNameList input(names);
+    dict.build(input);
+
+    TNameList sorted(names);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    checkDict(dict, sorted);
+
+    return 0;
+}
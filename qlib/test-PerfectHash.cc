@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "PerfectHash.hh"
+
+#undef NDEBUG
+#include <cassert>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef std::vector<boost::uint32_t>                    TOffsets;
+
+void addKey(std::vector<char> &data, TOffsets &offsets, const std::string &key)
+{
+    data.insert(data.end(), key.begin(), key.end());
+    data.push_back('\0');
+    offsets.push_back(data.size());
+}
+
+void checkHash(const PerfectHash &hash, const std::vector<char> &data,
+               const TOffsets &offsets)
+{
+    // each key has its own position
+    const size_t n = offsets.size() - 1;
+    assert(hash.size() == n);
+    std::vector<bool> seen(n, false);
+    for (size_t i = 0; i < n; ++i) {
+        const size_t pos = hash(&data[offsets[i]],
+                                offsets[i + 1] - offsets[i] - 1);
+        assert(pos < n);
+        assert(!seen[pos]);
+        seen[pos] = true;
+    }
+}
+
+void checkSmall() {
+    PerfectHash empty;
+    assert(!empty.size());
+    assert(!empty("main"));
+
+    std::vector<char> data;
+    TOffsets offsets(1, 0);
+    addKey(data, offsets, "main");
+    addKey(data, offsets, "");
+    addKey(data, offsets, "_ZN2ns3runEv");
+
+    PerfectHash hash;
+    hash.build(&data[0], &offsets[0], 3);
+    checkHash(hash, data, offsets);
+
+    // other strings hash somewhere in the range
+    assert(hash("nothing") < 3);
+    assert(hash(std::string("main")) == hash("main", 4));
+}
+
+void checkLarge() {
+    // names of similar shape, including ones longer than a hashed word
+    std::vector<char> data;
+    TOffsets offsets(1, 0);
+    for (int i = 0; i < 50000; ++i) {
+        char buf[64];
+        std::sprintf(buf, (i & 1) ? "fnc%d" : "_ZN4core6Widget%dEv", i);
+        addKey(data, offsets, buf);
+    }
+
+    PerfectHash hash;
+    hash.build(&data[0], &offsets[0], offsets.size() - 1);
+    checkHash(hash, data, offsets);
+
+    // about one 32-bit seed per four keys
+    assert(hash.memoryUsage() < sizeof hash + 50000 / 4 * 4 + 64);
+
+    // the image keeps the same positions
+    std::ostringstream str;
+    {
+        ImageWriter img(str);
+        hash.save(img);
+    }
+    const std::string buf(str.str());
+    ImageReader img(buf.data(), buf.size());
+    PerfectHash loaded;
+    assert(loaded.load(img));
+    assert(loaded.memoryUsage() < hash.memoryUsage());
+    for (size_t i = 0; i + 1 < offsets.size(); i += 97) {
+        const char *key = &data[offsets[i]];
+        const size_t len = offsets[i + 1] - offsets[i] - 1;
+        assert(loaded(key, len) == hash(key, len));
+    }
+
+    // truncated image
+    ImageReader cut(buf.data(), buf.size() - 64);
+    assert(!loaded.load(cut));
+    assert(!loaded.size());
+}
+
+int main(int, char *[]) {
+    checkSmall();
+    checkLarge();
+
+    return 0;
+}
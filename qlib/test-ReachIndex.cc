@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "BitmapIndex.hh"
+#include "ReachIndex.hh"
+
+#undef NDEBUG
+#include <cassert>
+#include <vector>
+
+#include <boost/graph/adjacency_list.hpp>
+
+typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::bidirectionalS>
+                                                        TGraph;
+typedef boost::graph_traits<TGraph>::vertex_descriptor  TVertex;
+typedef BitmapIndexer<TGraph>                           TBitmapIndexer;
+typedef ReachIndexer<TGraph>                            TIndexer;
+
+/// compare all queries with bitmap indexes
+void checkGraph(const TGraph &graph, unsigned nLabels) {
+    const size_t nVert = num_vertices(graph);
+    TBitmapIndexer bitmaps(graph);
+    bitmaps.build();
+    TIndexer indexer(graph, nLabels);
+
+    for (TVertex u = 0; u < nVert; ++u) {
+        TBitmapIndex out, in;
+        copyIndex(out, bitmaps.index(u, TBitmapIndexer::OUT));
+        copyIndex(in, bitmaps.index(u, TBitmapIndexer::IN));
+        for (TVertex v = 0; v < nVert; ++v)
+            assert(indexer.reaches(u, v) == out[v]);
+
+        assert(indexer.index(u, TIndexer::OUT) == out);
+        assert(indexer.index(u, TIndexer::IN) == in);
+
+        const TVertex dst = (u * 7 + 3) % nVert;
+        const ReachVertexPredicate<TGraph> pred(indexer, u, dst);
+        const BitmapVertexPredicate<TGraph> expected(bitmaps, u, dst);
+        for (TVertex v = 0; v < nVert; ++v)
+            assert(pred(v) == expected(v));
+    }
+}
+
+void checkSmall() {
+    using namespace boost;
+
+    // 0 -> {1, 2} -> 3, 4 calls itself, 5 calls 4
+    TGraph graph(6);
+    add_edge(0, 1, graph);
+    add_edge(1, 2, graph);
+    add_edge(2, 1, graph);
+    add_edge(2, 3, graph);
+    add_edge(4, 4, graph);
+    add_edge(5, 4, graph);
+
+    TIndexer indexer(graph);
+    assert(indexer.reaches(0, 3));
+    assert(indexer.reaches(1, 1) && indexer.reaches(2, 1));
+    assert(!indexer.reaches(0, 0) && !indexer.reaches(3, 0));
+    assert(indexer.reaches(4, 4) && indexer.reaches(5, 4));
+    assert(!indexer.reaches(0, 4) && !indexer.reaches(4, 5));
+    assert(indexer.index(0, TIndexer::OUT).count() == 3);
+    assert(indexer.index(4, TIndexer::IN).count() == 2);
+
+    ReachFilter<TGraph> factor(indexer, 0, 3);
+    graph_traits<ReachFilter<TGraph> >::vertex_iterator vi, vi_end;
+    size_t cnt = 0;
+    for (tie(vi, vi_end) = vertices(factor); vi != vi_end; ++vi, ++cnt)
+        assert(*vi < 4);
+    assert(cnt == 4);
+
+    checkGraph(graph, 1);
+}
+
+void checkRandom() {
+    using namespace boost;
+
+    for (unsigned seed = 1; seed < 12; ++seed) {
+        // DAGs (edges go down) with a few back edges on odd seeds
+        const size_t nVert = 150;
+        TGraph graph(nVert);
+        for (TVertex v = 0; v < nVert; ++v) {
+            for (unsigned i = 0; i < 2; ++i) {
+                const TVertex w = (v * seed * 31 + i * 17 + seed) % nVert;
+                if (v < w || (seed & 1 && !(v % 23)))
+                    add_edge(v, w, graph);
+            }
+        }
+
+        checkGraph(graph, 1 + seed % 4);
+    }
+}
+
+int main(int, char *[]) {
+    checkSmall();
+    checkRandom();
+
+    return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "RoaringBitmap.hh"
+
+#undef NDEBUG
+#include <cassert>
+#include <vector>
+
+#include <boost/dynamic_bitset.hpp>
+
+typedef boost::dynamic_bitset<>                         TBitset;
+
+/// simple linear congruential generator, so that results are repeatable
+class Random {
+    public:
+        Random(unsigned seed): state_(seed) { }
+
+        size_t operator()(size_t n) {
+            state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+            return (state_ >> 33) % n;
+        }
+
+    private:
+        boost::uint64_t state_;
+};
+
+void checkSame(const RoaringBitmap &bitmap, const TBitset &expected) {
+    assert(bitmap.size() == expected.size());
+    assert(bitmap.count() == expected.count());
+    assert(bitmap.any() == expected.any());
+
+    size_t pos = bitmap.find_first();
+    size_t exp = expected.find_first();
+    for (; exp != TBitset::npos; exp = expected.find_next(exp)) {
+        assert(pos == exp);
+        assert(bitmap[pos]);
+        pos = bitmap.find_next(pos);
+    }
+    assert(pos == RoaringBitmap::npos);
+
+    TBitset copy;
+    bitmap.copyTo(copy);
+    assert(copy == expected);
+}
+
+/// fill both bitmaps by the given pattern (0 sparse, 1 dense, 2 runs)
+void fill(RoaringBitmap &bitmap, TBitset &expected, int pattern, Random &rnd) {
+    const size_t size = expected.size();
+    switch (pattern) {
+        case 0:
+            for (int i = 0; i < 2000; ++i) {
+                const size_t pos = rnd(size);
+                bitmap.set(pos);
+                expected.set(pos);
+            }
+            break;
+
+        case 1:
+            for (size_t pos = 0; pos < size; ++pos) {
+                if (rnd(3))
+                    continue;
+                bitmap.set(pos);
+                expected.set(pos);
+            }
+            break;
+
+        case 2:
+            for (int i = 0; i < 20; ++i) {
+                const size_t first = rnd(size);
+                const size_t last = std::min(size, first + rnd(100000));
+                for (size_t pos = first; pos < last; ++pos) {
+                    bitmap.set(pos);
+                    expected.set(pos);
+                }
+            }
+            break;
+    }
+
+    if (rnd(2))
+        bitmap.optimize();
+}
+
+void checkBits() {
+    RoaringBitmap bitmap(200000);
+    assert(bitmap.none());
+    assert(bitmap.find_first() == RoaringBitmap::npos);
+    bitmap.set(5).set(70000).set(199999).set(5);
+    assert(bitmap.count() == 3);
+    assert(bitmap.test(5) && bitmap.test(70000) && !bitmap.test(6));
+    assert(bitmap.find_next(5) == 70000);
+    assert(bitmap.find_next(70000) == 199999);
+    assert(bitmap.find_next(199999) == RoaringBitmap::npos);
+    bitmap.reset(70000).reset(70001);
+    assert(bitmap.count() == 2);
+
+    // an array turns to a bitset once it is too big, and back by optimize()
+    TBitset expected(200000);
+    expected.set(5).set(199999);
+    for (size_t pos = 0; pos < 10000; pos += 2) {
+        bitmap.set(pos + 65536);
+        expected.set(pos + 65536);
+    }
+    checkSame(bitmap, expected);
+    const size_t bitsetSize = bitmap.memoryUsage();
+    for (size_t pos = 0; pos < 8000; pos += 2) {
+        bitmap.reset(pos + 65536);
+        expected.reset(pos + 65536);
+    }
+    bitmap.optimize();
+    checkSame(bitmap, expected);
+    assert(bitmap.memoryUsage() < bitsetSize);
+
+    // runs are tiny
+    RoaringBitmap full(1000000);
+    full.resize(3000000, true);
+    assert(full.count() == 2000000);
+    assert(full.find_first() == 1000000);
+    assert(full.memoryUsage() < 4096);
+    full.resize(1500000);
+    assert(full.count() == 500000);
+    full.reset(1200000);
+    assert(!full[1200000] && full[1200001] && full.count() == 499999);
+}
+
+void checkOperators() {
+    Random rnd(7);
+    const size_t size = 300000;
+    for (int round = 0; round < 60; ++round) {
+        RoaringBitmap a(size), b(size);
+        TBitset ea(size), eb(size);
+        fill(a, ea, round % 3, rnd);
+        fill(b, eb, (round / 3) % 3, rnd);
+        checkSame(a, ea);
+        checkSame(b, eb);
+        assert((a == b) == (ea == eb));
+
+        RoaringBitmap r(a);
+        r |= b;
+        checkSame(r, ea | eb);
+        r = a;
+        r &= b;
+        checkSame(r, ea & eb);
+        r = a;
+        r -= b;
+        checkSame(r, ea - eb);
+        r.optimize();
+        checkSame(r, ea - eb);
+
+        // equality does not depend on kinds of containers
+        RoaringBitmap c(a);
+        c.optimize();
+        assert(c == a);
+        c |= a;
+        assert(c == a);
+        if (ea.any()) {
+            c.reset(ea.find_first());
+            assert(c != a);
+        }
+
+        // serialization
+        std::vector<RoaringBitmap::TWord> words;
+        a.serialize(words);
+        b.serialize(words);
+        std::vector<RoaringBitmap::TWord> first;
+        a.serialize(first);
+        RoaringBitmap loaded(size);
+        assert(loaded.deserialize(&words[0], &words[0] + first.size()));
+        assert(loaded == a);
+        assert(loaded.deserialize(&words[0] + first.size(),
+                                  &words[0] + words.size()));
+        assert(loaded == b);
+        assert(!loaded.deserialize(&words[0], &words[0] + first.size() - 1)
+                || 2 == first.size());
+        assert(loaded.none());
+    }
+}
+
+int main(int, char *[]) {
+    checkBits();
+    checkOperators();
+
+    return 0;
+}
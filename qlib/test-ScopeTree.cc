@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "ScopeTree.hh"
+
+#undef NDEBUG
+#include <cassert>
+#include <set>
+#include <string>
+#include <vector>
+
+typedef ScopeTree::TNameList                            TNameList;
+
+std::string splitJoined(const std::string &name) {
+    TNameList comps;
+    ScopeTree::split(name, comps);
+    std::string joined;
+    for (TNameList::const_iterator i = comps.begin(); i != comps.end(); ++i)
+        joined += "[" + *i + "]";
+    return joined;
+}
+
+void checkSplit() {
+    assert(splitJoined("main") == "[main]");
+    assert(splitJoined("") == "[]");
+    assert(splitJoined("ns::C::run(int)") == "[ns][C][run]");
+    assert(splitJoined("ns::C::run() const") == "[ns][C][run]");
+    assert(splitJoined("std::vector<int, std::allocator<int> >::push_back("
+                "int const&)")
+            == "[std][vector<int, std::allocator<int> >][push_back]");
+    assert(splitJoined("(anonymous namespace)::helper(char*)")
+            == "[(anonymous namespace)][helper]");
+    assert(splitJoined("void ns::apply<int>(int)") == "[ns][apply<int>]");
+    assert(splitJoined("ns::C::operator()(int)") == "[ns][C][operator()]");
+    assert(splitJoined("ns::C::operator<<(std::ostream&)")
+            == "[ns][C][operator<<]");
+    assert(splitJoined("ns::C::operator std::string() const")
+            == "[ns][C][operator std::string]");
+    assert(splitJoined("ns::f(int)::{lambda(int)#1}::operator()(int) const")
+            == "[ns][f]");
+    assert(splitJoined("ns::tag[abi:cxx11]()") == "[ns][tag[abi:cxx11]]");
+    assert(splitJoined("operator_x") == "[operator_x]");
+}
+
+std::set<ScopeTree::TVertex> verticesOf(const ScopeTree &tree,
+                                        ScopeTree::TNode node)
+{
+    const ScopeTree::TVertexRange range = tree.vertices(node);
+    return std::set<ScopeTree::TVertex>(range.first, range.second);
+}
+
+void checkTree() {
+    TNameList names;
+    names.push_back("main");                            // 0
+    names.push_back("ns::C::run(int)");                 // 1
+    names.push_back("ns::C::run(char)");                // 2
+    names.push_back("ns::D::stop()");                   // 3
+    names.push_back("ns::free()");                      // 4
+    names.push_back("other::C::run()");                 // 5
+    names.push_back("ns::C::C()");                      // 6
+    names.push_back("");                                // 7
+
+    ScopeTree tree;
+    assert(tree.size() == 1);
+    tree.build(names);
+
+    // root, main, ns, ns::C, ns::C::C, ns::C::run, ns::D, ns::D::stop,
+    // ns::free, other, other::C, other::C::run
+    assert(tree.size() == 12);
+    assert(tree.find("") == ScopeTree::ROOT);
+    assert(tree.vertices(ScopeTree::ROOT).second
+            - tree.vertices(ScopeTree::ROOT).first == 8);
+
+    const ScopeTree::TNode ns = tree.find("ns");
+    assert(ScopeTree::NOT_FOUND != ns);
+    assert(tree.path(ns) == "ns");
+    assert(tree.parent(ns) == ScopeTree::ROOT);
+    assert(tree.ownVertices(ns).first == tree.ownVertices(ns).second);
+
+    std::set<ScopeTree::TVertex> expected;
+    expected.insert(1);
+    expected.insert(2);
+    expected.insert(3);
+    expected.insert(4);
+    expected.insert(6);
+    assert(verticesOf(tree, ns) == expected);
+
+    // all overloads of one function are one node
+    const ScopeTree::TNode run = tree.find("ns::C::run");
+    assert(tree.find("ns::C::run(int)") == run);
+    assert(tree.name(run) == "run");
+    assert(tree.ownVertices(run).second - tree.ownVertices(run).first == 2);
+    assert(tree.nodeOf(1) == run);
+    assert(tree.nodeOf(2) == run);
+    assert(tree.nodeOf(7) == ScopeTree::ROOT);
+
+    // children come in order of names
+    const ScopeTree::TNode c = tree.find("ns::C");
+    TNameList children;
+    for (ScopeTree::TNode n = tree.firstChild(ns); ScopeTree::NOT_FOUND != n;
+            n = tree.nextSibling(n))
+    {
+        assert(tree.parent(n) == ns);
+        children.push_back(tree.name(n));
+    }
+    assert(children.size() == 3);
+    assert(children[0] == "C");
+    assert(children[1] == "D");
+    assert(children[2] == "free");
+    assert(tree.firstChild(run) == ScopeTree::NOT_FOUND);
+    assert(tree.firstChild(c) != ScopeTree::NOT_FOUND);
+
+    // scopes of the same name in different namespaces
+    ScopeTree::TNodeList named;
+    tree.findNamed("C", named);
+    assert(named.size() == 3);
+    named.clear();
+    tree.findNamed("run", named);
+    assert(named.size() == 2);
+    named.clear();
+    tree.findNamed("nothing", named);
+    assert(named.empty());
+
+    assert(tree.find("ns::E") == ScopeTree::NOT_FOUND);
+    assert(tree.find("C") == ScopeTree::NOT_FOUND);
+    assert(0 < tree.memoryUsage());
+}
+
+int main(int, char *[]) {
+    checkSplit();
+    checkTree();
+    return 0;
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "BitmapIndex.hh"
+#include "Cgt.hh"
+#include "CsrCallGraph.hh"
+#include "Image.hh"
+#include "SymbolIndex.hh"
+#include "test-lib.hh"
+
+#undef NDEBUG
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+typedef IndexedSymbolMap<CsrCallGraph>                  TSymbolMap;
+typedef TSymbolMap::TVertexList                         TVertexList;
+typedef BitmapIndexer<CsrCallGraph>                     TIndexer;
+
+void readGraph(CsrCallGraph &graph) {
+    // foo is defined in both files, _ZN2ns3runEv is ns::run()
+    std::istringstream str(
+            "F a.c\n"
+            "1 (3) main 2 3\n"
+            "2 (10) @static foo\n"
+            "3 (20) _ZN2ns3runEv 4\n"
+            "4 (0) @decl _ZN2ns4stopEi\n"
+            "F b.c\n"
+            "5 (5) @static foo 6\n"
+            "6 (7) fool\n");
+
+    CallGraph loaded;
+    CgtGraphBuilder<CallGraph> builder(loaded);
+    CgtReader reader(&builder);
+    assert(reader.read(str, false));
+    graph.assign(loaded);
+    assert(num_vertices(graph) == 6);
+}
+
+void checkFind(const SymbolIndex &index) {
+    // names as read and demangled names
+    const TSymbolMap sMap(index);
+    assert(sMap.size() == 5 + 2);
+    assert(sMap.find("main") == TVertexList(1, 0));
+    assert(sMap["foo"].size() == 2);
+    assert(sMap["foo"][0] == 1);
+    assert(sMap["foo"][1] == 4);
+    assert(sMap.find("ns::run()") == sMap.find("_ZN2ns3runEv"));
+    assert(sMap.find("ns::stop(int)") == TVertexList(1, 3));
+
+    // misses
+    assert(sMap.find("nothing").empty());
+    assert(sMap["fo"].empty());
+    assert(sMap.find("").empty());
+
+    std::vector<std::string> names;
+    names.push_back("fool");
+    names.push_back("nothing");
+    names.push_back("ns::run()");
+    names.push_back("_ZN2ns3runEv");
+    TVertexList list;
+    std::vector<std::string> missing;
+    assert(sMap.resolve(names.begin(), names.end(), list, &missing) == 3);
+    assert(list.size() == 2);
+    assert(list[0] == 2);
+    assert(list[1] == 5);
+    assert(missing == std::vector<std::string>(1, "nothing"));
+}
+
+void checkImage(const CsrCallGraph &graph, const SymbolIndex &index) {
+    // build some of the indexes only
+    TIndexer indexer(graph);
+    indexer.build(TIndexer::OUT);
+    const TIndexer::TIndex &in4 = indexer.index(4, TIndexer::IN);
+
+    char fileName[] = "/tmp/test-SymbolIndex-XXXXXX";
+    const int fd = mkstemp(fileName);
+    assert(0 <= fd);
+    close(fd);
+    {
+        std::ofstream str(fileName, std::ios::out | std::ios::binary);
+        ImageWriter img(str);
+        graph.save(img);
+        index.save(img);
+        indexer.save(img);
+        assert(img.good());
+    }
+
+    MappedFile file;
+    assert(file.open(fileName));
+    std::remove(fileName);
+    assert(file.isImage());
+
+    ImageReader img(file.data(), file.size());
+    CsrCallGraph loaded;
+    assert(loaded.load(img));
+    assert(num_vertices(loaded) == num_vertices(graph));
+    assert(num_edges(loaded) == num_edges(graph));
+    assert(out_degree(0, loaded) == 2);
+    assert(target(*out_edges(4, loaded).first, loaded) == 5);
+    assert(in_degree(3, loaded) == 1);
+    FncMap prop = get(FncProp(), loaded);
+    assert(get(prop, 4)->name() == "foo");
+    assert(get(prop, 4)->file() == "b.c");
+    assert(get(prop, 3)->prettyName() == "ns::stop(int)");
+
+    SymbolIndex loadedIndex;
+    assert(loadedIndex.load(img, num_vertices(loaded)));
+    assert(loadedIndex.memoryUsage() < index.memoryUsage());
+    checkFind(loadedIndex);
+
+    TIndexer loadedIndexer(loaded);
+    assert(loadedIndexer.load(img));
+    for (size_t v = 0; v < num_vertices(graph); ++v)
+        assert(loadedIndexer.index(v, TIndexer::OUT)
+                == indexer.index(v, TIndexer::OUT));
+    assert(loadedIndexer.index(4, TIndexer::IN) == in4);
+    assert(loadedIndexer.index(5, TIndexer::IN)
+            == indexer.index(5, TIndexer::IN));
+
+    // indexes of another graph are refused
+    ImageReader again(file.data(), file.size());
+    SymbolIndex skipped;
+    assert(loaded.load(again)
+            && skipped.load(again, num_vertices(loaded)));
+    CsrCallGraph other;
+    TIndexer otherIndexer(other);
+    assert(!otherIndexer.load(again));
+
+    // not an image
+    const char text[] = "F a.c\n1 (3) main\n";
+    ImageReader bad(text, sizeof text);
+    assert(!bad.good());
+    assert(!loaded.load(bad));
+    assert(!num_vertices(loaded));
+}
+
+typedef std::vector<boost::uint32_t>                    TWords;
+
+/// arrays of a SymbolIndex of keys "a" and "b", in the order they are saved
+struct IndexArrays {
+    PerfectHash         hash;
+    std::string         keyData;
+    TWords              keyOffsets;
+    TWords              vertexStart;
+    TWords              vertices;
+
+    IndexArrays() {
+        const char data[] = "a\0b";
+        const boost::uint32_t offsets[] = { 0, 2, 4 };
+        hash.build(data, offsets, 2);
+
+        // "a" is the name of vertex 0, "b" of vertices 1 and 2
+        const size_t posOfA = hash("a", 1);
+        keyData = std::string((posOfA) ? "b\0a" : "a\0b", 4);
+        keyOffsets.assign(offsets, offsets + 3);
+        vertexStart.push_back(0);
+        vertexStart.push_back((posOfA) ? 2 : 1);
+        vertexStart.push_back(3);
+        vertices.push_back((posOfA) ? 1 : 0);
+        vertices.push_back((posOfA) ? 2 : 1);
+        vertices.push_back((posOfA) ? 0 : 2);
+    }
+
+    /// @return Return true if an image of the arrays is loaded
+    bool load(size_t nVertices) const {
+        std::ostringstream str;
+        {
+            ImageWriter img(str);
+            hash.save(img);
+            img.putArray(keyData.data(), keyData.size());
+            img.putVector(keyOffsets);
+            img.putVector(vertexStart);
+            img.putVector(vertices);
+            assert(img.good());
+        }
+
+        const ImageBuffer image(str);
+        ImageReader img(image.reader());
+        SymbolIndex index;
+        if (!index.load(img, nVertices))
+            return false;
+
+        // the index is usable as loaded
+        assert(1 == index.find("a").second - index.find("a").first);
+        assert(2 == index.find("b").second - index.find("b").first);
+        return true;
+    }
+};
+
+void checkDamagedImages() {
+    const IndexArrays valid;
+    assert(valid.load(3));
+
+    // vertices of a smaller graph
+    assert(!valid.load(2));
+
+    for (int i = 0; i < 5; ++i) {
+        IndexArrays damaged;
+        switch (i) {
+            case 0: damaged.keyOffsets[0] = 1;                          break;
+            case 1: damaged.keyOffsets[1] = 4;                          break;
+            case 2: damaged.vertexStart[1] = 3;
+                    damaged.vertexStart[2] = 2;                         break;
+            case 3: damaged.vertexStart[2] = 4;                         break;
+            case 4: damaged.vertices[1] = 7;                            break;
+        }
+        assert(!damaged.load(3));
+    }
+}
+
+int main(int, char *[]) {
+    CsrCallGraph graph;
+    readGraph(graph);
+
+    SymbolIndex index;
+    buildSymbolIndex(index, graph);
+    checkFind(index);
+    checkImage(graph, index);
+    checkDamagedImages();
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2009 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of cgt (Call Graph Tools).
+ *
+ * cgt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * cgt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cgt.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.hh"
+#include "Cgt.hh"
+#include "CsrCallGraph.hh"
+#include "SymbolMap.hh"
+
+#undef NDEBUG
+#include <cassert>
+#include <sstream>
+
+typedef SymbolMap<CsrCallGraph>                         TSymbolMap;
+typedef TSymbolMap::TVertexList                         TVertexList;
+
+void readGraph(CsrCallGraph &graph) {
+    // foo is defined in both files, _ZN2ns3runEv is ns::run()
+    std::istringstream str(
+            "F a.c\n"
+            "1 (3) main 2 3\n"
+            "2 (10) @static foo\n"
+            "3 (20) _ZN2ns3runEv 4\n"
+            "4 (0) @decl _ZN2ns4stopEi\n"
+            "F b.c\n"
+            "5 (5) @static foo\n"
+            "6 (7) fool\n");
+
+    CallGraph loaded;
+    CgtGraphBuilder<CallGraph> builder(loaded);
+    CgtReader reader(&builder);
+    assert(reader.read(str, false));
+    graph.assign(loaded);
+    assert(num_vertices(graph) == 6);
+}
+
+void checkMangledOnly(const TSymbolMap &sMap) {
+    // names as read do not need any demangling
+    assert(sMap.size() == 5);
+    assert(sMap.find("main").size() == 1);
+    assert(sMap.find("main")[0] == 0);
+    assert(sMap["foo"].size() == 2);
+    assert(sMap["foo"][0] == 1);
+    assert(sMap["foo"][1] == 4);
+    assert(sMap.find("_ZN2ns3runEv").size() == 1);
+
+    // demangled names are not there until they are added
+    assert(sMap.find("ns::run()").empty());
+    assert(sMap.size() == 5);
+}
+
+void checkFind(const TSymbolMap &sMap) {
+    assert(sMap["foo"].size() == 2);
+
+    // mangled and demangled names lead to the same function
+    assert(sMap.find("_ZN2ns3runEv").size() == 1);
+    assert(sMap.find("ns::run()") == sMap.find("_ZN2ns3runEv"));
+    assert(sMap.find("ns::stop(int)").size() == 1);
+    assert(sMap.find("ns::stop(int)")[0] == 3);
+
+    // misses do not add anything
+    const size_t size = sMap.size();
+    assert(size == 5 + 2);
+    assert(sMap.find("nothing").empty());
+    assert(sMap["fo"].empty());
+    assert(sMap.find("").empty());
+    assert(sMap.size() == size);
+}
+
+void checkPrefix(TSymbolMap &sMap, bool ownDict) {
+    TVertexList list;
+    sMap.findPrefix("foo", list);
+    assert(list.size() == 3);
+
+    list.clear();
+    sMap.findPrefix("_ZN2ns", list);
+    assert(list.size() == 2);
+
+    list.clear();
+    sMap.findPrefix("x", list);
+    assert(list.empty());
+
+    // demangled names are in the dictionary built by SymbolMap only
+    list.clear();
+    sMap.findPrefix("ns::", list);
+    assert(list.size() == (ownDict ? 2U : 0U));
+}
+
+void checkResolve(const TSymbolMap &sMap) {
+    std::vector<std::string> names;
+    names.push_back("fool");
+    names.push_back("nothing");
+    names.push_back("foo");
+    names.push_back("ns::run()");
+    names.push_back("_ZN2ns3runEv");
+    names.push_back("fool");
+
+    TVertexList list(1, 0);
+    std::vector<std::string> missing;
+    assert(sMap.resolve(names.begin(), names.end(), list, &missing) == 5);
+
+    // vertices already in the list are kept, the new ones come once each
+    assert(list.size() == 1 + 4);
+    assert(list[0] == 0);
+    assert(list[1] == 1);
+    assert(list[2] == 2);
+    assert(list[3] == 4);
+    assert(list[4] == 5);
+    assert(missing.size() == 1);
+    assert(missing[0] == "nothing");
+
+    list.clear();
+    assert(!sMap.resolve(names.begin() + 1, names.begin() + 2, list));
+    assert(list.empty());
+}
+
+int main(int, char *[]) {
+    CsrCallGraph graph;
+    readGraph(graph);
+
+    TSymbolMap sMap(graph);
+    checkMangledOnly(sMap);
+    sMap.addDemangled();
+    sMap.addDemangled();
+    checkFind(sMap);
+    checkPrefix(sMap, true);
+    checkResolve(sMap);
+
+    // the same with a name dictionary built aside
+    NameDict dict;
+    buildNameDict(dict, graph);
+    TSymbolMap shared(graph, dict);
+    checkMangledOnly(shared);
+    shared.addDemangled();
+    checkFind(shared);
+    checkPrefix(shared, false);
+    checkResolve(shared);
+
+    return 0;
+}
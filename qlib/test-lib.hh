@@ -21,6 +21,14 @@
 #define TEST_LIB_H
 
 #include "config.hh"
+#include "Image.hh"
+
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
 #include <boost/graph/adjacency_list.hpp>
 
 
@@ -93,4 +101,27 @@ class FullyConnectedGraph: public
         }
 };
 
+/**
+ * Session image written to a string stream, copied to memory aligned the way
+ * a mapped image is, so that it can be read by ImageReader.
+ */
+class ImageBuffer {
+    public:
+        ImageBuffer(const std::ostringstream &str) {
+            const std::string data(str.str());
+            size_ = data.size();
+            buf_.resize(size_ / sizeof(boost::uint64_t) + 1);
+            std::memcpy(&buf_[0], data.data(), size_);
+        }
+
+        ImageReader reader() const {
+            return ImageReader(reinterpret_cast<const char *>(&buf_[0]),
+                               size_);
+        }
+
+    private:
+        size_t                          size_;
+        std::vector<boost::uint64_t>    buf_;
+};
+
 #endif // TEST_LIB_H
@@ -183,6 +183,11 @@ class CG (SymbolSet):
         #self.cg.compute_callers()
         SymbolSet.__init__(self, self, self.cg.all_program_symbols())
 
+    def scope(self, name):
+        """All functions within C++ namespace or class NAME (e.g. "ns::C",
+        or just "C" for all scopes of that name), looked up in scope tree."""
+        return SymbolSet(self, self.cg.find_scope(name))
+
 class PathSet (object):
     def __init__(self, parent, paths):
         self.parent = parent
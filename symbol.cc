@@ -110,16 +110,45 @@ psym_ptrcall()
   return psym;
 }
 
+namespace {
+  // Canonical paths, indexed by the current path and the name of the
+  // file symbol.  The same pair comes up for most symbols of a
+  // module, so it pays off to canonicalize each of them only once.
+  typedef std::MAP<q::Quark, q::Quark> file_path_map;
+  typedef std::MAP<q::Quark, file_path_map> path_cache_t;
+  path_cache_t path_cache;
+
+  q::Quark
+  make_path(std::string const& curpath, std::string const& fn)
+  {
+    static std::string HOME = std::getenv("HOME") ?: "";
+
+    char pathstor[curpath.length() + fn.length() + 1];
+    size_t pathlen = sizeof(pathstor);
+    char *path = pathstor;
+    stpcpy(stpcpy(path, curpath.c_str()), fn.c_str());
+    if (!HOME.empty() && pathlen > HOME.length()
+	&& std::strncmp(path, HOME.c_str(), HOME.length()) == 0
+	&& (*HOME.rbegin() == '/' || path[HOME.length()] == '/'))
+      {
+	path += HOME.length() - 1;
+	*path = '~';
+      }
+    size_t len = canonicalize_inplace(path);
+    return q::intern(std::string(path, len));
+  }
+}
+
 void
-update_path(ProgramSymbol *psym, std::string const& curpath)
+update_path(ProgramSymbol *psym, q::Quark curpath)
 {
-  static std::string HOME = std::getenv("HOME") ?: "";
+  static q::Quark const empty = q::intern("");
 
   FileSymbol *fsym = psym->get_file();
   if (fsym == NULL || fsym->get_qname() == NULL)
     {
     empty:
-      psym->set_path(q::intern(""));
+      psym->set_path(empty);
     }
   else
     {
@@ -132,18 +161,10 @@ update_path(ProgramSymbol *psym, std::string const& curpath)
 	psym->set_path(fsym->get_qname());
       else
 	{
-	  char pathstor[curpath.length() + fn.length() + 1];
-	  size_t pathlen = sizeof(pathstor);
-	  char *path = pathstor;
-	  stpcpy(stpcpy(path, curpath.c_str()), fn.c_str());
-	  if (!HOME.empty() && pathlen > HOME.length()
-	      && std::strncmp(path, HOME.c_str(), HOME.length()) == 0
-	      && (*HOME.rbegin() == '/' || path[HOME.length()] == '/'))
-	    {
-	      path += HOME.length() - 1;
-	      *path = '~';
-	    }
-	  psym->set_path(q::intern(canonicalize(path)));
+	  q::Quark &path = path_cache[curpath][fsym->get_qname()];
+	  if (path == NULL)
+	    path = make_path(*q::to_string(curpath), fn);
+	  psym->set_path(path);
 	}
     }
 }
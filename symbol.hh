@@ -94,6 +94,8 @@ private:
 // Pseudo-symbol used as calee in "call through pointer" cases.
 ProgramSymbol* psym_ptrcall();
 
-void update_path(ProgramSymbol *psym, std::string const& curpath);
+// Set path of PSYM to the canonical path of its file symbol, relative
+// to CURPATH.  Results are cached per (CURPATH, file name) pair.
+void update_path(ProgramSymbol *psym, q::Quark curpath);
 
 #endif//cgt_symbol_hh_guard